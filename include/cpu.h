@@ -39,6 +39,11 @@
 
 #define CPU_CYCLES_LOWER_LIMIT		200
 
+#define CPU_IDLE_POLLS				16
+
+#define CPU_CYCLEADJUST_CLASSIC		0x00
+#define CPU_CYCLEADJUST_PI			0x01
+
 
 #define CPU_ARCHTYPE_MIXED			0xff
 #define CPU_ARCHTYPE_386SLOW		0x30
@@ -57,6 +62,10 @@ extern Bit32s CPU_CycleLimit;
 extern Bit64s CPU_IODelayRemoved;
 extern bool CPU_CycleAutoAdjust;
 extern bool CPU_SkipCycleAutoAdjust;
+extern Bitu CPU_CycleAdjustMode;
+extern Bit32s CPU_CycleTarget;
+extern bool CPU_CycleLog;
+extern bool CPU_IdleDetect;
 extern Bitu CPU_AutoDetermineMode;
 
 extern Bitu CPU_ArchitectureType;
@@ -84,6 +93,9 @@ void CPU_Enable_SkipAutoAdjust(void);
 void CPU_Disable_SkipAutoAdjust(void);
 void CPU_Reset_AutoAdjust(void);
 
+void CPU_IdleSkip(void);
+void CPU_IdlePoll(void);
+
 
 //CPU Stuff
 
@@ -76,8 +76,12 @@ public:
 	void Clear_Request(void) {
 		request=false;
 	}
+	//A null buffer skips the data, after it was used in place through Map
 	Bitu Read(Bitu size, Bit8u * buffer);
 	Bitu Write(Bitu size, Bit8u * buffer);
+	//Points data at the next units of the transfer in memory, returns how many
+	//of them can be used from there before the transfer ends or memory breaks up
+	Bitu Map(Bitu size, Bit8u * & data);
 };
 
 class DmaController {
@@ -31,6 +31,7 @@ enum OPL_Mode {
 #define CAPTURE_MIDI	0x04
 #define CAPTURE_IMAGE	0x08
 #define CAPTURE_VIDEO	0x10
+#define CAPTURE_FRAMES	0x20
 
 extern Bitu CaptureState;
 
@@ -50,6 +51,7 @@ void CAPTURE_AddWave(Bit32u freq, Bitu len, Bit16s * data);
 #define CAPTURE_FLAG_DBLH	0x2
 #define CAPTURE_FLAG_DUPLICATE	0x4
 void CAPTURE_AddImage(Bitu width, Bitu height, Bitu bpp, Bitu pitch, Bitu flags, float fps, const Bit8u * data, const Bit8u * pal);
+void CAPTURE_AddFrame(Bitu width, Bitu height, Bitu bpp, Bitu pitch, Bitu flags, const Bit8u * data, const Bit8u * pal);
 void CAPTURE_AddMidi(bool sysex, Bitu len, Bit8u * data);
 
 #endif
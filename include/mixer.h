@@ -41,6 +41,8 @@ enum MixerModes {
 #define MIXER_BUFMASK (MIXER_BUFSIZE-1)
 extern Bit8u MixTemp[MIXER_BUFSIZE];
 
+class MixerSinc;
+
 #define MAX_AUDIO ((1<<(16-1))-1)
 #define MIN_AUDIO -(1<<(16-1))
 
@@ -55,6 +57,8 @@ public:
 
 	template<class Type,bool stereo,bool signeddata,bool nativeorder>
 	void AddSamples(Bitu len, const Type* data);
+	template<class Type,bool stereo,bool signeddata,bool nativeorder>
+	void AddResampled(Bitu len, const Type* data);
 
 	void AddSamples_m8(Bitu len, const Bit8u * data);
 	void AddSamples_s8(Bitu len, const Bit8u * data);
@@ -77,6 +81,18 @@ public:
 
 	void FillUp(void);
 	void Enable(bool _yesno);
+	//Let the mixer skip the handler after a while of silence, see WakeUp
+	void SetAutoSleep(bool _yesno);
+	//Has to be called on every change to a device whose channel may sleep,
+	//returns true if the channel was sleeping
+	bool WakeUp(void) {
+		quiet = 0;
+		if (!sleeping) return false;
+		Wake();
+		return true;
+	}
+	void Wake(void);
+	void UpdateSleep(Bitu frames,bool silent);
 	MIXER_Handler handler;
 	float volmain[2];
 	float scale;
@@ -94,11 +110,17 @@ public:
 	//Simple way to lower the impact of DC offset. if MIXER_UPRAMP_STEPS is >0.
 	//Still work in progress and thus disabled for now.
 	Bits offset[2];
+	//Windowed sinc resampler used instead of the linear interpolation, or NULL
+	MixerSinc * sinc;
 	const char * name;
 	bool interpolate;
 	bool enabled;
 	bool last_samples_were_stereo;
 	bool last_samples_were_silence;
+	//Samples of digital silence in a row
+	Bitu quiet;
+	bool autosleep;
+	bool sleeping;
 	MixerChannel * next;
 };
 
@@ -0,0 +1,75 @@
+/*
+ *  Copyright (C) 2002-2020  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_PERF_H
+#define DOSBOX_PERF_H
+
+#ifndef DOSBOX_DOSBOX_H
+#include "dosbox.h"
+#endif
+#include <atomic>
+
+/* Every counter has a single writer: the mixer ones are only touched by the
+   audio callback, all others by the emulation thread. So they are plain
+   integers, the reporter only reads them. The host time counters are in
+   microseconds and are only collected while perf_enabled is set. */
+enum PerfCounter {
+	PERF_CPU_CYCLES,		// emulated cycles
+	PERF_CPU_TICKS,			// emulated milliseconds
+	PERF_PIC_EVENTS,		// PIC events serviced
+	PERF_FRAMES,			// frames rendered
+	PERF_FRAMES_SKIPPED,	// frames dropped by frameskip or frame pacing
+	PERF_MIXER_CALLBACKS,
+	PERF_MIXER_UNDERRUNS,	// callbacks that found less audio than they had to play
+	PERF_MIXER_OVERRUNS,	// callbacks that found way too much audio waiting
+	PERF_MIXER_STRETCHES,	// callbacks that played the audio at another speed
+	PERF_MIXER_LATENCY,		// microseconds of audio queued, summed over the callbacks
+	PERF_HOST_CPU,			// host time in the cpu cores
+	PERF_HOST_PIC,			// host time in PIC events, includes drawing lines
+	PERF_HOST_RENDER,		// host time finishing and presenting frames
+	PERF_HOST_MIXER,		// host time mixing the channels, FillUp included
+	PERF_MAX
+};
+
+/* Read by the audio callback as well, so it is atomic */
+extern std::atomic<bool> perf_enabled;
+extern Bit64u perf_counters[PERF_MAX];
+
+Bit64u PERF_Now(void);
+
+static INLINE void PERF_Add(PerfCounter counter,Bit64u value) {
+	perf_counters[counter]+=value;
+}
+
+/* Host time measurement, a start of 0 means collection was off */
+static INLINE Bit64u PERF_Start(void) {
+	return perf_enabled.load(std::memory_order_relaxed) ? PERF_Now() : 0;
+}
+
+static INLINE void PERF_Stop(PerfCounter counter,Bit64u start) {
+	if (start) perf_counters[counter]+=PERF_Now()-start;
+}
+
+/* The overlay text, lines separated by '\n'. NULL when the overlay is hidden.
+   The serial changes whenever the text or its visibility does. */
+const char * PERF_GetHUD(Bitu & serial);
+
+/* The last report as a single line of key=value pairs */
+const char * PERF_GetReport(void);
+
+#endif
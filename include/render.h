@@ -29,7 +29,8 @@
 
 #define RENDER_SKIP_CACHE	16
 //Enable this for scalers to support 0 input for empty lines
-//#define RENDER_NULL_INPUT
+//The vga passes 0 for lines without changes to their video memory
+#define RENDER_NULL_INPUT
 
 typedef struct {
 	struct { 
@@ -63,6 +64,13 @@ typedef struct {
 		Bitu index;
 		Bit8u hadSkip[RENDER_SKIP_CACHE];
 	} frameskip;
+	struct {
+		double period;			// host refresh period in ms, 0 when pacing is off
+		double vblank;			// host time of the next expected vblank, in ms
+		bool measure;
+		double lastSync;
+		Bitu presented, dropped;
+	} pacing;
 	struct {
 		Bitu size;
 		scalerMode_t inMode;
@@ -73,6 +81,7 @@ typedef struct {
 		ScalerLineHandler_t lineHandler;
 		ScalerLineHandler_t linePalHandler;
 		ScalerComplexHandler_t complexHandler;
+		void (*complexLine)(void);	// called by the cache stage after every line
 		Bitu blocks, lastBlock;
 		Bitu outPitch;
 		Bit8u *outWrite;
@@ -89,6 +98,7 @@ typedef struct {
 	bool aspect;
 	bool fullFrame;
 	bool forceUpdate;
+	Bitu hudSerial;
 } Render_t;
 
 extern Render_t render;
@@ -99,6 +109,7 @@ void RENDER_EndUpdate(bool abort);
 void RENDER_SetPal(Bit8u entry,Bit8u red,Bit8u green,Bit8u blue);
 bool RENDER_GetForceUpdate(void);
 void RENDER_SetForceUpdate(bool);
+void RENDER_Presented(Bit64u start,Bit64u end);
 
 
 #endif
@@ -0,0 +1,86 @@
+/*
+ *  Copyright (C) 2002-2020  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_SHM_OUTPUT_H
+#define DOSBOX_SHM_OUTPUT_H
+
+#ifndef DOSBOX_DOSBOX_H
+#include "dosbox.h"
+#endif
+
+/* output=shm writes the frames into a POSIX shared memory object for other
+   programs on the same host: compositors, recorders or test harnesses.
+
+   The object starts with a ShmOutputHeader, the pixels of slot i are at
+   headerSize + i * slotSize. The renderer draws straight into the slots in
+   turn, there is no lock. A slot's seq is odd while it's being written, so
+   a reader takes the slot in latest, copies what it needs and checks that
+   seq didn't change meanwhile. A reader that uses the pixels in place has
+   SHMOUT_SLOTS-1 frames of time before the slot is reused.
+
+   The object is created with mode 0600, so readers have to run as the same
+   user. A reader running as another user needs the mode of the object
+   widened once it exists, e.g. chmod 0640 /dev/shm/<name> and a shared
+   group, as the object holds everything shown on the screen. */
+
+#define SHMOUT_MAGIC		0x4d485344	// "DSHM"
+#define SHMOUT_VERSION		1
+#define SHMOUT_SLOTS		3
+#define SHMOUT_MAXWIDTH		2048
+#define SHMOUT_MAXHEIGHT	1536
+#define SHMOUT_NOFRAME		0xffffffff
+
+/* 32 bit 0xAARRGGBB pixels in host byte order, the same as GameLink */
+#define SHMOUT_FORMAT_ARGB32	1
+
+struct ShmOutputFrame {
+	volatile Bit32u seq;		// odd while the slot is written
+	Bit32u number;				// counts the finished frames
+	Bit64u timestamp;			// microseconds of the host's monotonic clock
+	Bit32u width;
+	Bit32u height;
+	Bit32u pitch;				// bytes from one line to the next
+	Bit32u format;
+	float ratio;				// shown height of a pixel over its width
+	/* Lines that differ from the previous frame: runs of unchanged and
+	   changed lines in turn, starting with unchanged ones */
+	Bit32u changedCount;
+	Bit16u changed[SHMOUT_MAXHEIGHT + 2];
+};
+
+struct ShmOutputHeader {
+	Bit32u magic;
+	Bit32u version;
+	Bit32u headerSize;
+	Bit32u slotSize;
+	Bit32u slots;
+	Bit32u maxWidth;
+	Bit32u maxHeight;
+	volatile Bit32u latest;		// slot of the last finished frame or SHMOUT_NOFRAME
+	ShmOutputFrame frame[SHMOUT_SLOTS];
+};
+
+bool SHMOUT_Open(const char * name);
+void SHMOUT_Close(void);
+/* False when the frame doesn't fit the slots */
+bool SHMOUT_SetSize(Bitu width,Bitu height);
+Bit8u * SHMOUT_StartFrame(Bitu & pitch);
+/* Publishes the frame, changedLines is NULL when it was aborted */
+void SHMOUT_EndFrame(const Bit16u * changedLines,double ratio);
+
+#endif
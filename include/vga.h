@@ -26,7 +26,8 @@
 
 //Don't enable keeping changes and mapping lfb probably...
 #define VGA_LFB_MAPPED
-//#define VGA_KEEP_CHANGES
+//Skipping unchanged lines needs RENDER_NULL_INPUT
+#define VGA_KEEP_CHANGES
 #define VGA_CHANGE_SHIFT	9
 
 class PageHandler;
@@ -155,6 +156,7 @@ typedef struct {
 	bool doublewidth,doubleheight;
 	Bit8u font[64*1024];
 	Bit8u * font_tables[2];
+	Bit32u font_gen;		// bumped when cached text glyphs are out of date
 	Bitu blinking;
 	bool blink;
 	bool char9dot;
@@ -165,6 +167,13 @@ typedef struct {
 		Bit8u enabled;
 	} cursor;
 	Drawmode mode;
+	struct {
+		bool enabled;
+		bool active;			// this frame is drawn when its last line is displayed
+		Bitu quiet;				// frames in a row without raster effects
+		Bitu changes;			// picture changes while this frame is displayed
+		double first;			// delay of the first line from the frame start
+	} batch;
 	bool vret_triggered;
 	bool vga_override;
 } VGA_Draw;
@@ -365,12 +374,16 @@ typedef struct {
 
 typedef struct {
 	//Add a few more just to be safe
-	Bit8u*	map; /* allocated dynamically: [(VGA_MEMORY >> VGA_CHANGE_SHIFT) + 32] */
-	Bit8u	checkMask, frame, writeMask;
-	bool	active;
-	Bit32u  clearMask;
-	Bit32u	start, last;
-	Bit32u	lastAddress;
+	Bit8u*	map; /* allocated dynamically: [((VGA_MEMORY << 1) >> VGA_CHANGE_SHIFT) + 32] */
+	Bitu	mapSize;
+	Bit8u	writeMask;
+	bool	enabled;
+	bool	kept;			// the renderer has the last frame
+	bool	active;			// unchanged lines of this frame are skipped
+	bool	full;			// draw all lines of the next frame
+	bool	drawing;		// a frame was started, it may not have completed
+	Bitu	span;			// bytes of video memory read for a line
+	Bitu	layout[16];		// everything besides memory a frame depends on
 } VGA_Changes;
 
 typedef struct {
@@ -420,6 +433,8 @@ void VGA_SetupHandlers(void);
 void VGA_StartResize(Bitu delay=50);
 void VGA_SetupDrawing(Bitu val);
 void VGA_CheckScanLength(void);
+/* A register write changed the picture without touching video memory */
+void VGA_RasterChange(void);
 void VGA_ChangedBank(void);
 
 /* Some DAC/Attribute functions */
@@ -523,6 +538,7 @@ extern Bit32u CGA_4_Table[256];
 extern Bit32u CGA_4_HiRes_Table[256];
 extern Bit32u CGA_16_Table[256];
 extern Bit32u TXT_Font_Table[16];
+extern Bit64u TXT_Font_Table16[16];
 extern Bit32u TXT_FG_Table[16];
 extern Bit32u TXT_BG_Table[16];
 extern Bit32u Expand16Table[4][16];
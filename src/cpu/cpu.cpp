@@ -28,6 +28,7 @@
 #include "setup.h"
 #include "programs.h"
 #include "paging.h"
+#include "pic.h"
 #include "lazyflags.h"
 #include "support.h"
 
@@ -60,6 +61,10 @@ Bit64s CPU_IODelayRemoved = 0;
 CPU_Decoder * cpudecoder;
 bool CPU_CycleAutoAdjust = false;
 bool CPU_SkipCycleAutoAdjust = false;
+Bitu CPU_CycleAdjustMode = CPU_CYCLEADJUST_CLASSIC;
+Bit32s CPU_CycleTarget = 90;
+bool CPU_CycleLog = false;
+bool CPU_IdleDetect = false;
 Bitu CPU_AutoDetermineMode = 0;
 
 Bitu CPU_ArchitectureType = CPU_ARCHTYPE_MIXED;
@@ -2029,21 +2034,41 @@ bool CPU_CPUID(void) {
 	return true;
 }
 
+/* Give up the rest of the current timeslice, the emulation continues
+   with the next PIC event. The skipped cycles don't cost host time, so
+   they are kept out of the auto cycles adjustment. */
+void CPU_IdleSkip(void) {
+	CPU_IODelayRemoved += CPU_Cycles;
+	CPU_Cycles=0;
+}
+
+/* Called on every fruitless poll of a waiting service (INT 16h keystroke
+   check, INT 28h). A program polling that often within one emulated
+   millisecond is only waiting for an interrupt, treat it like a HLT. */
+void CPU_IdlePoll(void) {
+	static Bitu poll_tick = 0;
+	static Bitu poll_count = 0;
+	if (!CPU_IdleDetect) return;
+	if (poll_tick != PIC_Ticks) {
+		poll_tick = PIC_Ticks;
+		poll_count = 0;
+	}
+	if (++poll_count >= CPU_IDLE_POLLS) CPU_IdleSkip();
+}
+
 static Bits HLT_Decode(void) {
 	/* Once an interrupt occurs, it should change cpu core */
 	if (reg_eip!=cpu.hlt.eip || SegValue(cs) != cpu.hlt.cs) {
 		cpudecoder=cpu.hlt.old_decoder;
 	} else {
-		CPU_IODelayRemoved += CPU_Cycles;
-		CPU_Cycles=0;
+		CPU_IdleSkip();
 	}
 	return 0;
 }
 
 void CPU_HLT(Bitu oldeip) {
 	reg_eip=oldeip;
-	CPU_IODelayRemoved += CPU_Cycles;
-	CPU_Cycles=0;
+	CPU_IdleSkip();
 	cpu.hlt.cs=SegValue(cs);
 	cpu.hlt.eip=reg_eip;
 	cpu.hlt.old_decoder=cpudecoder;
@@ -2302,6 +2327,13 @@ public:
 
 		CPU_CycleUp=section->Get_int("cycleup");
 		CPU_CycleDown=section->Get_int("cycledown");
+
+		std::string cycleadjust(section->Get_string("cycleadjust"));
+		if (cycleadjust == "pi") CPU_CycleAdjustMode=CPU_CYCLEADJUST_PI;
+		else CPU_CycleAdjustMode=CPU_CYCLEADJUST_CLASSIC;
+		CPU_CycleTarget=section->Get_int("cycletarget");
+		CPU_CycleLog=section->Get_bool("cyclelog");
+		CPU_IdleDetect=section->Get_bool("idledetect");
 		std::string core(section->Get_string("core"));
 		cpudecoder=&CPU_Core_Normal_Run;
 		if (core == "normal") {
@@ -1173,6 +1173,12 @@ static Bitu DOS_27Handler(void) {
 	return CBRET_NONE;
 }
 
+static Bitu DOS_28Handler(void) {
+	// DOS idle interrupt
+	CPU_IdlePoll();
+	return CBRET_NONE;
+}
+
 static Bitu DOS_25Handler(void) {
 	if (reg_al >= DOS_DRIVES || !Drives[reg_al] || Drives[reg_al]->isRemovable()) {
 		reg_ax = 0x8002;
@@ -1230,7 +1236,7 @@ public:
 		callback[4].Install(DOS_27Handler,CB_IRET,"DOS Int 27");
 		callback[4].Set_RealVec(0x27);
 
-		callback[5].Install(NULL,CB_IRET,"DOS Int 28");
+		callback[5].Install(DOS_28Handler,CB_IRET,"DOS Int 28");
 		callback[5].Set_RealVec(0x28);
 
 		callback[6].Install(NULL,CB_INT29,"CON Output Int 29");
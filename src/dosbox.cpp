@@ -21,6 +21,7 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 #include <unistd.h>
 #include "dosbox.h"
 #include "debug.h"
@@ -42,6 +43,7 @@
 #include "ints/int10.h"
 #include "render.h"
 #include "pci_bus.h"
+#include "perf.h"
 
 Config * control;
 MachineType machine;
@@ -55,6 +57,7 @@ void PAGING_Init(Section *);
 void IO_Init(Section * );
 void CALLBACK_Init(Section*);
 void PROGRAMS_Init(Section*);
+void PERF_Init(Section*);
 //void CREDITS_Init(Section*);
 void RENDER_Init(Section*);
 void VGA_Init(Section*);
@@ -130,11 +133,29 @@ Bit32u ticksScheduled;
 bool ticksLocked;
 void increaseticks();
 
+/* The budget and the idle cycles at the start of the current tick, so the
+   cycles the cpu really ran can be counted once the tick is over */
+static Bit32s perf_tickbudget = 0;
+static Bit64s perf_tickidle = 0;
+static bool perf_tickcounted = true;
+
+static void PERF_CountTick(void) {
+	/* Cycles left below 0 were run past the budget, HLT and the IO delays
+	   give up the rest of their slice through CPU_IODelayRemoved */
+	Bit64s idle = CPU_IODelayRemoved - perf_tickidle;
+	if (idle < 0) idle = 0;	// the cycles controller reset it meanwhile
+	Bit64s ran = (Bit64s)perf_tickbudget - CPU_CycleLeft - idle;
+	if (ran > 0) PERF_Add(PERF_CPU_CYCLES,(Bit64u)ran);
+	perf_tickcounted = true;
+}
+
 static Bitu Normal_Loop(void) {
 	Bits ret;
 	while (1) {
 		if (PIC_RunQueue()) {
+			Bit64u start = PERF_Start();
 			ret = (*cpudecoder)();
+			PERF_Stop(PERF_HOST_CPU,start);
 			if (GCC_UNLIKELY(ret<0)) return 1;
 			if (ret>0) {
 				if (GCC_UNLIKELY(ret >= CB_MAX)) return 0;
@@ -146,8 +167,14 @@ static Bitu Normal_Loop(void) {
 #endif
 		} else {
 			GFX_Events();
+			/* Before increaseticks, which may reset CPU_IODelayRemoved */
+			if (!perf_tickcounted) PERF_CountTick();
 			if (ticksRemain>0) {
+				PERF_Add(PERF_CPU_TICKS,1);
 				TIMER_AddTick();
+				perf_tickbudget = CPU_CycleLeft;
+				perf_tickidle = CPU_IODelayRemoved;
+				perf_tickcounted = false;
 				ticksRemain--;
 			} else {increaseticks();return 0;}
 		}
@@ -157,6 +184,66 @@ static Bitu Normal_Loop(void) {
 //For trying other delays
 #define wrap_delay(a) SDL_Delay(a)
 
+/* Proportional-integral cycles controller (cycleadjust=pi).
+   It works on the logarithm of CPU_CycleMax, as the host time needed per
+   emulated millisecond grows roughly linearly with the amount of cycles.
+   The velocity form is used, so CPU_CycleMax itself is the integrator state
+   and clamping it to the limits needs no anti-windup handling. */
+#define CYCLEADJUST_PI_WINDOW	50		// ms of emulated time per evaluation
+#define CYCLEADJUST_PI_KP		0.25
+#define CYCLEADJUST_PI_KI		0.5
+#define CYCLEADJUST_PI_MAXSTEP	1.386	// log(4), largest change per evaluation
+
+static double cycleadjust_lasterror = 0.0;
+
+static void CycleAdjust_PI(void) {
+	/* Evaluate once a window has passed, or early when the host can't keep up */
+	if (ticksScheduled < CYCLEADJUST_PI_WINDOW && ticksDone < CYCLEADJUST_PI_WINDOW &&
+		!(ticksAdded > 15 && ticksScheduled >= 5)) return;
+	if (ticksDone < 1) ticksDone = 1;
+	if (ticksScheduled < 1) ticksScheduled = 1;
+
+	double used = (double)ticksDone / (double)ticksScheduled;
+	double target = (double)CPU_CycleTarget * (double)CPU_CyclePercUsed / 10000.0;
+
+	/* Cycles spent in HLT or IO delays cost next to nothing, treat the host
+	   time as if it was spent on the remaining cycles only */
+	double ratioremoved = 0.0;
+	Bit64s cproc = (Bit64s)CPU_CycleMax * (Bit64s)ticksScheduled;
+	if (cproc > 0) ratioremoved = (double)CPU_IODelayRemoved / (double)cproc;
+
+	Bit32s new_cmax = CPU_CycleMax;
+	/* Skip windows that carry no information (fully idle) and dropouts
+	   caused by the host stalling the whole process */
+	if (ratioremoved < 0.95 && used < target * 100.0 && ticksDone < 500) {
+		double used_eff = used / (1.0 - ratioremoved);
+		double error = log(target / used_eff);
+		if (error > CYCLEADJUST_PI_MAXSTEP) error = CYCLEADJUST_PI_MAXSTEP;
+		else if (error < -CYCLEADJUST_PI_MAXSTEP) error = -CYCLEADJUST_PI_MAXSTEP;
+
+		double step = CYCLEADJUST_PI_KP * (error - cycleadjust_lasterror) + CYCLEADJUST_PI_KI * error;
+		if (step > CYCLEADJUST_PI_MAXSTEP) step = CYCLEADJUST_PI_MAXSTEP;
+		else if (step < -CYCLEADJUST_PI_MAXSTEP) step = -CYCLEADJUST_PI_MAXSTEP;
+		cycleadjust_lasterror = error;
+
+		double cmax = (double)CPU_CycleMax * exp(step);
+		Bit32s limit = (CPU_CycleLimit > 0) ? CPU_CycleLimit : 2000000;
+		if (cmax > (double)limit) cmax = (double)limit;
+		new_cmax = (Bit32s)cmax;
+		if (new_cmax < CPU_CYCLES_LOWER_LIMIT) new_cmax = CPU_CYCLES_LOWER_LIMIT;
+	}
+
+	if (CPU_CycleLog)
+		LOG_MSG("CPU: cycles %d -> %d, host usage %.1f%% (target %.1f%%), removed %.1f%%, done %d sched %d",
+			CPU_CycleMax,new_cmax,used*100.0,target*100.0,ratioremoved*100.0,ticksDone,ticksScheduled);
+	CPU_CycleMax = new_cmax;
+
+	//Reset cycleguessing parameters.
+	CPU_IODelayRemoved = 0;
+	ticksDone = 0;
+	ticksScheduled = 0;
+}
+
 void increaseticks() { //Make it return ticksRemain and set it in the function above to remove the global variable.
 	if (GCC_UNLIKELY(ticksLocked)) { // For Fast Forward Mode
 		ticksRemain=5;
@@ -177,7 +264,8 @@ void increaseticks() { //Make it return ticksRemain and set it in the function a
 	if (ticksNew <= ticksLast) { //lower should not be possible, only equal.
 		ticksAdded = 0;
 
-		if (!CPU_CycleAutoAdjust || CPU_SkipCycleAutoAdjust || sleep1count < 3) {
+		if (!CPU_CycleAutoAdjust || CPU_SkipCycleAutoAdjust || sleep1count < 3 ||
+			CPU_CycleAdjustMode == CPU_CYCLEADJUST_PI) {
 			wrap_delay(1);
 		} else {
 			/* Certain configurations always give an exact sleepingtime of 1, this causes problems due to the fact that
@@ -222,11 +310,16 @@ void increaseticks() { //Make it return ticksRemain and set it in the function a
 
 	// Is the system in auto cycle mode guessing ? If not just exit. (It can be temporary disabled)
 	if (!CPU_CycleAutoAdjust || CPU_SkipCycleAutoAdjust) return;
-	
+
+	if (CPU_CycleAdjustMode == CPU_CYCLEADJUST_PI) {
+		CycleAdjust_PI();
+		return;
+	}
+
 	if (ticksScheduled >= 250 || ticksDone >= 250 || (ticksAdded > 15 && ticksScheduled >= 5) ) {
 		if(ticksDone < 1) ticksDone = 1; // Protect against div by zero
-		/* ratio we are aiming for is around 90% usage*/
-		Bit32s ratio = (ticksScheduled * (CPU_CyclePercUsed*90*1024/100/100)) / ticksDone;
+		/* ratio we are aiming for is around 90% usage (cycletarget) */
+		Bit32s ratio = (ticksScheduled * (CPU_CyclePercUsed*CPU_CycleTarget*1024/100/100)) / ticksDone;
 		Bit32s new_cmax = CPU_CycleMax;
 		Bit64s cproc = (Bit64s)CPU_CycleMax * (Bit64s)ticksScheduled;
 		double ratioremoved = 0.0; //increase scope for logging
@@ -265,16 +358,15 @@ void increaseticks() { //Make it return ticksRemain and set it in the function a
 
 		if (new_cmax < CPU_CYCLES_LOWER_LIMIT)
 			new_cmax = CPU_CYCLES_LOWER_LIMIT;
-		/*
-		LOG(LOG_MISC,LOG_ERROR)("cyclelog: current %06d   cmax %06d   ratio  %05d  done %03d   sched %03d Add %d rr %4.2f",
-			CPU_CycleMax,
-			new_cmax,
-			ratio,
-			ticksDone,
-			ticksScheduled,
-			ticksAdded,
-			ratioremoved);
-		*/
+		if (CPU_CycleLog)
+			LOG_MSG("cyclelog: current %06d   cmax %06d   ratio  %05d  done %03d   sched %03d Add %d rr %4.2f",
+				CPU_CycleMax,
+				new_cmax,
+				ratio,
+				ticksDone,
+				ticksScheduled,
+				ticksAdded,
+				ratioremoved);
 
 		/* ratios below 1% are considered to be dropouts due to
 		   temporary load imbalance, the cycles adjusting is skipped */
@@ -303,6 +395,7 @@ void increaseticks() { //Make it return ticksRemain and set it in the function a
 		CPU_CycleMax /= 3;
 		if (CPU_CycleMax < CPU_CYCLES_LOWER_LIMIT)
 			CPU_CycleMax = CPU_CYCLES_LOWER_LIMIT;
+		if (CPU_CycleLog) LOG_MSG("cyclelog: lagging, cmax lowered to %06d",CPU_CycleMax);
 	} //if (ticksScheduled >= 250 || ticksDone >= 250 || (ticksAdded > 15 && ticksScheduled >= 5) )
 }
 
@@ -441,12 +534,45 @@ void DOSBOX_Init(void) {
 	secprop->AddInitFunction(&PROGRAMS_Init);
 	secprop->AddInitFunction(&TIMER_Init);//done
 	secprop->AddInitFunction(&CMOS_Init);//done
+	secprop->AddInitFunction(&PERF_Init);
+
+	Pbool = secprop->Add_bool("perfhud",Property::Changeable::OnlyAtStart,false);
+	Pbool->Set_help("Show the performance overlay at startup. It can be toggled with Ctrl-F2.");
+
+	Pstring = secprop->Add_path("perflog",Property::Changeable::OnlyAtStart,"");
+	Pstring->Set_help("File the performance counters are appended to, one line of key=value pairs\n"
+		"per report. Leave empty to disable.");
+
+	Pint = secprop->Add_int("perfinterval",Property::Changeable::OnlyAtStart,1000);
+	Pint->SetMinMax(100,60000);
+	Pint->Set_help("Time in milliseconds between performance reports.");
 
 	secprop=control->AddSection_prop("render",&RENDER_Init,true);
 	Pint = secprop->Add_int("frameskip",Property::Changeable::Always,0);
 	Pint->SetMinMax(0,10);
 	Pint->Set_help("How many frames DOSBox skips before drawing one.");
 
+	Pstring = secprop->Add_string("framepacing",Property::Changeable::Always,"off");
+	Pstring->Set_help("Present only the newest frame for each refresh of the host display, dropping frames\n"
+		"that would never be seen instead of slowing down the emulation.\n"
+		"  'off'     presents every frame.\n"
+		"  'auto'    measures the host refresh from outputs waiting for vsync (OpenGL).\n"
+		"  <rate>    the host refresh rate in Hz, e.g. 60.");
+
+	Pint = secprop->Add_int("scalerthreads",Property::Changeable::OnlyAtStart,0);
+	Pint->SetMinMax(0,8);
+	Pint->Set_help("Number of threads running the complex scalers (advmame, advinterp, hq, 2xsai, super2xsai, supereagle).\n"
+		"0 runs them on the emulation thread.");
+
+	Pbool = secprop->Add_bool("linebatch",Property::Changeable::OnlyAtStart,true);
+	Pbool->Set_help("Draw frames of the line based machines (vgaonly, ega, cga, tandy, pcjr) in one go\n"
+		"when their last line is displayed. Once a program changes the picture while a frame is\n"
+		"displayed (raster effects), frames are drawn line by line again.");
+
+	Pbool = secprop->Add_bool("linechanges",Property::Changeable::OnlyAtStart,true);
+	Pbool->Set_help("Skip converting and scaling the lines whose video memory wasn't written since the last\n"
+		"frame. Covers the ega, vga and text modes, not the linear svga modes.");
+
 	Pbool = secprop->Add_bool("aspect",Property::Changeable::Always,false);
 	Pbool->Set_help("Do aspect correction, if your output method doesn't support scaling this can slow things down!");
 
@@ -525,6 +651,27 @@ void DOSBOX_Init(void) {
 	Pint->SetMinMax(1,1000000);
 	Pint->Set_help("Setting it lower than 100 will be a percentage.");
 
+	const char* cycleadjusts[] = { "classic", "pi", 0 };
+	Pstring = secprop->Add_string("cycleadjust",Property::Changeable::Always,"classic");
+	Pstring->Set_values(cycleadjusts);
+	Pstring->Set_help("How cycles=auto/max adjusts the amount of cycles.\n"
+		"  'classic' adjusts every 250ms with the original ratio heuristics.\n"
+		"  'pi'      adjusts every 50ms with a proportional-integral controller,\n"
+		"            which converges faster and oscillates less on loaded hosts.");
+
+	Pint = secprop->Add_int("cycletarget",Property::Changeable::Always,90);
+	Pint->SetMinMax(10,100);
+	Pint->Set_help("Percentage of host time cycles=auto/max tries to use.\n"
+		"It is combined with the percentage given in the cycles line.");
+
+	Pbool = secprop->Add_bool("cyclelog",Property::Changeable::Always,false);
+	Pbool->Set_help("Log every automatic cycles adjustment.");
+
+	Pbool = secprop->Add_bool("idledetect",Property::Changeable::Always,false);
+	Pbool->Set_help("Skip the rest of the emulated millisecond when a program waits for a key\n"
+		"(INT 16h) or signals idle (INT 28h), like the CPU does on HLT.\n"
+		"Lowers host CPU usage of idle programs, especially with cycles=max.");
+
 #if C_FPU
 	secprop->AddInitFunction(&FPU_Init);
 #endif
@@ -556,12 +703,30 @@ void DOSBOX_Init(void) {
 	Pint->SetMinMax(0,100);
 	Pint->Set_help("How many milliseconds of data to keep on top of the blocksize.");
 
+	Pbool = secprop->Add_bool("adaptiveprebuffer",Property::Changeable::OnlyAtStart,false);
+	Pbool->Set_help("Grow the prebuffer after the audio ran dry and shrink it again while it plays smoothly,\n"
+		"to find the lowest latency the host keeps up with. The prebuffer value is where it starts.");
+
+	const char *resamplers[] = {
+		"linear", "low", "medium", "high", 0};
+	Pstring = secprop->Add_string("resampler",Property::Changeable::OnlyAtStart,"linear");
+	Pstring->Set_values(resamplers);
+	Pstring->Set_help("How channels with another rate than the mixer are converted.\n"
+		"  'linear'  interpolates between two samples, the cheapest.\n"
+		"  'low', 'medium' and 'high' use a windowed sinc filter of 8, 16 or 32 taps,\n"
+		"  which removes the aliasing at the cost of more cpu time per channel.");
+
+	Pint = secprop->Add_int("autosleep",Property::Changeable::OnlyAtStart,250);
+	Pint->SetMinMax(0,10000);
+	Pint->Set_help("Milliseconds of digital silence after which the pc speaker, tandy, disney, cms, opl and synth channels\n"
+		"are no longer generated, until the program uses the device again. 0 keeps generating them.");
+
 	secprop=control->AddSection_prop("midi",&MIDI_Init,true);//done
 	secprop->AddInitFunction(&MPU401_Init,true);//done
 
 	const char* mputypes[] = { "intelligent", "uart", "none",0};
 	// FIXME: add some way to offer the actually available choices.
-	const char *devices[] = { "default", "win32", "alsa", "oss", "coreaudio", "coremidi","none", 0};
+	const char *devices[] = { "default", "win32", "alsa", "oss", "coreaudio", "coremidi","synth","none", 0};
 	Pstring = secprop->Add_string("mpu401",Property::Changeable::WhenIdle,"intelligent");
 	Pstring->Set_values(mputypes);
 	Pstring->Set_help("Type of MPU-401 to emulate.");
@@ -574,10 +739,20 @@ void DOSBOX_Init(void) {
 	Pstring->Set_help("Special configuration options for the device driver. This is usually the id or part of the name of the device you want to use\n"
 	                  "(find the id/name with mixer/listmidi).\n"
 	                  "Or in the case of coreaudio, you can specify a soundfont here.\n"
+	                  "Or in the case of synth, the SoundFont 2 (.sf2) file to play the music with.\n"
 	                  "When using a Roland MT-32 rev. 0 as midi output device, some games may require a delay in order to prevent 'buffer overflow' issues.\n"
 	                  "In that case, add 'delaysysex', for example: midiconfig=2 delaysysex\n"
 	                  "See the README/Manual for more details.");
 
+	Pint = secprop->Add_int("synthvoices",Property::Changeable::WhenIdle,64);
+	Pint->SetMinMax(1,256);
+	Pint->Set_help("Most notes the synth device plays at once, more take over the quietest ones.");
+
+	Pint = secprop->Add_int("synththreads",Property::Changeable::WhenIdle,0);
+	Pint->SetMinMax(0,8);
+	Pint->Set_help("Number of threads rendering the voices of the synth device, on top of the emulation thread.\n"
+		"0 renders them all on the emulation thread.");
+
 #if C_DEBUG
 	secprop=control->AddSection_prop("debug",&DEBUG_Init);
 #endif
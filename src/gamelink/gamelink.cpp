@@ -484,6 +484,111 @@ void GameLink::Term()
 	g_membase_size = 0;
 }
 
+//
+// lock_mutex
+//
+// Take the shared memory mutex. With wait false this never blocks, and fails
+// if the client (or our presentation thread) holds the mutex.
+//
+// \returns true if the mutex is now held.
+//
+static bool lock_mutex( const bool wait )
+{
+#ifdef WIN32
+
+	DWORD mutex_result;
+	mutex_result = WaitForSingleObject( g_mutex_handle, wait ? INFINITE : 0 );
+	return ( mutex_result == WAIT_OBJECT_0 );
+
+#else // WIN32
+
+	int mutex_result;
+	mutex_result = wait ? sem_wait( g_mutex_handle ) : sem_trywait( g_mutex_handle );
+	if ( mutex_result < 0 )
+	{
+		if ( wait || errno != EAGAIN ) {
+			LOG_MSG( "GAMELINK: MUTEX lock failed with %d. errno = %d", mutex_result, errno );
+		}
+		return false;
+	}
+	return true;
+
+#endif // WIN32
+}
+
+//
+// unlock_mutex
+//
+// Release the shared memory mutex.
+//
+static void unlock_mutex()
+{
+#ifdef WIN32
+
+	ReleaseMutex( g_mutex_handle );
+
+#else // WIN32
+
+	int mutex_result;
+	mutex_result = sem_post( g_mutex_handle );
+	if ( mutex_result < 0 ) {
+		LOG_MSG( "GAMELINK: MUTEX unlock failed with %d. errno = %d", mutex_result, errno );
+	}
+
+#endif // WIN32
+}
+
+//
+// make_par
+//
+// Create an integer pixel aspect ratio.
+//
+static void make_par( const double source_ratio, Bit16u& par_x, Bit16u& par_y )
+{
+	if ( source_ratio >= 1.0 )
+	{
+		par_x = 4096;
+		par_y = static_cast< Bit16u >( source_ratio * 4096.0 );
+	}
+	else
+	{
+		par_x = static_cast< Bit16u >( 4096.0 / source_ratio );
+		par_y = 4096;
+	}
+}
+
+//
+// write_frame
+//
+// Copy a frame into shared memory, the mutex must be held.
+//
+static void write_frame( const Bit16u frame_width,
+						 const Bit16u frame_height,
+						 const double source_ratio,
+						 const Bit8u* p_frame )
+{
+	Bit16u par_x, par_y;
+	make_par( source_ratio, par_x, par_y );
+
+	// Update the frame sequence
+	++g_p_shared_memory->frame.seq;
+
+	// Copy frame properties
+	g_p_shared_memory->frame.image_fmt = 1; // = 32-bit RGBA
+	g_p_shared_memory->frame.width = frame_width;
+	g_p_shared_memory->frame.height = frame_height;
+	g_p_shared_memory->frame.par_x = par_x;
+	g_p_shared_memory->frame.par_y = par_y;
+
+	// Frame Buffer
+	Bit32u payload;
+	payload = frame_width * frame_height * 4;
+	if ( frame_width <= GameLink::sSharedMMapFrame_R1::MAX_WIDTH && frame_height <= GameLink::sSharedMMapFrame_R1::MAX_HEIGHT )
+	{
+		memcpy( g_p_shared_memory->frame.buffer, p_frame, payload );
+	}
+}
+
 //------------------------------------------------------------------------------
 // GameLink::In
 //------------------------------------------------------------------------------
@@ -543,19 +648,6 @@ void GameLink::Out( const Bit16u frame_width,
 		return; // <=== EARLY OUT
 	}
 
-	// Create integer ratio
-	Bit16u par_x, par_y;
-	if ( source_ratio >= 1.0 )
-	{
-		par_x = 4096;
-		par_y = static_cast< Bit16u >( source_ratio * 4096.0 );
-	}
-	else
-	{
-		par_x = static_cast< Bit16u >( 4096.0 / source_ratio );
-		par_y = 4096;
-	}
-
 	// Build flags
 	Bit8u flags;
 
@@ -584,24 +676,9 @@ void GameLink::Out( const Bit16u frame_width,
 	sSharedMMapBuffer_R1 proc_mech_buffer;
 	proc_mech_buffer.payload = 0;
 
-#ifdef WIN32
-
-	DWORD mutex_result;
-	mutex_result = WaitForSingleObject( g_mutex_handle, INFINITE );
-	if ( mutex_result == WAIT_OBJECT_0 )
-
-#else // WIN32
-
-	int mutex_result;
-	mutex_result = sem_wait( g_mutex_handle );
-	if ( mutex_result < 0 )
-	{
-		LOG_MSG( "GAMELINK: MUTEX lock failed with %d. errno = %d", mutex_result, errno );
-	}
-	else
-
-#endif // WIN32
-
+	// Without a frame the call must not block, the frame is published by the
+	// presentation thread (see OutFrame) which holds the mutex while copying it.
+	if ( lock_mutex( p_frame != NULL || g_trackonly_mode ) )
 	{
 //		printf( "GAMELINK: MUTEX lock ok\n" );
 
@@ -620,25 +697,9 @@ void GameLink::Out( const Bit16u frame_width,
 			// Store flags
 			g_p_shared_memory->flags = flags;
 
-			if ( g_trackonly_mode == false )
+			if ( g_trackonly_mode == false && p_frame )
 			{
-				// Update the frame sequence
-				++g_p_shared_memory->frame.seq;
-
-				// Copy frame properties
-				g_p_shared_memory->frame.image_fmt = 1; // = 32-bit RGBA
-				g_p_shared_memory->frame.width = frame_width;
-				g_p_shared_memory->frame.height = frame_height;
-				g_p_shared_memory->frame.par_x = par_x;
-				g_p_shared_memory->frame.par_y = par_y;
-
-				// Frame Buffer
-				Bit32u payload;
-				payload = frame_width * frame_height * 4;
-				if ( frame_width <= sSharedMMapFrame_R1::MAX_WIDTH && frame_height <= sSharedMMapFrame_R1::MAX_HEIGHT )
-				{
-					memcpy( g_p_shared_memory->frame.buffer, p_frame, payload );
-				}
+				write_frame( frame_width, frame_height, source_ratio, p_frame );
 			}
 
 			// Peek
@@ -673,20 +734,7 @@ void GameLink::Out( const Bit16u frame_width,
 
 		} // ========================
 
-#ifdef WIN32
-
-		ReleaseMutex( g_mutex_handle );
-
-#else // WIN32
-
-		mutex_result = sem_post( g_mutex_handle );
-		if ( mutex_result < 0 ) {
-			LOG_MSG( "GAMELINK: MUTEX unlock failed with %d. errno = %d", mutex_result, errno );
-		} else {
-//			printf( "GAMELINK: MUTEX unlock ok.\n" );
-		}
-
-#endif // WIN32
+		unlock_mutex();
 
 		// Mechanical Message Processing, out of mutex.
 		if ( proc_mech_buffer.payload )
@@ -695,6 +743,26 @@ void GameLink::Out( const Bit16u frame_width,
 
 }
 
+//------------------------------------------------------------------------------
+// GameLink::OutFrame
+//------------------------------------------------------------------------------
+void GameLink::OutFrame( const Bit16u frame_width,
+						 const Bit16u frame_height,
+						 const double source_ratio,
+						 const Bit8u* p_frame )
+{
+	// Not initialised (or disabled) ?
+	if ( g_p_shared_memory == NULL || g_trackonly_mode ) {
+		return; // <=== EARLY OUT
+	}
+
+	if ( lock_mutex( true ) )
+	{
+		write_frame( frame_width, frame_height, source_ratio, p_frame );
+		unlock_mutex();
+	}
+}
+
 //==============================================================================
 #endif // C_GAMELINK
 
@@ -151,6 +151,8 @@ namespace GameLink
 	extern int In( sSharedMMapInput_R2* p_input,
 				   sSharedMMapAudio_R1* p_audio );
 
+	// Pass p_frame as NULL when frames are sent with OutFrame, Out then
+	// skips its update rather than wait for the shared memory mutex.
 	extern void Out( const Bit16u frame_width,
 					 const Bit16u frame_height,
 					 const double source_ratio,
@@ -160,6 +162,11 @@ namespace GameLink
 					 const Bit8u* p_frame,
 					 const Bit8u* p_sysmem );
 
+	extern void OutFrame( const Bit16u frame_width,
+						  const Bit16u frame_height,
+						  const double source_ratio,
+						  const Bit8u* p_frame );
+
 	extern void ExecTerminal( sSharedMMapBuffer_R1* p_inbuf,
 							  sSharedMMapBuffer_R1* p_outbuf,
 							  sSharedMMapBuffer_R1* p_mechbuf );
@@ -23,6 +23,7 @@
 #include "../resource.h"
 #include <stdio.h>
 #include "mem.h"
+#include "perf.h"
 
 typedef GameLink::sSharedMMapBuffer_R1	Buffer;
 
@@ -227,6 +228,14 @@ void GameLink::ExecTerminal( Buffer* p_inbuf,
 		Bit16u payload = p_inbuf->payload;
 		p_inbuf->payload = 0;
 
+		// Queries are answered right away, while the mutex is held.
+		if ( payload >= 5 && memcmp( p_inbuf->data, ":perf", 5 ) == 0 &&
+			 ( payload == 5 || p_inbuf->data[ 5 ] == 0 ) )
+		{
+			out_strcpy( PERF_GetReport() );
+			return;
+		}
+
 		// Copy out.
 		memcpy( p_procbuf->data, p_inbuf->data, payload );
 		p_procbuf->payload = payload;
@@ -29,6 +29,7 @@
 #include "cross.h"
 #include "support.h"
 #include "setup.h"
+#include "control.h"
 #include "mapper.h"
 #include "pic.h"
 #include "hardware.h"
@@ -71,6 +72,8 @@ MidiHandler Midi_none;
 /* Include different midi drivers, lowest ones get checked first for default.
    Each header provides an independent midi interface. */
 
+#include "midi_synth.h"
+
 #if defined(MACOSX)
 
 #if defined(C_SUPPORTS_COREMIDI)
@@ -0,0 +1,836 @@
+/*
+ *  Copyright (C) 2002-2020  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Built-in General MIDI synthesizer, playing the instruments of the
+   SoundFont 2 file given as midiconfig through its own mixer channel. It
+   needs no midi device on the host and is captured with the other sound.
+   Voices are rendered on the emulation thread in blocks of SYNTH_BLOCK
+   frames, midi messages take effect at the next block. With synththreads
+   the voices of a block are split over worker threads.
+   Supported are the sample, tuning, range, volume envelope, vibrato lfo and
+   lowpass filter generators and the default modulators of velocity, volume,
+   expression, pan, modulation wheel and pitch bend. The modulation envelope
+   and lfo, reverb and chorus and the modulators of the file are not. */
+
+#include <math.h>
+#include <stdio.h>
+#include <atomic>
+#include <map>
+#include <vector>
+
+#include "mixer.h"
+#include "mem.h"
+
+#define SYNTH_RATE			44100
+#define SYNTH_BLOCK			64
+#define SYNTH_MAXVOICES		256
+#define SYNTH_MAXTHREADS	8
+/* Envelope level below which a voice is no longer heard, -80 dB */
+#define SYNTH_SILENT		0.0001f
+
+/* Generators of the SoundFont 2.01 specification */
+enum {
+	SF_START = 0, SF_END = 1, SF_LOOPSTART = 2, SF_LOOPEND = 3, SF_STARTCOARSE = 4,
+	SF_VIBLFOTOPITCH = 6, SF_FILTERFC = 8, SF_FILTERQ = 9, SF_ENDCOARSE = 12,
+	SF_PAN = 17, SF_DELAYVIBLFO = 23, SF_FREQVIBLFO = 24,
+	SF_DELAYVOLENV = 33, SF_ATTACKVOLENV = 34, SF_HOLDVOLENV = 35, SF_DECAYVOLENV = 36,
+	SF_SUSTAINVOLENV = 37, SF_RELEASEVOLENV = 38, SF_KEYTOVOLENVHOLD = 39, SF_KEYTOVOLENVDECAY = 40,
+	SF_INSTRUMENT = 41, SF_KEYRANGE = 43, SF_VELRANGE = 44, SF_LOOPSTARTCOARSE = 45,
+	SF_KEYNUM = 46, SF_VELOCITY = 47, SF_ATTENUATION = 48, SF_LOOPENDCOARSE = 50,
+	SF_COARSETUNE = 51, SF_FINETUNE = 52, SF_SAMPLEID = 53, SF_SAMPLEMODES = 54,
+	SF_SCALETUNING = 56, SF_EXCLUSIVECLASS = 57, SF_ROOTKEY = 58, SF_GENERATORS = 61
+};
+
+/* Generators only an instrument zone can set, a preset zone adds to the others */
+static bool SF_InstrumentOnly(Bitu gen) {
+	switch (gen) {
+	case SF_START: case SF_END: case SF_LOOPSTART: case SF_LOOPEND:
+	case SF_STARTCOARSE: case SF_ENDCOARSE: case SF_LOOPSTARTCOARSE: case SF_LOOPENDCOARSE:
+	case SF_KEYNUM: case SF_VELOCITY: case SF_SAMPLEID: case SF_SAMPLEMODES:
+	case SF_EXCLUSIVECLASS: case SF_ROOTKEY:
+		return true;
+	}
+	return false;
+}
+
+static float SF_Seconds(Bits timecents) {
+	return powf(2.0f,timecents / 1200.0f);
+}
+
+/* Attenuation in centibels to amplitude */
+static float SF_Gain(float centibels) {
+	return powf(10.0f,-centibels / 200.0f);
+}
+
+struct SynthSample {
+	Bit32u start, end, loopStart, loopEnd;
+	Bit32u rate;
+	Bit8u originalPitch;
+	Bit8s correction;
+};
+
+/* A preset zone combined with one of the zones of its instrument */
+struct SynthZone {
+	Bit8u keyLo, keyHi, velLo, velHi;
+	Bit32s gen[SF_GENERATORS];
+};
+
+struct SynthPreset {
+	Bitu first, count;		// zones
+};
+
+struct SynthChannel {
+	Bitu bank, program;
+	const SynthPreset * preset;
+	Bit8u volume, expression, pan, modulation;
+	Bitu bend;				// 0x2000 is the center
+	Bitu bendRange;			// cents
+	Bitu rpn;				// selected registered parameter, 0x3fff none
+	bool sustain;
+	/* Updated every block from the controllers */
+	float gain, bendCents;
+};
+
+enum SynthStage {
+	SYNTH_OFF, SYNTH_DELAY, SYNTH_ATTACK, SYNTH_HOLD, SYNTH_DECAY, SYNTH_SUSTAIN, SYNTH_RELEASE
+};
+
+struct SynthVoice {
+	SynthStage stage;
+	Bit8u channel, key;
+	bool sustained;			// note off came while the sustain pedal was down
+	Bitu age;
+	Bitu exclusiveClass;
+	/* Sample position in 32.32 fixed point */
+	Bit64u pos;
+	Bit32u end, loopStart, loopEnd;
+	bool loop, loopRelease;
+	float step;				// sample steps per frame without bend and vibrato
+	float gain, pan;
+	/* Volume envelope, level is the amplitude */
+	float level, left;		// seconds left of the delay or hold
+	float attack, hold, decay, sustain, release;
+	/* Vibrato lfo */
+	float vibDelay, vibFreq, vibDepth, vibPhase;
+	/* Lowpass filter, direct form 2 transposed */
+	bool filter;
+	float b0, b1, b2, a1, a2, z1, z2;
+	/* Output gain at the end of the last block, ramped from there */
+	float out[2];
+};
+
+class MidiHandler_synth;
+
+static struct {
+	Bitu count;
+	SDL_Thread * thread[SYNTH_MAXTHREADS];
+	SDL_sem * work;			// posted for every worker that has to render
+	SDL_sem * done;			// posted for every worker that finished
+	volatile bool quit;
+	Bitu parts;				// the voices of the block are split in this many parts
+	std::atomic<Bitu> next;	// next part to be taken by a worker
+	MidiHandler_synth * synth;
+} synthThreads;
+
+static void SYNTH_CallBack(Bitu len);
+static int SYNTH_Thread(void * data);
+
+class MidiHandler_synth : public MidiHandler {
+private:
+	std::vector<Bit16s> pool;
+	std::vector<SynthSample> samples;
+	std::vector<SynthZone> zones;
+	std::vector<SynthPreset> presets;
+	std::map<Bitu,Bitu> presetMap;	// bank << 7 | program to index in presets
+	SynthChannel channels[16];
+	SynthVoice voices[SYNTH_MAXVOICES];
+	Bitu maxVoices;
+	Bitu age;
+	/* Voices rendered this block */
+	Bitu active[SYNTH_MAXVOICES];
+	Bitu activeCount;
+	float mix[SYNTH_MAXTHREADS + 1][SYNTH_BLOCK * 2];
+	Bit32s block[SYNTH_BLOCK][2];
+	Bitu blockPos;
+	MixerChannel * chan;
+
+	static Bit16u Read16(const Bit8u * data) { return host_readw((HostPt)data); }
+	static Bit32u Read32(const Bit8u * data) { return host_readd((HostPt)data); }
+
+	/* Finds a chunk in the list, returns its size or -1 */
+	static Bits FindChunk(const Bit8u * data,Bitu size,const char * id,const char * type,const Bit8u * & found) {
+		Bitu pos = 0;
+		while (pos + 8 <= size) {
+			Bitu len = Read32(data + pos + 4);
+			if (len > size - pos - 8) len = size - pos - 8;
+			if (!memcmp(data + pos,id,4) && (!type || (len >= 4 && !memcmp(data + pos + 8,type,4)))) {
+				found = data + pos + 8 + (type ? 4 : 0);
+				return (Bits)(type ? len - 4 : len);
+			}
+			pos += 8 + len + (len & 1);
+		}
+		return -1;
+	}
+
+	/* Sets the generators of a zone, false if it has no sample or instrument */
+	static bool ReadZone(const Bit8u * gens,Bitu first,Bitu last,Bitu linkGen,SynthZone & zone) {
+		bool linked = false;
+		for (Bitu g = first;g < last;g++) {
+			Bitu oper = Read16(gens + g * 4);
+			const Bit8u * amount = gens + g * 4 + 2;
+			if (oper == SF_KEYRANGE) {
+				zone.keyLo = amount[0];
+				zone.keyHi = amount[1];
+			} else if (oper == SF_VELRANGE) {
+				zone.velLo = amount[0];
+				zone.velHi = amount[1];
+			} else if (oper < SF_GENERATORS) {
+				zone.gen[oper] = (oper == linkGen || oper == SF_SAMPLEMODES) ? Read16(amount) : (Bit16s)Read16(amount);
+				if (oper == linkGen) {
+					linked = true;
+					/* The link generator is the last one of a zone */
+					break;
+				}
+			}
+		}
+		return linked;
+	}
+
+	static void DefaultZone(SynthZone & zone,bool instrument) {
+		memset(&zone,0,sizeof(zone));
+		zone.keyHi = zone.velHi = 127;
+		if (!instrument) return;
+		zone.gen[SF_FILTERFC] = 13500;
+		zone.gen[SF_DELAYVIBLFO] = -12000;
+		for (Bitu g = SF_DELAYVOLENV;g <= SF_RELEASEVOLENV;g++)
+			if (g != SF_SUSTAINVOLENV) zone.gen[g] = -12000;
+		zone.gen[SF_KEYNUM] = zone.gen[SF_VELOCITY] = zone.gen[SF_ROOTKEY] = -1;
+		zone.gen[SF_SCALETUNING] = 100;
+	}
+
+	bool Load(const char * name) {
+		FILE * file = fopen(name,"rb");
+		if (!file) return false;
+		std::vector<Bit8u> data;
+		Bit8u buf[65536];
+		size_t read;
+		while ((read = fread(buf,1,sizeof(buf),file)) > 0) data.insert(data.end(),buf,buf + read);
+		fclose(file);
+		if (data.size() < 12 || memcmp(&data[0],"RIFF",4) || memcmp(&data[8],"sfbk",4)) {
+			LOG_MSG("MIDI:synth: %s is not a SoundFont 2 file",name);
+			return false;
+		}
+		const Bit8u * riff = &data[12];
+		Bitu riffSize = data.size() - 12;
+		const Bit8u * sdta, * pdta, * smpl;
+		Bits sdtaSize = FindChunk(riff,riffSize,"LIST","sdta",sdta);
+		Bits pdtaSize = FindChunk(riff,riffSize,"LIST","pdta",pdta);
+		Bits smplSize = sdtaSize < 0 ? -1 : FindChunk(sdta,sdtaSize,"smpl",0,smpl);
+		static const char * const hydraNames[9] = { "phdr","pbag","pmod","pgen","inst","ibag","imod","igen","shdr" };
+		static const Bitu hydraSizes[9] = { 38, 4, 10, 4, 22, 4, 10, 4, 46 };
+		const Bit8u * hydra[9];
+		Bitu hydraCount[9];
+		bool valid = smplSize > 0 && pdtaSize > 0;
+		for (Bitu i = 0;valid && i < 9;i++) {
+			Bits size = FindChunk(pdta,pdtaSize,hydraNames[i],0,hydra[i]);
+			/* Every list ends with a terminal record */
+			valid = size >= (Bits)hydraSizes[i];
+			if (valid) hydraCount[i] = size / hydraSizes[i];
+		}
+		if (!valid) {
+			LOG_MSG("MIDI:synth: %s is damaged",name);
+			return false;
+		}
+
+		/* Sample data with room for reading past the end of the last one */
+		pool.resize(smplSize / 2 + 64);
+		for (Bitu i = 0;i < (Bitu)smplSize / 2;i++) pool[i] = (Bit16s)Read16(smpl + i * 2);
+		samples.resize(hydraCount[8] - 1);
+		for (Bitu i = 0;i < samples.size();i++) {
+			const Bit8u * shdr = hydra[8] + i * 46 + 20;
+			SynthSample & s = samples[i];
+			s.start = Read32(shdr);
+			s.end = Read32(shdr + 4);
+			s.loopStart = Read32(shdr + 8);
+			s.loopEnd = Read32(shdr + 12);
+			s.rate = Read32(shdr + 16);
+			s.originalPitch = shdr[20];
+			s.correction = (Bit8s)shdr[21];
+			if (s.end > (Bitu)smplSize / 2) s.end = (Bit32u)(smplSize / 2);
+			if (s.start > s.end) s.start = s.end;
+			if (!s.rate) s.rate = SYNTH_RATE;
+		}
+
+		const Bit8u * phdr = hydra[0], * pbag = hydra[1], * pgen = hydra[3];
+		const Bit8u * inst = hydra[4], * ibag = hydra[5], * igen = hydra[7];
+		for (Bitu p = 0;p + 1 < hydraCount[0];p++) {
+			SynthPreset preset;
+			preset.first = zones.size();
+			Bitu program = Read16(phdr + p * 38 + 20);
+			Bitu bank = Read16(phdr + p * 38 + 22);
+			Bitu bagFirst = Read16(phdr + p * 38 + 24);
+			Bitu bagLast = Read16(phdr + p * 38 + 38 + 24);
+			SynthZone presetGlobal;
+			DefaultZone(presetGlobal,false);
+			for (Bitu b = bagFirst;b < bagLast && b + 1 < hydraCount[1];b++) {
+				SynthZone pz = presetGlobal;
+				Bitu genLast = Read16(pbag + b * 4 + 4);
+				if (genLast > hydraCount[3]) genLast = hydraCount[3];
+				if (!ReadZone(pgen,Read16(pbag + b * 4),genLast,SF_INSTRUMENT,pz)) {
+					if (b == bagFirst) presetGlobal = pz;
+					continue;
+				}
+				Bitu i = pz.gen[SF_INSTRUMENT];
+				if (i + 1 >= hydraCount[4]) continue;
+				SynthZone instGlobal;
+				DefaultZone(instGlobal,true);
+				Bitu ibagFirst = Read16(inst + i * 22 + 20);
+				Bitu ibagLast = Read16(inst + i * 22 + 22 + 20);
+				for (Bitu ib = ibagFirst;ib < ibagLast && ib + 1 < hydraCount[5];ib++) {
+					SynthZone iz = instGlobal;
+					Bitu igenLast = Read16(ibag + ib * 4 + 4);
+					if (igenLast > hydraCount[7]) igenLast = hydraCount[7];
+					if (!ReadZone(igen,Read16(ibag + ib * 4),igenLast,SF_SAMPLEID,iz)) {
+						if (ib == ibagFirst) instGlobal = iz;
+						continue;
+					}
+					if ((Bitu)iz.gen[SF_SAMPLEID] >= samples.size()) continue;
+					SynthZone zone = iz;
+					zone.keyLo = std::max(iz.keyLo,pz.keyLo);
+					zone.keyHi = std::min(iz.keyHi,pz.keyHi);
+					zone.velLo = std::max(iz.velLo,pz.velLo);
+					zone.velHi = std::min(iz.velHi,pz.velHi);
+					if (zone.keyLo > zone.keyHi || zone.velLo > zone.velHi) continue;
+					for (Bitu g = 0;g < SF_GENERATORS;g++)
+						if (!SF_InstrumentOnly(g) && g != SF_INSTRUMENT) zone.gen[g] += pz.gen[g];
+					zones.push_back(zone);
+				}
+			}
+			preset.count = zones.size() - preset.first;
+			Bitu key = (bank << 7) | (program & 0x7f);
+			if (bank <= 128 && !presetMap.count(key)) {
+				presetMap[key] = presets.size();
+				presets.push_back(preset);
+			}
+		}
+		if (presets.empty()) {
+			LOG_MSG("MIDI:synth: %s has no instruments",name);
+			return false;
+		}
+		LOG_MSG("MIDI:synth: Loaded %s, %d presets with %d zones",name,(int)presets.size(),(int)zones.size());
+		return true;
+	}
+
+	/* The preset of a bank and program, or the nearest the soundfont has */
+	const SynthPreset * FindPreset(Bitu bank,Bitu program) const {
+		std::map<Bitu,Bitu>::const_iterator it = presetMap.find((bank << 7) | program);
+		if (it == presetMap.end()) it = presetMap.find(bank == 128 ? (128 << 7) : program);
+		if (it == presetMap.end()) it = presetMap.begin();
+		return &presets[it->second];
+	}
+
+	void ResetChannel(Bitu c) {
+		SynthChannel & ch = channels[c];
+		ch.bank = (c == 9) ? 128 : 0;
+		ch.program = 0;
+		ch.preset = FindPreset(ch.bank,0);
+		ch.volume = 100;
+		ch.pan = 64;
+		ResetControllers(c);
+	}
+
+	void ResetControllers(Bitu c) {
+		SynthChannel & ch = channels[c];
+		ch.expression = 127;
+		ch.modulation = 0;
+		ch.bend = 0x2000;
+		ch.bendRange = 200;
+		ch.rpn = 0x3fff;
+		ch.sustain = false;
+	}
+
+	void Reset(void) {
+		for (Bitu v = 0;v < SYNTH_MAXVOICES;v++) voices[v].stage = SYNTH_OFF;
+		for (Bitu c = 0;c < 16;c++) ResetChannel(c);
+	}
+
+	void Release(SynthVoice & v) {
+		v.stage = SYNTH_RELEASE;
+		v.sustained = false;
+		if (v.loopRelease) v.loop = false;
+	}
+
+	/* A free voice, or the one that will be missed least */
+	SynthVoice & Allocate(void) {
+		SynthVoice * best = 0;
+		float bestScore = 0;
+		for (Bitu v = 0;v < maxVoices;v++) {
+			SynthVoice & voice = voices[v];
+			if (voice.stage == SYNTH_OFF) return voice;
+			/* Releasing voices go first, then the quietest, then the oldest */
+			float score = voice.level * voice.gain + (voice.stage == SYNTH_RELEASE ? 0.0f : 1.0f);
+			if (!best || score < bestScore || (score == bestScore && voice.age < best->age)) {
+				best = &voice;
+				bestScore = score;
+			}
+		}
+		return *best;
+	}
+
+	void NoteOn(Bitu c,Bitu key,Bitu vel) {
+		const SynthChannel & ch = channels[c];
+		const SynthPreset & preset = *ch.preset;
+		/* Voices of this note, from layered or stereo zones, are at least this old */
+		Bitu first = age;
+		/* A new note on a key still playing ends the old one */
+		for (Bitu v = 0;v < maxVoices;v++) {
+			SynthVoice & voice = voices[v];
+			if (voice.stage != SYNTH_OFF && voice.stage != SYNTH_RELEASE && voice.channel == c && voice.key == key)
+				Release(voice);
+		}
+		for (Bitu z = preset.first;z < preset.first + preset.count;z++) {
+			const SynthZone & zone = zones[z];
+			if (key < zone.keyLo || key > zone.keyHi || vel < zone.velLo || vel > zone.velHi) continue;
+			const Bit32s * gen = zone.gen;
+			const SynthSample & s = samples[gen[SF_SAMPLEID]];
+			/* Notes of the same exclusive class cut each other off, like an open and closed hihat */
+			if (gen[SF_EXCLUSIVECLASS]) {
+				for (Bitu v = 0;v < maxVoices;v++) {
+					SynthVoice & voice = voices[v];
+					if (voice.stage != SYNTH_OFF && voice.channel == c && voice.age < first &&
+						voice.exclusiveClass == (Bitu)gen[SF_EXCLUSIVECLASS])
+						voice.stage = SYNTH_OFF;
+				}
+			}
+			Bits limit = (Bits)(pool.size() - 64);
+			Bits start = (Bits)s.start + gen[SF_START] + gen[SF_STARTCOARSE] * 32768;
+			Bits end = (Bits)s.end + gen[SF_END] + gen[SF_ENDCOARSE] * 32768;
+			Bits loopStart = (Bits)s.loopStart + gen[SF_LOOPSTART] + gen[SF_LOOPSTARTCOARSE] * 32768;
+			Bits loopEnd = (Bits)s.loopEnd + gen[SF_LOOPEND] + gen[SF_LOOPENDCOARSE] * 32768;
+			if (end > limit) end = limit;
+			if (start < 0) start = 0;
+			if (start + 1 >= end) continue;
+
+			SynthVoice & v = Allocate();
+			v.channel = (Bit8u)c;
+			v.key = (Bit8u)key;
+			v.sustained = false;
+			v.age = age++;
+			v.exclusiveClass = gen[SF_EXCLUSIVECLASS];
+			v.pos = (Bit64u)start << 32;
+			v.end = (Bit32u)end;
+			Bitu mode = gen[SF_SAMPLEMODES] & 3;
+			v.loop = (mode == 1 || mode == 3) && loopStart >= start && loopEnd <= end && loopEnd > loopStart + 1;
+			v.loopRelease = (mode == 3);
+			v.loopStart = (Bit32u)loopStart;
+			v.loopEnd = (Bit32u)loopEnd;
+
+			Bits root = gen[SF_ROOTKEY] >= 0 ? gen[SF_ROOTKEY] : (s.originalPitch <= 127 ? s.originalPitch : 60);
+			Bits pitchKey = gen[SF_KEYNUM] >= 0 ? gen[SF_KEYNUM] : (Bits)key;
+			float cents = (float)((pitchKey - root) * gen[SF_SCALETUNING] + gen[SF_COARSETUNE] * 100 + gen[SF_FINETUNE] + s.correction);
+			v.step = (float)s.rate / SYNTH_RATE * powf(2.0f,cents / 1200.0f);
+
+			/* Attenuation counts for 0.4 like on the EMU hardware the format comes from,
+			   velocity follows the concave curve of the default modulator */
+			Bits velocity = gen[SF_VELOCITY] >= 0 ? gen[SF_VELOCITY] : (Bits)vel;
+			float velAtten = velocity ? -400.0f * log10f(velocity / 127.0f) : 960.0f;
+			if (velAtten > 960.0f) velAtten = 960.0f;
+			float atten = gen[SF_ATTENUATION] * 0.4f + velAtten;
+			v.gain = atten > 0 ? SF_Gain(atten) : 1.0f;
+			v.pan = (float)gen[SF_PAN];
+
+			v.stage = SYNTH_DELAY;
+			v.level = 0;
+			v.left = SF_Seconds(gen[SF_DELAYVOLENV]);
+			v.attack = SF_Seconds(gen[SF_ATTACKVOLENV]);
+			v.hold = SF_Seconds(gen[SF_HOLDVOLENV] + gen[SF_KEYTOVOLENVHOLD] * (60 - (Bits)key));
+			v.decay = SF_Seconds(gen[SF_DECAYVOLENV] + gen[SF_KEYTOVOLENVDECAY] * (60 - (Bits)key));
+			v.sustain = gen[SF_SUSTAINVOLENV] > 0 ? SF_Gain((float)gen[SF_SUSTAINVOLENV]) : 1.0f;
+			v.release = SF_Seconds(gen[SF_RELEASEVOLENV]);
+
+			v.vibDelay = SF_Seconds(gen[SF_DELAYVIBLFO]);
+			v.vibFreq = 8.176f * SF_Seconds(gen[SF_FREQVIBLFO]);
+			v.vibDepth = (float)gen[SF_VIBLFOTOPITCH];
+			v.vibPhase = 0;
+
+			/* Velocity closes the filter up to two octaves */
+			float fc = gen[SF_FILTERFC] - 2400.0f * (127 - velocity) / 127.0f;
+			v.filter = fc < 13500.0f;
+			v.z1 = v.z2 = 0;
+			if (v.filter) {
+				float hz = 8.176f * powf(2.0f,fc / 1200.0f);
+				if (hz > SYNTH_RATE * 0.45f) hz = SYNTH_RATE * 0.45f;
+				if (hz < 5.0f) hz = 5.0f;
+				float q = powf(10.0f,(gen[SF_FILTERQ] / 10.0f - 3.01f) / 20.0f);
+				float w = 2.0f * 3.14159265f * hz / SYNTH_RATE;
+				float alpha = sinf(w) / (2.0f * q);
+				float a0 = 1.0f + alpha;
+				v.b1 = (1.0f - cosf(w)) / a0;
+				v.b0 = v.b2 = v.b1 * 0.5f;
+				v.a1 = -2.0f * cosf(w) / a0;
+				v.a2 = (1.0f - alpha) / a0;
+			}
+			v.out[0] = v.out[1] = 0;
+		}
+	}
+
+	void NoteOff(Bitu c,Bitu key) {
+		for (Bitu v = 0;v < maxVoices;v++) {
+			SynthVoice & voice = voices[v];
+			if (voice.stage == SYNTH_OFF || voice.stage == SYNTH_RELEASE || voice.channel != c || voice.key != key) continue;
+			if (channels[c].sustain) voice.sustained = true;
+			else Release(voice);
+		}
+	}
+
+	void Controller(Bitu c,Bitu cc,Bitu val) {
+		SynthChannel & ch = channels[c];
+		switch (cc) {
+		case 0x00:	/* Bank select, the drum channel keeps its bank */
+			if (c != 9) ch.bank = val;
+			break;
+		case 0x01:
+			ch.modulation = (Bit8u)val;
+			break;
+		case 0x06:	/* Data entry, only the pitch bend range is known */
+			if (ch.rpn == 0) ch.bendRange = val * 100 + (ch.bendRange % 100);
+			break;
+		case 0x26:
+			if (ch.rpn == 0) ch.bendRange = (ch.bendRange / 100) * 100 + (val < 100 ? val : 99);
+			break;
+		case 0x07:
+			ch.volume = (Bit8u)val;
+			break;
+		case 0x0a:
+			ch.pan = (Bit8u)val;
+			break;
+		case 0x0b:
+			ch.expression = (Bit8u)val;
+			break;
+		case 0x40:
+			ch.sustain = val >= 64;
+			if (!ch.sustain) {
+				for (Bitu v = 0;v < maxVoices;v++)
+					if (voices[v].stage != SYNTH_OFF && voices[v].channel == c && voices[v].sustained) Release(voices[v]);
+			}
+			break;
+		case 0x62: case 0x63:	/* NRPN selection */
+			ch.rpn = 0x3fff;
+			break;
+		case 0x64:
+			ch.rpn = (ch.rpn & 0x3f80) | val;
+			break;
+		case 0x65:
+			ch.rpn = (ch.rpn & 0x7f) | (val << 7);
+			break;
+		case 0x78:	/* All sound off */
+			for (Bitu v = 0;v < maxVoices;v++)
+				if (voices[v].channel == c) voices[v].stage = SYNTH_OFF;
+			break;
+		case 0x79:
+			ResetControllers(c);
+			break;
+		case 0x7b: case 0x7c: case 0x7d: case 0x7e: case 0x7f:	/* All notes off */
+			for (Bitu v = 0;v < maxVoices;v++) {
+				SynthVoice & voice = voices[v];
+				if (voice.stage == SYNTH_OFF || voice.stage == SYNTH_RELEASE || voice.channel != c) continue;
+				if (ch.sustain) voice.sustained = true;
+				else Release(voice);
+			}
+			break;
+		}
+	}
+
+	/* Advances the envelope by one block, false once the voice is silent */
+	static bool Envelope(SynthVoice & v) {
+		const float time = (float)SYNTH_BLOCK / SYNTH_RATE;
+		switch (v.stage) {
+		case SYNTH_DELAY:
+			v.left -= time;
+			if (v.left <= 0) v.stage = SYNTH_ATTACK;
+			break;
+		case SYNTH_ATTACK:
+			v.level += time / v.attack;
+			if (v.level >= 1.0f) {
+				v.level = 1.0f;
+				v.left = v.hold;
+				v.stage = SYNTH_HOLD;
+			}
+			break;
+		case SYNTH_HOLD:
+			v.left -= time;
+			if (v.left <= 0) v.stage = SYNTH_DECAY;
+			break;
+		case SYNTH_DECAY:
+			/* The decay and release times are for falling 100 dB */
+			v.level *= powf(10.0f,-5.0f * time / v.decay);
+			if (v.level <= v.sustain) {
+				v.level = v.sustain;
+				v.stage = SYNTH_SUSTAIN;
+			}
+			return v.level >= SYNTH_SILENT || v.sustain >= SYNTH_SILENT;
+		case SYNTH_SUSTAIN:
+			return v.level >= SYNTH_SILENT;
+		case SYNTH_RELEASE:
+			v.level *= powf(10.0f,-5.0f * time / v.release);
+			return v.level >= SYNTH_SILENT;
+		case SYNTH_OFF:
+			return false;
+		}
+		return true;
+	}
+
+	void RenderVoice(SynthVoice & v,float * out) const {
+		const SynthChannel & ch = channels[v.channel];
+		const float time = (float)SYNTH_BLOCK / SYNTH_RATE;
+		/* Vibrato from the lfo and the modulation wheel, a triangle starting at 0 */
+		float cents = ch.bendCents;
+		float depth = v.vibDepth + ch.modulation * (50.0f / 127.0f);
+		if (v.vibDelay > 0) {
+			v.vibDelay -= time;
+		} else if (depth != 0) {
+			v.vibPhase += v.vibFreq * time;
+			v.vibPhase -= floorf(v.vibPhase);
+			float tri = v.vibPhase < 0.25f ? v.vibPhase * 4.0f :
+				(v.vibPhase < 0.75f ? 2.0f - v.vibPhase * 4.0f : v.vibPhase * 4.0f - 4.0f);
+			cents += depth * tri;
+		}
+		float step = cents != 0 ? v.step * powf(2.0f,cents / 1200.0f) : v.step;
+		Bit64u stepFixed = (Bit64u)(step * 4294967296.0f);
+		bool audible = Envelope(v);
+
+		float pan = v.pan + (ch.pan - 64) * (500.0f / 64.0f);
+		if (pan < -500.0f) pan = -500.0f;
+		if (pan > 500.0f) pan = 500.0f;
+		float angle = (pan + 500.0f) * (3.14159265f / 2000.0f);
+		float gain = audible ? v.level * v.gain * ch.gain : 0.0f;
+		float target[2] = { gain * cosf(angle), gain * sinf(angle) };
+		float left = v.out[0], right = v.out[1];
+		float leftAdd = (target[0] - left) / SYNTH_BLOCK, rightAdd = (target[1] - right) / SYNTH_BLOCK;
+		v.out[0] = target[0];
+		v.out[1] = target[1];
+
+		const Bit16s * data = &pool[0];
+		Bit64u pos = v.pos;
+		for (Bitu i = 0;i < SYNTH_BLOCK;i++) {
+			Bitu index = (Bitu)(pos >> 32);
+			float frac = (Bit32u)pos * (1.0f / 4294967296.0f);
+			float sample = data[index] + (data[index + 1] - data[index]) * frac;
+			if (v.filter) {
+				float y = v.b0 * sample + v.z1;
+				v.z1 = v.b1 * sample - v.a1 * y + v.z2;
+				v.z2 = v.b2 * sample - v.a2 * y;
+				sample = y;
+			}
+			left += leftAdd;
+			right += rightAdd;
+			out[i * 2] += sample * left;
+			out[i * 2 + 1] += sample * right;
+			pos += stepFixed;
+			if (v.loop) {
+				while ((pos >> 32) >= v.loopEnd) pos -= (Bit64u)(v.loopEnd - v.loopStart) << 32;
+			} else if ((pos >> 32) >= v.end) {
+				audible = false;
+				break;
+			}
+		}
+		v.pos = pos;
+		if (!audible) v.stage = SYNTH_OFF;
+	}
+
+	void RenderBlock(void) {
+		for (Bitu c = 0;c < 16;c++) {
+			SynthChannel & ch = channels[c];
+			float volume = ch.volume / 127.0f;
+			float expression = ch.expression / 127.0f;
+			ch.gain = volume * volume * expression * expression;
+			ch.bendCents = ((Bits)ch.bend - 0x2000) * (float)ch.bendRange / 8192.0f;
+		}
+		activeCount = 0;
+		for (Bitu v = 0;v < maxVoices;v++)
+			if (voices[v].stage != SYNTH_OFF) active[activeCount++] = v;
+		memset(mix[0],0,sizeof(mix[0]));
+		/* Only worth the handing over with a few voices for every thread */
+		if (synthThreads.count && activeCount >= (synthThreads.count + 1) * 4) {
+			synthThreads.parts = synthThreads.count + 1;
+			synthThreads.next = 1;
+			for (Bitu t = 0;t < synthThreads.count;t++) SDL_SemPost(synthThreads.work);
+			RenderPart(0);
+			for (Bitu t = 0;t < synthThreads.count;t++) SDL_SemWait(synthThreads.done);
+			for (Bitu p = 1;p < synthThreads.parts;p++)
+				for (Bitu i = 0;i < SYNTH_BLOCK * 2;i++) mix[0][i] += mix[p][i];
+		} else {
+			synthThreads.parts = 1;
+			RenderPart(0);
+		}
+		for (Bitu i = 0;i < SYNTH_BLOCK;i++) {
+			/* Leave some headroom for many voices, the mixer clips */
+			block[i][0] = (Bit32s)(mix[0][i * 2] * 0.5f);
+			block[i][1] = (Bit32s)(mix[0][i * 2 + 1] * 0.5f);
+		}
+		blockPos = 0;
+	}
+
+	bool Active(void) const {
+		for (Bitu v = 0;v < maxVoices;v++)
+			if (voices[v].stage != SYNTH_OFF) return true;
+		return false;
+	}
+
+	void StartThreads(Bitu count) {
+		if (count > SYNTH_MAXTHREADS) count = SYNTH_MAXTHREADS;
+		synthThreads.quit = false;
+		synthThreads.synth = this;
+		synthThreads.work = SDL_CreateSemaphore(0);
+		synthThreads.done = SDL_CreateSemaphore(0);
+		for (synthThreads.count = 0;synthThreads.count < count;synthThreads.count++) {
+			synthThreads.thread[synthThreads.count] = SDL_CreateThread(&SYNTH_Thread,0);
+			if (!synthThreads.thread[synthThreads.count]) break;
+		}
+		if (synthThreads.count < count)
+			LOG_MSG("MIDI:synth: Only %d of %d threads started",(int)synthThreads.count,(int)count);
+	}
+
+	void StopThreads(void) {
+		if (!synthThreads.work) return;
+		synthThreads.quit = true;
+		for (Bitu t = 0;t < synthThreads.count;t++) SDL_SemPost(synthThreads.work);
+		for (Bitu t = 0;t < synthThreads.count;t++) SDL_WaitThread(synthThreads.thread[t],0);
+		synthThreads.count = 0;
+		SDL_DestroySemaphore(synthThreads.work);
+		SDL_DestroySemaphore(synthThreads.done);
+		synthThreads.work = 0;
+		synthThreads.done = 0;
+	}
+
+public:
+	MidiHandler_synth() : MidiHandler(),maxVoices(0),age(0),activeCount(0),blockPos(SYNTH_BLOCK),chan(0) {};
+	const char * GetName(void) { return "synth"; }
+
+	/* Renders one part of the voices of the block, part 0 on the emulation thread */
+	void RenderPart(Bitu part) {
+		if (part) memset(mix[part],0,sizeof(mix[part]));
+		for (Bitu i = part;i < activeCount;i += synthThreads.parts)
+			RenderVoice(voices[active[i]],mix[part]);
+	}
+
+	void Generate(Bitu len) {
+		while (len) {
+			if (blockPos >= SYNTH_BLOCK) {
+				if (!Active()) {
+					chan->AddSilence();
+					return;
+				}
+				RenderBlock();
+			}
+			Bitu todo = SYNTH_BLOCK - blockPos;
+			if (todo > len) todo = len;
+			chan->AddSamples_s32(todo,block[blockPos]);
+			blockPos += todo;
+			len -= todo;
+		}
+	}
+
+	bool Open(const char * conf) {
+		if (!conf || !conf[0]) return false;
+		if (!Load(conf)) {
+			pool.clear();
+			samples.clear();
+			zones.clear();
+			presets.clear();
+			presetMap.clear();
+			return false;
+		}
+		Section_prop * section = static_cast<Section_prop *>(control->GetSection("midi"));
+		maxVoices = section->Get_int("synthvoices");
+		if (maxVoices < 1) maxVoices = 1;
+		if (maxVoices > SYNTH_MAXVOICES) maxVoices = SYNTH_MAXVOICES;
+		age = 0;
+		blockPos = SYNTH_BLOCK;
+		Reset();
+		chan = MIXER_AddChannel(&SYNTH_CallBack,SYNTH_RATE,"SYNTH");
+		chan->Enable(true);
+		chan->SetAutoSleep(true);
+		StartThreads(section->Get_int("synththreads"));
+		return true;
+	}
+
+	void Close(void) {
+		StopThreads();
+		if (chan) MIXER_DelChannel(chan);
+		chan = 0;
+		pool.clear();
+		samples.clear();
+		zones.clear();
+		presets.clear();
+		presetMap.clear();
+	}
+
+	void PlayMsg(Bit8u * msg) {
+		chan->WakeUp();
+		Bitu c = msg[0] & 0x0f;
+		switch (msg[0] & 0xf0) {
+		case 0x80:
+			NoteOff(c,msg[1] & 0x7f);
+			break;
+		case 0x90:
+			if (msg[2]) NoteOn(c,msg[1] & 0x7f,msg[2] & 0x7f);
+			else NoteOff(c,msg[1] & 0x7f);
+			break;
+		case 0xb0:
+			Controller(c,msg[1] & 0x7f,msg[2] & 0x7f);
+			break;
+		case 0xc0:
+			channels[c].program = msg[1] & 0x7f;
+			channels[c].preset = FindPreset(channels[c].bank,channels[c].program);
+			break;
+		case 0xe0:
+			channels[c].bend = (msg[1] & 0x7f) | ((msg[2] & 0x7f) << 7);
+			break;
+		}
+	}
+
+	void PlaySysex(Bit8u * sysex,Bitu len) {
+		/* GM system on, GS reset and XG system on */
+		static const Bit8u gmOn[] = { 0xf0, 0x7e, 0x7f, 0x09, 0x01 };
+		static const Bit8u gsReset[] = { 0xf0, 0x41, 0x10, 0x42, 0x12, 0x40, 0x00, 0x7f, 0x00 };
+		static const Bit8u xgOn[] = { 0xf0, 0x43, 0x10, 0x4c, 0x00, 0x00, 0x7e, 0x00 };
+		if ((len >= sizeof(gmOn) && !memcmp(sysex,gmOn,2) && !memcmp(sysex + 3,gmOn + 3,2)) ||
+			(len >= sizeof(gsReset) && !memcmp(sysex,gsReset,2) && !memcmp(sysex + 3,gsReset + 3,6)) ||
+			(len >= sizeof(xgOn) && !memcmp(sysex,xgOn,2) && (sysex[2] & 0xf0) == 0x10 && !memcmp(sysex + 3,xgOn + 3,5))) {
+			chan->WakeUp();
+			Reset();
+		}
+	}
+};
+
+MidiHandler_synth Midi_synth;
+
+static void SYNTH_CallBack(Bitu len) {
+	Midi_synth.Generate(len);
+}
+
+static int SYNTH_Thread(void * /*data*/) {
+	for (;;) {
+		SDL_SemWait(synthThreads.work);
+		if (synthThreads.quit) break;
+		synthThreads.synth->RenderPart(synthThreads.next++);
+		SDL_SemPost(synthThreads.done);
+	}
+	return 0;
+}
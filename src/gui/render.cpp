@@ -23,7 +23,9 @@
 #include <fstream>
 #include <sstream>
 #include <stdlib.h>
+#include <atomic>
 
+#include "SDL.h"
 #include "dosbox.h"
 #include "video.h"
 #include "render.h"
@@ -34,6 +36,9 @@
 #include "hardware.h"
 #include "support.h"
 #include "shell.h"
+#include "timer.h"
+#include "perf.h"
+#include "../ints/int10.h"
 
 #include "render_scalers.h"
 #include "render_glsl.h"
@@ -149,6 +154,284 @@ static void RENDER_ClearCacheHandler(const void * src) {
 	render.scale.lineHandler( src );
 }
 
+/* Scaler threads: the complex scalers can run on worker threads. The cache
+   stage still runs on the emulation thread as lines are drawn, bands of
+   finished lines are queued for the workers and RENDER_EndUpdate waits for
+   all of them before the frame is presented. */
+#define RENDER_MAXTHREADS	8
+#define RENDER_MAXBANDS		64
+
+typedef struct {
+	ScalerBand_t band;
+	Bitu end;
+	Bit16u changed[SCALER_MAXHEIGHT];
+} RenderBand_t;
+
+static struct {
+	Bitu count;
+	SDL_Thread * thread[RENDER_MAXTHREADS];
+	scalerWriteCache_t * writeCache[RENDER_MAXTHREADS];
+	SDL_sem * work;			// posted for every queued band
+	SDL_sem * done;			// posted for every finished band
+	volatile bool quit;
+	RenderBand_t bands[RENDER_MAXBANDS];
+	std::atomic<Bitu> next;	// next band to be taken by a worker
+	Bitu queued;
+	Bitu bandLines;
+	Bitu linearHeight;		// output lines per line of the linear handlers, 0 uses Scaler_Aspect
+	bool started;
+	Bitu nextLine;
+	Bit8u * nextWrite;
+} scalerThreads;
+
+static int RENDER_ScalerThread(void * data) {
+	scalerWriteCache_t * writeCache = (scalerWriteCache_t *)data;
+	for (;;) {
+		SDL_SemWait(scalerThreads.work);
+		if (scalerThreads.quit) break;
+		RenderBand_t * band = &scalerThreads.bands[scalerThreads.next++];
+		band->band.writeCache = writeCache;
+		while (band->band.outLine < band->end)
+			render.scale.complexHandler( &band->band );
+		SDL_SemPost(scalerThreads.done);
+	}
+	return 0;
+}
+
+static void RENDER_QueueBand(Bitu end) {
+	RenderBand_t * band = &scalerThreads.bands[scalerThreads.queued++];
+	band->band.outLine = scalerThreads.nextLine;
+	band->band.outWrite = scalerThreads.nextWrite;
+	band->band.changed = band->changed;
+	band->band.changedIndex = 0;
+	band->changed[0] = 0;
+	band->end = end;
+	/* The next band starts below the output of this one, line 0 has none */
+	for (Bitu line = scalerThreads.nextLine;line < end;line++) {
+		if (!line) continue;
+		Bitu lines = scalerThreads.linearHeight ? scalerThreads.linearHeight : Scaler_Aspect[line];
+		scalerThreads.nextWrite += render.scale.outPitch * lines;
+	}
+	scalerThreads.nextLine = end;
+	SDL_SemPost(scalerThreads.work);
+}
+
+static void RENDER_ThreadedLine(void) {
+	if (!scalerThreads.started) {
+		scalerThreads.started = true;
+		scalerThreads.nextLine = render.scale.outLine;
+		scalerThreads.nextWrite = render.scale.outWrite;
+	}
+	/* Scalers look up to two lines ahead, so only the lines above the last
+	   cached one are final. The last band is queued by RENDER_EndUpdate. */
+	Bitu ready = render.scale.inLine - 1;
+	if (ready >= scalerThreads.nextLine + scalerThreads.bandLines && scalerThreads.queued < RENDER_MAXBANDS - 1)
+		RENDER_QueueBand(ready);
+}
+
+/* Wait for the queued bands. When finishing a frame the remaining lines are
+   scaled first and the changed lines of all bands are added in order. */
+static void RENDER_WaitScalers(bool finish) {
+	if (!scalerThreads.started) return;
+	if (finish && render.scale.inLine > scalerThreads.nextLine)
+		RENDER_QueueBand(render.scale.inLine);
+	for (Bitu i = 0;i < scalerThreads.queued;i++)
+		SDL_SemWait(scalerThreads.done);
+	if (finish) {
+		for (Bitu i = 0;i < scalerThreads.queued;i++) {
+			const ScalerBand_t * band = &scalerThreads.bands[i].band;
+			for (Bitu k = 0;k <= band->changedIndex;k++) {
+				Bitu count = band->changed[k];
+				if (!count) continue;
+				if ((Scaler_ChangedLineIndex & 1) == (k & 1)) {
+					Scaler_ChangedLines[Scaler_ChangedLineIndex] += count;
+				} else {
+					Scaler_ChangedLines[++Scaler_ChangedLineIndex] = count;
+				}
+			}
+			render.scale.outWrite = band->outWrite;
+		}
+		render.scale.outLine = render.scale.inLine;
+	}
+	scalerThreads.queued = 0;
+	scalerThreads.next = 0;
+	scalerThreads.started = false;
+}
+
+static void RENDER_StartScalers(Bitu count) {
+	if (count > RENDER_MAXTHREADS) count = RENDER_MAXTHREADS;
+	scalerThreads.quit = false;
+	scalerThreads.queued = 0;
+	scalerThreads.next = 0;
+	scalerThreads.started = false;
+	scalerThreads.work = SDL_CreateSemaphore(0);
+	scalerThreads.done = SDL_CreateSemaphore(0);
+	for (scalerThreads.count = 0;scalerThreads.count < count;scalerThreads.count++) {
+		Bitu i = scalerThreads.count;
+		scalerThreads.writeCache[i] = (scalerWriteCache_t *)malloc(sizeof(scalerWriteCache_t));
+		if (!scalerThreads.writeCache[i]) break;
+		scalerThreads.thread[i] = SDL_CreateThread(&RENDER_ScalerThread,scalerThreads.writeCache[i]);
+		if (!scalerThreads.thread[i]) {
+			free(scalerThreads.writeCache[i]);
+			break;
+		}
+	}
+	if (scalerThreads.count < count)
+		LOG_MSG("RENDER: Only %d of %d scaler threads started",(int)scalerThreads.count,(int)count);
+}
+
+static void RENDER_StopScalers(Section * /*sec*/) {
+	if (!scalerThreads.work) return;
+	RENDER_WaitScalers(false);
+	scalerThreads.quit = true;
+	for (Bitu i = 0;i < scalerThreads.count;i++)
+		SDL_SemPost(scalerThreads.work);
+	for (Bitu i = 0;i < scalerThreads.count;i++) {
+		SDL_WaitThread(scalerThreads.thread[i],0);
+		free(scalerThreads.writeCache[i]);
+	}
+	scalerThreads.count = 0;
+	SDL_DestroySemaphore(scalerThreads.work);
+	SDL_DestroySemaphore(scalerThreads.done);
+	scalerThreads.work = 0;
+	scalerThreads.done = 0;
+}
+
+/* Frame pacing: only the last frame finished before a host vblank is worth
+   presenting, a frame that is followed by another one before that vblank
+   would never be seen. Skipping it is done like frameskip, so the emulation
+   runs on unaffected. */
+static bool RENDER_PacingSkip(void) {
+	if (render.pacing.period <= 0.0 || render.src.fps <= 0)
+		return false;
+	double now = PERF_Now() / 1000.0;
+	double frame = (1000.0 / render.src.fps) * (1 + render.frameskip.max);
+	double period = render.pacing.period;
+	/* First vblank after this frame is done */
+	double done = now + frame;
+	if (render.pacing.vblank < done)
+		render.pacing.vblank += ceil((done - render.pacing.vblank) / period) * period;
+	if (render.pacing.vblank - period >= done)
+		render.pacing.vblank -= floor((render.pacing.vblank - done) / period) * period;
+	if (done + frame <= render.pacing.vblank) {
+		render.pacing.dropped++;
+		return true;
+	}
+	render.pacing.presented++;
+	return false;
+}
+
+/* Called by the video output after presenting a frame, with PERF_Now times.
+   An output waiting for the buffer swap is synchronised to the host vblank,
+   use it to measure the host refresh rate and to align the expected vblanks.
+   SDL 1.2 can't tell the refresh rate of the display, so the measurement
+   starts at 60Hz and takes any period between 4ms and 50ms. */
+void RENDER_Presented(Bit64u start,Bit64u end) {
+	/* A present that returned at once did not wait for a vblank */
+	if (!render.pacing.measure || end - start < 250)
+		return;
+	double now = end / 1000.0;
+	if (render.pacing.lastSync > 0.0) {
+		double delta = now - render.pacing.lastSync;
+		double period = render.pacing.period;
+		if (delta >= 4.0 && delta <= 50.0) {
+			/* The presents in between didn't wait or vblanks were missed,
+			   take the delta as the nearest whole number of periods */
+			double n = floor(delta / period + 0.5);
+			if (n < 1.0) n = 1.0;
+			render.pacing.period += (delta / n - period) / 16.0;
+		}
+	}
+	render.pacing.lastSync = now;
+	render.pacing.vblank = now + render.pacing.period;
+}
+
+/* Performance overlay, drawn over the top left corner of the output with the
+   8x8 ROM font. Its lines are merged into the changed lines, so they are
+   updated along with whatever else changed in the frame. */
+#define HUD_MAXROWS 8
+#define HUD_MAXCOLS 40
+
+static void RENDER_DrawHUD(const char * text) {
+	/* Forcing the lines to changed can add two entries */
+	if (Scaler_ChangedLineIndex + 2 >= SCALER_MAXHEIGHT) return;
+	Bitu height = 0, i;
+	for (i = 0;i <= Scaler_ChangedLineIndex;i++)
+		height += Scaler_ChangedLines[i];
+	Bit8u * base = render.scale.outWrite - render.scale.outPitch * height;
+
+	char grid[HUD_MAXROWS][HUD_MAXCOLS];
+	memset(grid,' ',sizeof(grid));
+	Bitu rows = 1, cols = 0, len = 0;
+	for (;*text;text++) {
+		if (*text == '\n') {
+			if (rows == HUD_MAXROWS) break;
+			rows++; len = 0;
+		} else if (len < HUD_MAXCOLS) {
+			grid[rows-1][len++] = *text;
+			if (len > cols) cols = len;
+		}
+	}
+
+	Bitu bpp, fg, bg;
+	switch (render.scale.outMode) {
+	case scalerMode8:
+		bpp = 1; fg = 15; bg = 0;
+		break;
+	case scalerMode15:
+	case scalerMode16:
+		bpp = 2; fg = GFX_GetRGB(255,255,255); bg = GFX_GetRGB(0,0,0);
+		break;
+	default:
+		bpp = 4; fg = GFX_GetRGB(255,255,255); bg = GFX_GetRGB(0,0,0);
+		break;
+	}
+	Bitu zoom = 1 + height / 480;
+	Bitu w = (cols * 8 + 2) * zoom, h = (rows * 9 + 1) * zoom;
+	if (h > height) return;
+	if (w > render.scale.outPitch / bpp) w = render.scale.outPitch / bpp;
+
+	for (Bitu y = 0;y < h;y++) {
+		Bit8u * line = base + y * render.scale.outPitch;
+		Bitu py = y / zoom;
+		Bitu row = (py - 1) / 9, gy = (py - 1) % 9;
+		bool blank = (py == 0 || gy == 8);
+		for (Bitu x = 0;x < w;x++) {
+			Bitu px = x / zoom;
+			Bitu pixel = bg;
+			if (!blank && px > 0 && px <= cols * 8) {
+				Bit8u glyph = int10_font_08[(Bit8u)grid[row][(px - 1) / 8] * 8 + gy];
+				if (glyph & (0x80 >> ((px - 1) & 7))) pixel = fg;
+			}
+			switch (bpp) {
+			case 1: line[x] = (Bit8u)pixel; break;
+			case 2: ((Bit16u *)line)[x] = (Bit16u)pixel; break;
+			default: ((Bit32u *)line)[x] = (Bit32u)pixel; break;
+			}
+		}
+	}
+
+	/* Rebuild the changed lines with the first h lines forced to changed */
+	Bit16u changed[SCALER_MAXHEIGHT];
+	Bitu index = 0, y = 0;
+	changed[0] = 0;
+	for (i = 0;i <= Scaler_ChangedLineIndex;i++) {
+		Bitu count = Scaler_ChangedLines[i];
+		while (count) {
+			Bitu run = count, dirty = i & 1;
+			if (y < h) {
+				dirty = 1;
+				if (run > h - y) run = h - y;
+			}
+			if ((index & 1) == dirty) changed[index] += (Bit16u)run;
+			else changed[++index] = (Bit16u)run;
+			y += run; count -= run;
+		}
+	}
+	memcpy(Scaler_ChangedLines,changed,(index + 1) * sizeof(Bit16u));
+	Scaler_ChangedLineIndex = index;
+}
+
 bool RENDER_StartUpdate(void) {
 	if (GCC_UNLIKELY(render.updating))
 		return false;
@@ -156,15 +439,27 @@ bool RENDER_StartUpdate(void) {
 		return false;
 	if (GCC_UNLIKELY(render.frameskip.count<render.frameskip.max)) {
 		render.frameskip.count++;
+		PERF_Add(PERF_FRAMES_SKIPPED,1);
 		return false;
 	}
 	render.frameskip.count=0;
+	if (GCC_UNLIKELY(RENDER_PacingSkip())) {
+		PERF_Add(PERF_FRAMES_SKIPPED,1);
+		return false;
+	}
+	/* A new overlay text needs a frame to be drawn in */
+	Bitu hudSerial;
+	PERF_GetHUD(hudSerial);
+	if (GCC_UNLIKELY(hudSerial != render.hudSerial)) {
+		render.hudSerial = hudSerial;
+		render.scale.clearCache = true;
+	}
 	if (render.scale.inMode == scalerMode8) {
 		Check_Palette();
 	}
 	render.scale.inLine = 0;
 	render.scale.outLine = 0;
-	render.scale.cacheRead = (Bit8u*)&scalerSourceCache;
+	render.scale.cacheRead = scalerSourceCache;
 	render.scale.outWrite = 0;
 	render.scale.outPitch = 0;
 	Scaler_ChangedLines[0] = 0;
@@ -180,24 +475,25 @@ bool RENDER_StartUpdate(void) {
 		RENDER_DrawLine = RENDER_ClearCacheHandler;
 	} else {
 		if (render.pal.changed) {
-			/* Assume pal changes always do a full screen update anyway */
+			/* The palette handlers also check the unchanged lines against
+			   the modified entries, so those can still be skipped */
 			if (GCC_UNLIKELY(!GFX_StartUpdate( render.scale.outWrite, render.scale.outPitch )))
 				return false;
 			RENDER_DrawLine = render.scale.linePalHandler;
-			render.fullFrame = true;
 		} else {
 			RENDER_DrawLine = RENDER_StartLineHandler;
-			if (GCC_UNLIKELY(CaptureState & (CAPTURE_IMAGE|CAPTURE_VIDEO))) 
-				render.fullFrame = true;
-			else
-				render.fullFrame = false;
 		}
+		if (GCC_UNLIKELY(CaptureState & (CAPTURE_IMAGE|CAPTURE_VIDEO))) 
+			render.fullFrame = true;
+		else
+			render.fullFrame = false;
 	}
 	render.updating = true;
 	return true;
 }
 
 static void RENDER_Halt( void ) {
+	RENDER_WaitScalers(false);
 	RENDER_DrawLine = RENDER_EmptyLineHandler;
 	GFX_EndUpdate( 0 );
 	render.updating=false;
@@ -208,7 +504,10 @@ extern Bitu PIC_Ticks;
 void RENDER_EndUpdate( bool abort ) {
 	if (GCC_UNLIKELY(!render.updating))
 		return;
+	Bit64u perfstart = PERF_Start();
+	PERF_Add(PERF_FRAMES,1);
 	RENDER_DrawLine = RENDER_EmptyLineHandler;
+	RENDER_WaitScalers(true);
 	if (GCC_UNLIKELY(CaptureState & (CAPTURE_IMAGE|CAPTURE_VIDEO))) {
 		Bitu pitch, flags;
 		flags = 0;
@@ -222,7 +521,20 @@ void RENDER_EndUpdate( bool abort ) {
 		if (render.frameskip.max)
 			fps /= 1+render.frameskip.max;
 		CAPTURE_AddImage( render.src.width, render.src.height, render.src.bpp, pitch,
-			flags, fps, (Bit8u *)&scalerSourceCache, (Bit8u*)&render.pal.rgb );
+			flags, fps, scalerSourceCache, (Bit8u*)&render.pal.rgb );
+	}
+	/* Unchanged lines are still in the cache, so no full frame is needed */
+	if (GCC_UNLIKELY((CaptureState & CAPTURE_FRAMES) && !abort)) {
+		Bitu flags = 0;
+		if (render.src.dblw) flags|=CAPTURE_FLAG_DBLW;
+		if (render.src.dblh) flags|=CAPTURE_FLAG_DBLH;
+		CAPTURE_AddFrame( render.src.width, render.src.height, render.src.bpp, render.scale.cachePitch,
+			flags, scalerSourceCache, (Bit8u*)&render.pal.rgb );
+	}
+	if (render.scale.outWrite && !abort) {
+		Bitu hudSerial;
+		const char * hud = PERF_GetHUD(hudSerial);
+		if (GCC_UNLIKELY(hud != NULL)) RENDER_DrawHUD(hud);
 	}
 // DWD BEGIN
 #if C_GAMELINK
@@ -244,6 +556,7 @@ void RENDER_EndUpdate( bool abort ) {
 	}
 	render.frameskip.index = (render.frameskip.index + 1) & (RENDER_SKIP_CACHE - 1);
 	render.updating=false;
+	PERF_Stop(PERF_HOST_RENDER,perfstart);
 }
 
 static Bitu MakeAspectTable(Bitu skip,Bitu height,double scaley,Bitu miny) {
@@ -506,9 +819,21 @@ forcenormal:
 	default:
 		E_Exit("RENDER:Wrong source bpp %" sBitfs(d), render.src.bpp );
 	}
+	if (!Scaler_AllocCaches(render.scale.cachePitch * render.src.height,render.scale.complexHandler != 0))
+		E_Exit("RENDER:Can't allocate the scaler caches for %dx%d",(int)render.src.width,(int)render.src.height);
+	/* The rest of this frame is copied into the new cache */
+	render.scale.cacheRead = scalerSourceCache;
 	render.scale.blocks = render.src.width / SCALER_BLOCKSIZE;
 	render.scale.lastBlock = render.src.width % SCALER_BLOCKSIZE;
 	render.scale.inHeight = render.src.height;
+	render.scale.complexLine = Scaler_ComplexLine;
+	if (render.scale.complexHandler && scalerThreads.count) {
+		render.scale.complexLine = RENDER_ThreadedLine;
+		scalerThreads.linearHeight = (gfx_flags & GFX_HARDWARE) ? yscale : 0;
+		/* A few bands per thread, so they still run while the frame is drawn */
+		scalerThreads.bandLines = render.src.height / (scalerThreads.count * 4);
+		if (scalerThreads.bandLines < 8) scalerThreads.bandLines = 8;
+	}
 	/* Reset the palette change detection to it's initial value */
 	render.pal.first= 0;
 	render.pal.last = 255;
@@ -530,6 +855,7 @@ static void RENDER_CallBack( GFX_CallBackFunctions_t function ) {
 		render.scale.clearCache = true;
 		return;
 	} else if ( function == GFX_CallBackReset) {
+		RENDER_WaitScalers(false);
 		GFX_EndUpdate( 0 );	
 		RENDER_Reset();
 	} else {
@@ -539,8 +865,10 @@ static void RENDER_CallBack( GFX_CallBackFunctions_t function ) {
 
 void RENDER_SetSize(Bitu width,Bitu height,Bitu bpp,float fps,double ratio,bool dblw,bool dblh) {
 	RENDER_Halt( );
-	if (!width || !height || width > SCALER_MAXWIDTH || height > SCALER_MAXHEIGHT) { 
-		return;	
+	if (!width || !height) return;
+	if (width > SCALER_MAXWIDTH || height > SCALER_MAXHEIGHT) {
+		LOG_MSG("RENDER: %dx%d is larger than the supported %dx%d",(int)width,(int)height,SCALER_MAXWIDTH,SCALER_MAXHEIGHT);
+		return;
 	}
 	if ( ratio > 1 ) {
 		double target = height * ratio + 0.025;
@@ -668,6 +996,20 @@ void RENDER_Init(Section * sec) {
 	render.aspect=section->Get_bool("aspect");
 	render.frameskip.max=section->Get_int("frameskip");
 	render.frameskip.count=0;
+
+	std::string pacing = section->Get_string("framepacing");
+	render.pacing.period = 0.0;
+	render.pacing.measure = false;
+	render.pacing.lastSync = 0.0;
+	if (pacing == "auto") {
+		render.pacing.period = 1000.0 / 60.0;
+		render.pacing.measure = true;
+	} else if (pacing != "off") {
+		int rate = atoi(pacing.c_str());
+		if (rate >= 24 && rate <= 500) render.pacing.period = 1000.0 / rate;
+		else LOG_MSG("RENDER: Invalid framepacing %s, pacing disabled",pacing.c_str());
+	}
+	render.pacing.vblank = PERF_Now() / 1000.0 + render.pacing.period;
 	std::string cline;
 	std::string scaler;
 	//Check for commandline paramters and parse them through the configclass so they get checked against allowed values
@@ -733,7 +1075,14 @@ void RENDER_Init(Section * sec) {
 				   render.scale.forced))
 		RENDER_CallBack( GFX_CallBackReset );
 
-	if(!running) render.updating=true;
+	if(!running) {
+		render.updating=true;
+		Bitu threads = section->Get_int("scalerthreads");
+		if (threads) {
+			RENDER_StartScalers(threads);
+			sec->AddDestroyFunction(&RENDER_StopScalers);
+		}
+	}
 	running = true;
 
 	MAPPER_AddHandler(DecreaseFrameSkip,MK_f7,MMOD1,"decfskip","Dec Fskip");
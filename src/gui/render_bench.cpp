@@ -0,0 +1,353 @@
+/*
+ *  Copyright (C) 2002-2020  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Scaler benchmark, built with "make render_bench" in src/gui.
+   Usage: render_bench [minimum frames] [scaler name]
+   Runs every scaler and bpp combination over generated frames and reports
+   the best time per frame, once with every pixel changing and once with a
+   static frame, where only the compare against the source cache is done.
+
+   Usage: render_bench -replay <file.frm> [minimum passes] [scaler name]
+   Replays frames recorded with the "recframes" mapper event through every
+   scaler and output bpp, so the cost of real games with their mix of
+   changed lines and palette updates is measured. Every run of frames with
+   the same mode is reported on its own line, with the mean time per frame
+   of the fastest pass over the run. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "dosbox.h"
+#include "render.h"
+
+Render_t render;
+
+static const struct {
+	const char * name;
+	ScalerSimpleBlock_t * simple;
+	ScalerComplexBlock_t * complex;
+} scalers[] = {
+	{ "Normal1x", &ScaleNormal1x, 0 },
+	{ "NormalDw", &ScaleNormalDw, 0 },
+	{ "NormalDh", &ScaleNormalDh, 0 },
+	{ "Normal2x", &ScaleNormal2x, 0 },
+	{ "Normal3x", &ScaleNormal3x, 0 },
+#if RENDER_USE_ADVANCED_SCALERS>0
+	{ "TV2x", &ScaleTV2x, 0 },
+	{ "TV3x", &ScaleTV3x, 0 },
+	{ "RGB2x", &ScaleRGB2x, 0 },
+	{ "RGB3x", &ScaleRGB3x, 0 },
+	{ "Scan2x", &ScaleScan2x, 0 },
+	{ "Scan3x", &ScaleScan3x, 0 },
+#endif
+#if RENDER_USE_ADVANCED_SCALERS>2
+	{ "AdvMame2x", 0, &ScaleAdvMame2x },
+	{ "AdvMame3x", 0, &ScaleAdvMame3x },
+	{ "AdvInterp2x", 0, &ScaleAdvInterp2x },
+	{ "AdvInterp3x", 0, &ScaleAdvInterp3x },
+	{ "HQ2x", 0, &ScaleHQ2x },
+	{ "HQ3x", 0, &ScaleHQ3x },
+	{ "2xSaI", 0, &Scale2xSaI },
+	{ "Super2xSaI", 0, &ScaleSuper2xSaI },
+	{ "SuperEagle", 0, &ScaleSuperEagle },
+#endif
+};
+
+static const Bitu srcBpp[4] = { 8, 15, 16, 32 };
+static const Bitu dstBpp[4] = { 8, 15, 16, 32 };
+
+static Bit64u Now(void) {
+	return (Bit64u)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* A noisy frame so the compare can't skip anything and the complex scalers
+   see plenty of edges. */
+static void MakeFrame(Bit8u * frame,Bitu bytes,Bit32u seed) {
+	for (Bitu i = 0;i < bytes;i++) {
+		seed = seed * 1103515245 + 12345;
+		frame[i] = (Bit8u)(seed >> 16);
+	}
+}
+
+static Bitu ScalerXScale(Bitu n) {
+	return scalers[n].simple ? scalers[n].simple->xscale : scalers[n].complex->xscale;
+}
+
+static Bitu ScalerYScale(Bitu n) {
+	return scalers[n].simple ? scalers[n].simple->yscale : scalers[n].complex->yscale;
+}
+
+/* Sets up render like RENDER_Reset does, false when the scaler can't
+   handle this combination or size, RENDER_Reset picks another one then */
+static bool SetupScaler(Bitu n,Bitu in,Bitu outMode,Bitu width,Bitu height) {
+	if (width * ScalerXScale(n) > SCALER_MAXLINE_WIDTH) return false;
+	if (scalers[n].complex && (width >= SCALER_COMPLEXWIDTH - 16 || height >= SCALER_COMPLEXHEIGHT - 16))
+		return false;
+	if (scalers[n].simple) {
+		render.scale.lineHandler = scalers[n].simple->Linear[in][outMode];
+		render.scale.linePalHandler = scalers[n].simple->Linear[4][outMode];
+		render.scale.complexHandler = 0;
+	} else {
+		render.scale.lineHandler = ScalerCache[in][outMode];
+		render.scale.linePalHandler = ScalerCache[4][outMode];
+		render.scale.complexLine = Scaler_ComplexLine;
+		render.scale.complexHandler = scalers[n].complex->Linear[outMode];
+		if (!render.scale.complexHandler) render.scale.lineHandler = 0;
+	}
+	if (!render.scale.lineHandler) return false;
+
+	Bitu pitch = width * ((srcBpp[in] + 7) / 8);
+	render.src.width = width;
+	render.src.height = height;
+	render.src.bpp = srcBpp[in];
+	render.src.start = pitch / sizeof(Bitu);
+	render.scale.inMode = (scalerMode_t)in;
+	render.scale.outMode = (scalerMode_t)outMode;
+	render.scale.cachePitch = pitch;
+	render.scale.blocks = width / SCALER_BLOCKSIZE;
+	render.scale.lastBlock = width % SCALER_BLOCKSIZE;
+	render.scale.inHeight = height;
+	if (!Scaler_AllocCaches(pitch * height,render.scale.complexHandler != 0)) {
+		fprintf(stderr,"Can't allocate the scaler caches\n");
+		exit(1);
+	}
+	Bitu skip = render.scale.complexHandler ? 1 : 0;
+	for (Bitu y = 0;y < height + skip;y++)
+		Scaler_Aspect[y] = (y < skip) ? 0 : (Bit8u)ScalerYScale(n);
+	return true;
+}
+
+static void RunFrame(const Bit8u * frame,Bitu pitch,Bit8u * out,Bitu outPitch) {
+	render.scale.inLine = 0;
+	render.scale.outLine = 0;
+	render.scale.cacheRead = scalerSourceCache;
+	render.scale.outWrite = out;
+	render.scale.outPitch = outPitch;
+	Scaler_ChangedLines[0] = 0;
+	Scaler_ChangedLineIndex = 0;
+	for (Bitu y = 0;y < render.src.height;y++)
+		render.scale.lineHandler(frame + y * pitch);
+}
+
+/* The fastest frame is reported, it is the least disturbed by the host */
+static double TimeFrames(const Bit8u * a,const Bit8u * b,Bitu pitch,Bit8u * out,Bitu outPitch,Bitu minFrames) {
+	Bitu frames = 0;
+	Bit64u start = Now(), best = ~(Bit64u)0, now = start;
+	do {
+		Bit64u frameStart = now;
+		RunFrame((frames & 1) ? b : a,pitch,out,outPitch);
+		frames++;
+		now = Now();
+		if (now - frameStart < best) best = now - frameStart;
+	} while (frames < minFrames || now - start < 100000000);
+	return (double)best;
+}
+
+/* A recorded frame, see CAPTURE_AddFrame for the file layout */
+struct ReplayFrame {
+	Bitu width, height, bpp;
+	Bit8u rgb[256 * 3];
+	Bit8u * data;
+};
+
+static Bit32u ReadLE32(const Bit8u * p) {
+	return (Bit32u)p[0] | ((Bit32u)p[1] << 8) | ((Bit32u)p[2] << 16) | ((Bit32u)p[3] << 24);
+}
+
+static bool LoadFrames(const char * name,std::vector<ReplayFrame> & frames) {
+	FILE * f = fopen(name,"rb");
+	if (!f) {
+		fprintf(stderr,"Can't open %s\n",name);
+		return false;
+	}
+	char magic[8];
+	if (fread(magic,1,8,f) != 8 || memcmp(magic,"DBFRAME1",8)) {
+		fprintf(stderr,"%s isn't a frame capture\n",name);
+		fclose(f);
+		return false;
+	}
+	Bit8u header[16];
+	while (fread(header,1,sizeof(header),f) == sizeof(header)) {
+		ReplayFrame frame;
+		frame.width = ReadLE32(&header[0x0]);
+		frame.height = ReadLE32(&header[0x4]);
+		frame.bpp = ReadLE32(&header[0x8]);
+		if (!frame.width || frame.width > SCALER_MAXWIDTH || !frame.height || frame.height > SCALER_MAXHEIGHT ||
+			(frame.bpp != 8 && frame.bpp != 15 && frame.bpp != 16 && frame.bpp != 32)) {
+			fprintf(stderr,"Bad frame %d in %s\n",(int)frames.size(),name);
+			break;
+		}
+		memset(frame.rgb,0,sizeof(frame.rgb));
+		if (frame.bpp == 8 && fread(frame.rgb,1,sizeof(frame.rgb),f) != sizeof(frame.rgb))
+			break;
+		Bitu bytes = frame.width * ((frame.bpp + 7) / 8) * frame.height;
+		frame.data = (Bit8u *)malloc(bytes);
+		if (!frame.data || fread(frame.data,1,bytes,f) != bytes) {
+			free(frame.data);
+			break;
+		}
+		frames.push_back(frame);
+	}
+	fclose(f);
+	return !frames.empty();
+}
+
+/* The same formats the bench uses for the generated palette */
+static Bit32u ReplayRGB(Bitu outMode,Bit8u r,Bit8u g,Bit8u b) {
+	switch (outMode) {
+	case scalerMode15:
+		return ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+	case scalerMode16:
+		return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+	default:
+		return (r << 16) | (g << 8) | b;
+	}
+}
+
+/* Like Check_Palette, true when entries changed and the pixels using them
+   have to be drawn again */
+static bool ReplayPalette(const ReplayFrame & frame) {
+	if (render.pal.changed) {
+		memset(render.pal.modified,0,sizeof(render.pal.modified));
+		render.pal.changed = false;
+	}
+	if (render.scale.outMode == scalerMode8) return false;
+	for (Bitu i = 0;i < 256;i++) {
+		Bit32u newPal = ReplayRGB(render.scale.outMode,frame.rgb[i * 3 + 0],frame.rgb[i * 3 + 1],frame.rgb[i * 3 + 2]);
+		Bit32u oldPal = (render.scale.outMode == scalerMode32) ? render.pal.lut.b32[i] : render.pal.lut.b16[i];
+		if (newPal == oldPal) continue;
+		render.pal.changed = true;
+		render.pal.modified[i] = 1;
+		if (render.scale.outMode == scalerMode32) render.pal.lut.b32[i] = newPal;
+		else render.pal.lut.b16[i] = (Bit16u)newPal;
+	}
+	return render.pal.changed;
+}
+
+static void ReplayRun(const ReplayFrame * frames,Bitu count,Bit8u * out,Bitu outPitch) {
+	Bitu pitch = render.scale.cachePitch;
+	ScalerLineHandler_t lineHandler = render.scale.lineHandler;
+	for (Bitu f = 0;f < count;f++) {
+		if (render.scale.inMode == scalerMode8 && ReplayPalette(frames[f]))
+			render.scale.lineHandler = render.scale.linePalHandler;
+		RunFrame(frames[f].data,pitch,out,outPitch);
+		render.scale.lineHandler = lineHandler;
+	}
+}
+
+static int Replay(const char * name,Bitu minPasses,const char * only) {
+	std::vector<ReplayFrame> frames;
+	if (!LoadFrames(name,frames)) return 1;
+	printf("%d frames\n",(int)frames.size());
+	printf("%-12s %-6s %-8s %8s %14s\n","scaler","bpp","size","frames","ns/frame");
+	for (Bitu first = 0;first < frames.size();) {
+		Bitu width = frames[first].width, height = frames[first].height, bpp = frames[first].bpp;
+		Bitu count = 1;
+		while (first + count < frames.size() && frames[first + count].width == width &&
+			frames[first + count].height == height && frames[first + count].bpp == bpp)
+			count++;
+		Bitu in = (bpp == 8) ? 0 : (bpp == 15) ? 1 : (bpp == 16) ? 2 : 3;
+		for (Bitu n = 0;n < sizeof(scalers) / sizeof(scalers[0]);n++) {
+			if (only && strcmp(only,scalers[n].name)) continue;
+			for (Bitu outMode = 0;outMode < 4;outMode++) {
+				if (!SetupScaler(n,in,outMode,width,height)) continue;
+				Bitu outPitch = width * ScalerXScale(n) * ((dstBpp[outMode] + 7) / 8);
+				Bit8u * out = (Bit8u *)malloc(outPitch * (height * ScalerYScale(n) + 1));
+				/* Start from a cleared cache and palette, the first pass only
+				   primes them */
+				memset(scalerSourceCache,0,render.scale.cachePitch * height);
+				memset(&render.pal.lut,0,sizeof(render.pal.lut));
+				render.pal.changed = false;
+				ReplayRun(&frames[first],count,out,outPitch);
+				Bitu passes = 0;
+				Bit64u start = Now(), best = ~(Bit64u)0, now = start;
+				do {
+					Bit64u passStart = now;
+					ReplayRun(&frames[first],count,out,outPitch);
+					passes++;
+					now = Now();
+					if (now - passStart < best) best = now - passStart;
+				} while (passes < minPasses || now - start < 100000000);
+				char bppName[16];
+				char size[16];
+				sprintf(bppName,"%d>%d",(int)bpp,(int)dstBpp[outMode]);
+				sprintf(size,"%dx%d",(int)width,(int)height);
+				printf("%-12s %-6s %-8s %8d %14.0f\n",scalers[n].name,bppName,size,(int)count,(double)best / count);
+				fflush(stdout);
+				free(out);
+			}
+		}
+		first += count;
+	}
+	for (Bitu f = 0;f < frames.size();f++) free(frames[f].data);
+	return 0;
+}
+
+int main(int argc,char * argv[]) {
+	if (argc > 2 && !strcmp(argv[1],"-replay"))
+		return Replay(argv[2],argc > 3 ? (Bitu)atoi(argv[3]) : 3,argc > 4 ? argv[4] : 0);
+	Bitu minFrames = argc > 1 ? (Bitu)atoi(argv[1]) : 10;
+	const char * only = argc > 2 ? argv[2] : 0;
+	static const Bitu sizes[2][2] = { { 320, 200 }, { 640, 480 } };
+
+	for (Bitu i = 0;i < 256;i++) {
+		render.pal.lut.b32[i] = (Bit32u)(i * 0x010203);
+		render.pal.modified[i] = 0;
+	}
+	for (Bitu i = 0;i < 256;i++)
+		render.pal.lut.b16[i] = (Bit16u)(i * 0x0123);
+
+	printf("%-12s %-6s %-8s %14s %14s\n","scaler","bpp","size","changed ns","static ns");
+	for (Bitu s = 0;s < 2;s++) {
+		Bitu width = sizes[s][0], height = sizes[s][1];
+		for (Bitu n = 0;n < sizeof(scalers) / sizeof(scalers[0]);n++) {
+			if (only && strcmp(only,scalers[n].name)) continue;
+			for (Bitu in = 0;in < 4;in++) for (Bitu outMode = 0;outMode < 4;outMode++) {
+				if (!SetupScaler(n,in,outMode,width,height)) continue;
+
+				Bitu pixelSize = (srcBpp[in] + 7) / 8;
+				Bitu pitch = width * pixelSize;
+				Bitu outPitch = width * ScalerXScale(n) * ((dstBpp[outMode] + 7) / 8);
+				Bit8u * a = (Bit8u *)malloc(pitch * height);
+				Bit8u * b = (Bit8u *)malloc(pitch * height);
+				Bit8u * out = (Bit8u *)malloc(outPitch * (height * ScalerYScale(n) + 1));
+				MakeFrame(a,pitch * height,1);
+				for (Bitu i = 0;i < pitch * height;i++) b[i] = ~a[i];
+
+				/* Prime the source cache with the inverted frame, so all lines change */
+				RunFrame(b,pitch,out,outPitch);
+				double changed = TimeFrames(a,b,pitch,out,outPitch,minFrames);
+				double still = TimeFrames(a,a,pitch,out,outPitch,minFrames);
+				char bpp[16];
+				char size[16];
+				sprintf(bpp,"%d>%d",(int)srcBpp[in],(int)dstBpp[outMode]);
+				sprintf(size,"%dx%d",(int)width,(int)height);
+				printf("%-12s %-6s %-8s %14.0f %14.0f\n",scalers[n].name,bpp,size,changed,still);
+				fflush(stdout);
+				free(a);
+				free(b);
+				free(out);
+			}
+		}
+	}
+	return 0;
+}
@@ -24,23 +24,58 @@
 #include "dosbox.h"
 #include "render.h"
 #include <string.h>
+#include <stdlib.h>
+#include "render_simd.h"
 
 Bit8u Scaler_Aspect[SCALER_MAXHEIGHT];
 Bit16u Scaler_ChangedLines[SCALER_MAXHEIGHT];
 Bitu Scaler_ChangedLineIndex;
 
-static union {
-	 //The +1 is a at least for the normal scalers not needed. (-1 is enough)
-	Bit32u b32 [SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXLINE_WIDTH];
-	Bit16u b16 [SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXLINE_WIDTH];
-	Bit8u   b8 [SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXLINE_WIDTH];
-} scalerWriteCache;
-//scalerFrameCache_t scalerFrameCache;
-scalerSourceCache_t scalerSourceCache;
+static scalerWriteCache_t scalerWriteCache;
+Bit8u * scalerSourceCache;
 #if RENDER_USE_ADVANCED_SCALERS>1
+scalerFrameCache_t * scalerFrameCache;
 scalerChangeCache_t scalerChangeCache;
 #endif
 
+#define SCALER_PAGESIZE 4096
+#define SCALER_PAGEALIGN(_VAL) (((Bitu)(_VAL) + SCALER_PAGESIZE - 1) & ~(Bitu)(SCALER_PAGESIZE - 1))
+
+static struct {
+	Bit8u * block;
+	Bitu size;
+} scalerCaches;
+
+/* Both caches live in one page aligned block, the frame cache of the complex
+   scalers follows the source cache. It's only reallocated when a mode needs
+   a different size, so small modes don't keep the memory of the largest. */
+bool Scaler_AllocCaches(Bitu sourceSize,bool complex) {
+	Bitu size = SCALER_PAGEALIGN(sourceSize);
+#if RENDER_USE_ADVANCED_SCALERS>1
+	if (complex) size += SCALER_PAGEALIGN(sizeof(scalerFrameCache_t));
+#endif
+	if (size != scalerCaches.size) {
+		free(scalerCaches.block);
+		scalerCaches.block = (Bit8u *)malloc(size + SCALER_PAGESIZE - 1);
+		scalerCaches.size = scalerCaches.block ? size : 0;
+		if (!scalerCaches.block) {
+			scalerSourceCache = 0;
+			return false;
+		}
+	}
+	scalerSourceCache = (Bit8u *)SCALER_PAGEALIGN(scalerCaches.block);
+#if RENDER_USE_ADVANCED_SCALERS>1
+	if (complex) {
+		/* The scalers look at the lines and columns around the frame */
+		scalerFrameCache = (scalerFrameCache_t *)(scalerSourceCache + SCALER_PAGEALIGN(sourceSize));
+		memset(scalerFrameCache,0,sizeof(scalerFrameCache_t));
+	} else {
+		scalerFrameCache = 0;
+	}
+#endif
+	return true;
+}
+
 #define _conc2(A,B) A ## B
 #define _conc3(A,B,C) A ## B ## C
 #define _conc4(A,B,C,D) A ## B ## C ## D
@@ -71,6 +106,28 @@ static INLINE void ScalerAddLines( Bitu changed, Bitu count ) {
 	render.scale.outWrite += render.scale.outPitch * count;
 }
 
+static INLINE void ScalerBandAddLines( ScalerBand_t *band, Bitu changed, Bitu count ) {
+	if ((band->changedIndex & 1) == changed ) {
+		band->changed[band->changedIndex] += count;
+	} else {
+		band->changed[++band->changedIndex] = count;
+	}
+	band->outWrite += render.scale.outPitch * count;
+}
+
+void Scaler_ComplexLine(void) {
+	ScalerBand_t band;
+	band.outLine = render.scale.outLine;
+	band.outWrite = render.scale.outWrite;
+	band.changed = Scaler_ChangedLines;
+	band.changedIndex = Scaler_ChangedLineIndex;
+	band.writeCache = &scalerWriteCache;
+	render.scale.complexHandler( &band );
+	render.scale.outLine = band.outLine;
+	render.scale.outWrite = band.outWrite;
+	Scaler_ChangedLineIndex = band.changedIndex;
+}
+
 
 #define BituMove2(_DST,_SRC,_SIZE)			\
 {											\
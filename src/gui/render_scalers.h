@@ -25,16 +25,10 @@
 #define SCALER_MAX_MUL_WIDTH  3
 #define SCALER_MAX_MUL_HEIGHT 3
 
-#if RENDER_USE_ADVANCED_SCALERS>0
-#define SCALER_MAXWIDTH 	1280 
-#define SCALER_MAXHEIGHT	1024
+// Only the per line tables use these, the caches are sized for the mode
+#define SCALER_MAXWIDTH 	2048
+#define SCALER_MAXHEIGHT	1536
 #define SCALER_MAXX     	4096
-#else
-// reduced to save some memory
-#define SCALER_MAXWIDTH 	800 
-#define SCALER_MAXHEIGHT	600
-#define SCALER_MAXX     	2048
-#endif
 
 #if (SCALER_MAX_MUL_WIDTH * SCALER_MAXWIDTH) > SCALER_MAXX
 #define SCALER_MAXLINE_WIDTH SCALER_MAXX
@@ -72,8 +66,25 @@ typedef enum scalerOperation {
 	scalerLast
 } scalerOperation_t;
 
+typedef union {
+	 //The +1 is a at least for the normal scalers not needed. (-1 is enough)
+	Bit32u b32 [SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXLINE_WIDTH];
+	Bit16u b16 [SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXLINE_WIDTH];
+	Bit8u   b8 [SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXLINE_WIDTH];
+} scalerWriteCache_t;
+
+/* Output state of a complex scaler. Scaling on the emulation thread uses one
+   for the whole frame, the scaler threads get one for every band of lines. */
+typedef struct {
+	Bitu outLine;
+	Bit8u *outWrite;
+	Bit16u *changed;
+	Bitu changedIndex;
+	scalerWriteCache_t *writeCache;
+} ScalerBand_t;
+
 typedef void (*ScalerLineHandler_t)(const void *src);
-typedef void (*ScalerComplexHandler_t)(void);
+typedef void (*ScalerComplexHandler_t)(ScalerBand_t *band);
 
 extern Bit8u Scaler_Aspect[];
 extern Bit8u diff_table[];
@@ -88,12 +99,15 @@ typedef union {
 	Bit8u b8	[SCALER_COMPLEXHEIGHT] [SCALER_COMPLEXWIDTH];
 } scalerFrameCache_t;
 #endif
-typedef union {
-	Bit32u b32	[SCALER_MAXHEIGHT] [SCALER_MAXWIDTH];
-	Bit16u b16	[SCALER_MAXHEIGHT] [SCALER_MAXWIDTH];
-	Bit8u b8	[SCALER_MAXHEIGHT] [SCALER_MAXWIDTH];
-} scalerSourceCache_t;
-extern scalerSourceCache_t scalerSourceCache;
+/* The source cache holds inHeight lines of cachePitch bytes. Both caches are
+   (re)allocated by Scaler_AllocCaches when the mode changes. */
+extern Bit8u * scalerSourceCache;
+#if RENDER_USE_ADVANCED_SCALERS>1
+extern scalerFrameCache_t * scalerFrameCache;
+#endif
+bool Scaler_AllocCaches(Bitu sourceSize,bool complex);
+/* Runs the complex scaler on the emulation thread for the lines cached so far */
+void Scaler_ComplexLine(void);
 #if RENDER_USE_ADVANCED_SCALERS>1
 extern scalerChangeCache_t scalerChangeCache;
 #endif
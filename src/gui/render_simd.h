@@ -0,0 +1,156 @@
+/*
+ *  Copyright (C) 2002-2020  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Vector helpers for the scalers. SSE2 is part of every x86-64 cpu and NEON
+   of every AArch64 one, so the kernels are picked when compiling.
+   Define RENDER_NO_SIMD to build the plain C scalers for comparison. */
+
+#ifndef DOSBOX_RENDER_SIMD_H
+#define DOSBOX_RENDER_SIMD_H
+
+#if !defined(RENDER_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define RENDER_SIMD_SSE2 1
+#define RENDER_SIMD 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RENDER_SIMD_NEON 1
+#define RENDER_SIMD 1
+#endif
+#endif
+
+#if defined(RENDER_SIMD)
+
+/* Length of the identical start of two lines, in whole 16 byte steps */
+static INLINE Bitu Scaler_SameBytes(const void * _a,const void * _b,Bitu bytes) {
+	const Bit8u * a = (const Bit8u *)_a;
+	const Bit8u * b = (const Bit8u *)_b;
+	Bitu same = 0;
+#if defined(RENDER_SIMD_SSE2)
+	while (same + 64 <= bytes) {
+		__m128i e0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + same)),
+			_mm_loadu_si128((const __m128i *)(b + same)));
+		__m128i e1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + same + 16)),
+			_mm_loadu_si128((const __m128i *)(b + same + 16)));
+		__m128i e2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + same + 32)),
+			_mm_loadu_si128((const __m128i *)(b + same + 32)));
+		__m128i e3 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + same + 48)),
+			_mm_loadu_si128((const __m128i *)(b + same + 48)));
+		e0 = _mm_and_si128(_mm_and_si128(e0,e1),_mm_and_si128(e2,e3));
+		if (_mm_movemask_epi8(e0) != 0xffff) break;
+		same += 64;
+	}
+	while (same + 16 <= bytes) {
+		__m128i e = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + same)),
+			_mm_loadu_si128((const __m128i *)(b + same)));
+		if (_mm_movemask_epi8(e) != 0xffff) break;
+		same += 16;
+	}
+#else
+	while (same + 16 <= bytes) {
+		uint64x2_t e = vreinterpretq_u64_u8(vceqq_u8(vld1q_u8(a + same),vld1q_u8(b + same)));
+		if ((vgetq_lane_u64(e,0) & vgetq_lane_u64(e,1)) != ~(Bit64u)0) break;
+		same += 16;
+	}
+#endif
+	return same;
+}
+
+/* Write count pixels each repeated width times */
+static INLINE void Scaler_Widen32(Bit32u * dst,const Bit32u * src,Bitu count,const Bitu width) {
+	Bitu i = 0;
+#if defined(RENDER_SIMD_SSE2)
+	for (;i + 4 <= count;i += 4,dst += 4 * width) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+		switch (width) {
+		case 1:
+			_mm_storeu_si128((__m128i *)dst,v);
+			break;
+		case 2:
+			_mm_storeu_si128((__m128i *)dst,_mm_unpacklo_epi32(v,v));
+			_mm_storeu_si128((__m128i *)(dst + 4),_mm_unpackhi_epi32(v,v));
+			break;
+		case 3:
+			_mm_storeu_si128((__m128i *)dst,_mm_shuffle_epi32(v,_MM_SHUFFLE(1,0,0,0)));
+			_mm_storeu_si128((__m128i *)(dst + 4),_mm_shuffle_epi32(v,_MM_SHUFFLE(2,2,1,1)));
+			_mm_storeu_si128((__m128i *)(dst + 8),_mm_shuffle_epi32(v,_MM_SHUFFLE(3,3,3,2)));
+			break;
+		}
+	}
+#else
+	for (;i + 4 <= count;i += 4,dst += 4 * width) {
+		uint32x4_t v = vld1q_u32(src + i);
+		switch (width) {
+		case 1:
+			vst1q_u32(dst,v);
+			break;
+		case 2: {
+			uint32x4x2_t v2 = { { v, v } };
+			vst2q_u32(dst,v2);
+			break;
+		}
+		case 3: {
+			uint32x4x3_t v3 = { { v, v, v } };
+			vst3q_u32(dst,v3);
+			break;
+		}
+		}
+	}
+#endif
+	for (;i < count;i++)
+		for (Bitu w = 0;w < width;w++)
+			*dst++ = src[i];
+}
+
+/* Scale every channel by 5/8 (shift 3) or 5/16 (shift 4), for the tv scalers */
+static INLINE void Scaler_Dim32(Bit32u * dst,const Bit32u * src,Bitu count,const Bitu shift) {
+	Bitu i = 0;
+#if defined(RENDER_SIMD_SSE2)
+	const __m128i rb = _mm_set1_epi32(0xff00ff);
+	const __m128i g = _mm_set1_epi32(0x00ff00);
+	for (;i + 4 <= count;i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i vrb = _mm_and_si128(v,rb);
+		__m128i vg = _mm_and_si128(v,g);
+		vrb = _mm_srli_epi32(_mm_add_epi32(vrb,_mm_slli_epi32(vrb,2)),(int)shift);
+		vg = _mm_srli_epi32(_mm_add_epi32(vg,_mm_slli_epi32(vg,2)),(int)shift);
+		_mm_storeu_si128((__m128i *)(dst + i),_mm_or_si128(_mm_and_si128(vrb,rb),_mm_and_si128(vg,g)));
+	}
+#else
+	const uint32x4_t rb = vdupq_n_u32(0xff00ff);
+	const uint32x4_t g = vdupq_n_u32(0x00ff00);
+	const int32x4_t right = vdupq_n_s32(-(int)shift);
+	for (;i + 4 <= count;i += 4) {
+		uint32x4_t v = vld1q_u32(src + i);
+		uint32x4_t vrb = vmulq_n_u32(vandq_u32(v,rb),5);
+		uint32x4_t vg = vmulq_n_u32(vandq_u32(v,g),5);
+		vrb = vandq_u32(vshlq_u32(vrb,right),rb);
+		vg = vandq_u32(vshlq_u32(vg,right),g);
+		vst1q_u32(dst + i,vorrq_u32(vrb,vg));
+	}
+#endif
+	for (;i < count;i++) {
+		Bit32u p = src[i];
+		dst[i] = ((((p & 0xff00ff) * 5) >> shift) & 0xff00ff) | ((((p & 0x00ff00) * 5) >> shift) & 0x00ff00);
+	}
+}
+
+#endif
+
+#endif
@@ -30,6 +30,11 @@ static void conc4d(SCALERNAME,SBPP,DBPP,L)(const void *s) {
 static void conc4d(SCALERNAME,SBPP,DBPP,R)(const void *s) {
 #endif
 #ifdef RENDER_NULL_INPUT
+#if (SBPP == 9)
+	/* An unchanged line is still in the cache, only the pixels using the
+	   changed palette entries are drawn again */
+	if (!s) s = render.scale.cacheRead;
+#else
 	if (!s) {
 		render.scale.cacheRead += render.scale.cachePitch;
 #if defined(SCALERLINEAR) 
@@ -40,6 +45,7 @@ static void conc4d(SCALERNAME,SBPP,DBPP,R)(const void *s) {
 		ScalerAddLines( 0, skipLines );
 		return;
 	}
+#endif
 #endif
 	/* Clear the complete line marker */
 	Bitu hadChange = 0;
@@ -61,10 +67,16 @@ static void conc4d(SCALERNAME,SBPP,DBPP,R)(const void *s) {
 #else 
 	for (Bits x=render.src.width;x>0;) {
 		if (*(Bitu const*)src == *(Bitu*)cache) {
-			x-=(sizeof(Bitu)/sizeof(SRCTYPE));
-			src+=(sizeof(Bitu)/sizeof(SRCTYPE));
-			cache+=(sizeof(Bitu)/sizeof(SRCTYPE));
-			line0+=(sizeof(Bitu)/sizeof(SRCTYPE))*SCALERWIDTH;
+#if defined(RENDER_SIMD)
+			Bitu same = Scaler_SameBytes(src,cache,x*sizeof(SRCTYPE))/sizeof(SRCTYPE);
+			if (same < sizeof(Bitu)/sizeof(SRCTYPE)) same = sizeof(Bitu)/sizeof(SRCTYPE);
+#else
+			const Bitu same = sizeof(Bitu)/sizeof(SRCTYPE);
+#endif
+			x-=same;
+			src+=same;
+			cache+=same;
+			line0+=same*SCALERWIDTH;
 #endif
 		} else {
 #if defined(SCALERLINEAR)
@@ -95,6 +107,25 @@ static void conc4d(SCALERNAME,SBPP,DBPP,R)(const void *s) {
 #endif
 #endif //defined(SCALERLINEAR)
 			hadChange = 1;
+#if defined(RENDER_SIMD) && defined(SCALERVECTOR) && (DBPP == 32)
+			/* Convert a run of pixels, then write out whole lines of it */
+			Bitu count = x > 32 ? 32 : x;
+			Bit32u pix[32];
+			for (Bitu i = 0;i < count;i++) {
+				const SRCTYPE S = src[i];
+				cache[i] = S;
+				pix[i] = PMAKE(S);
+			}
+			src += count;cache += count;x -= count;
+			SCALERVECTOR;
+			line0 += count * SCALERWIDTH;
+#if (SCALERHEIGHT > 1) 
+			line1 += count * SCALERWIDTH;
+#endif
+#if (SCALERHEIGHT > 2) 
+			line2 += count * SCALERWIDTH;
+#endif
+#else
 			for (Bitu i = x > 32 ? 32 : x;i>0;i--,x--) {
 				const SRCTYPE S = *src;
 				*cache = S;
@@ -115,6 +146,7 @@ static void conc4d(SCALERNAME,SBPP,DBPP,R)(const void *s) {
 				line4 += SCALERWIDTH;
 #endif
 			}
+#endif
 #if defined(SCALERLINEAR)
 #if (SCALERHEIGHT > 1)
 			Bitu copyLen = (Bitu)((Bit8u*)line1 - (Bit8u*)WC[0]);
@@ -20,8 +20,8 @@
 #define PSIZE 1
 #define PTYPE Bit8u
 #define WC scalerWriteCache.b8
-//#define FC scalerFrameCache.b8
-#define FC (*(scalerFrameCache_t*)(&scalerSourceCache.b32[400][0])).b8
+#define BWC band->writeCache->b8
+#define FC scalerFrameCache->b8
 #define redMask		0
 #define	greenMask	0
 #define blueMask	0
@@ -35,8 +35,8 @@
 #define PSIZE 2
 #define PTYPE Bit16u
 #define WC scalerWriteCache.b16
-//#define FC scalerFrameCache.b16
-#define FC (*(scalerFrameCache_t*)(&scalerSourceCache.b32[400][0])).b16
+#define BWC band->writeCache->b16
+#define FC scalerFrameCache->b16
 #if DBPP == 15
 #define	redMask		0x7C00
 #define	greenMask	0x03E0
@@ -62,8 +62,8 @@
 #define PSIZE 4
 #define PTYPE Bit32u
 #define WC scalerWriteCache.b32
-//#define FC scalerFrameCache.b32
-#define FC (*(scalerFrameCache_t*)(&scalerSourceCache.b32[400][0])).b32
+#define BWC band->writeCache->b32
+#define FC scalerFrameCache->b32
 #define redMask		0xff0000
 #define greenMask	0x00ff00
 #define blueMask	0x0000ff
@@ -79,7 +79,6 @@
 
 
 #if SBPP == 8 || SBPP == 9
-#define SC scalerSourceCache.b8
 #if DBPP == 8
 #define PMAKE(_VAL) (_VAL)
 #elif DBPP == 15
@@ -93,7 +92,6 @@
 #endif
 
 #if SBPP == 15
-#define SC scalerSourceCache.b16
 #ifdef WORDS_BIGENDIAN
 #if DBPP == 15   // GGGBBBBBxRRRRRGG -> xRRRRRGGGGGBBBBB
 #define PMAKE(_VAL) (((_VAL>>8)&0x00FF)|((_VAL<<8)&0xFF00))
@@ -115,7 +113,6 @@
 #endif
 
 #if SBPP == 16
-#define SC scalerSourceCache.b16
 #ifdef WORDS_BIGENDIAN
 #if DBPP == 15   // GGgBBBBBRRRRRGGG -> 0RRRRRGGGGGBBBBB
 #define PMAKE(_VAL) (((_VAL>>8)&0x001F)|((_VAL>>9)&0x0060)|((_VAL<<7)&0x7F80))
@@ -137,7 +134,6 @@
 #endif
 
 #if SBPP == 32
-#define SC scalerSourceCache.b32
 #ifdef WORDS_BIGENDIAN
 #if DBPP == 15   // BBBBBbbbGGGGGgggRRRRRrrrxxxxxxxx -> 0RRRRRGGGGGBBBBB
 #define PMAKE(_VAL) (PTYPE)(((_VAL>>27)&0x001F)|((_VAL>>14)&0x03E0)|((_VAL>>1)&0x7C00))
@@ -185,12 +181,16 @@
 #if RENDER_USE_ADVANCED_SCALERS>1
 static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 #ifdef RENDER_NULL_INPUT
+#if (SBPP == 9)
+	if (!s) s = render.scale.cacheRead;
+#else
 	if (!s) {
 		render.scale.cacheRead += render.scale.cachePitch;
 		render.scale.inLine++;
-		render.scale.complexHandler();
+		render.scale.complexLine();
 		return;
 	}
+#endif
 #endif
 	const SRCTYPE * src = (SRCTYPE*)s;
 	PTYPE *fc= &FC[render.scale.inLine+1][1];
@@ -205,6 +205,14 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 			PTYPE pixel = PMAKE(src[x]);
 			if (pixel != fc[x]) {
 #else 
+#if defined(RENDER_SIMD)
+		if (Scaler_SameBytes(src,sc,SCALER_BLOCKSIZE*sizeof(SRCTYPE)) == SCALER_BLOCKSIZE*sizeof(SRCTYPE)) {
+			fc += SCALER_BLOCKSIZE;
+			sc += SCALER_BLOCKSIZE;
+			src += SCALER_BLOCKSIZE;
+			continue;
+		}
+#endif
 		for (Bitu x=0;x<SCALER_BLOCKSIZE;x+=sizeof(Bitu)/sizeof(SRCTYPE)) {
 			if (*(Bitu const*)&src[x] != *(Bitu*)&sc[x]) {
 #endif
@@ -237,7 +245,7 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 		CC[render.scale.inLine+2][0] = 1;
 	}
 	render.scale.inLine++;
-	render.scale.complexHandler();
+	render.scale.complexLine();
 }
 #endif
 
@@ -262,11 +270,15 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 	line0[1] = P;								\
 	line1[0] = P;								\
 	line1[1] = P;
+#define SCALERVECTOR								\
+	Scaler_Widen32(line0,pix,count,2);			\
+	memcpy(line1,line0,count*2*sizeof(Bit32u));
 #include "render_simple.h"
 #undef SCALERNAME
 #undef SCALERWIDTH
 #undef SCALERHEIGHT
 #undef SCALERFUNC
+#undef SCALERVECTOR
 
 #define SCALERNAME		Normal3x
 #define SCALERWIDTH		3
@@ -281,11 +293,16 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 	line2[0] = P;								\
 	line2[1] = P;								\
 	line2[2] = P;
+#define SCALERVECTOR								\
+	Scaler_Widen32(line0,pix,count,3);			\
+	memcpy(line1,line0,count*3*sizeof(Bit32u));			\
+	memcpy(line2,line0,count*3*sizeof(Bit32u));
 #include "render_simple.h"
 #undef SCALERNAME
 #undef SCALERWIDTH
 #undef SCALERHEIGHT
 #undef SCALERFUNC
+#undef SCALERVECTOR
 
 #define SCALERNAME		NormalDw
 #define SCALERWIDTH		2
@@ -293,11 +310,14 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 #define SCALERFUNC								\
 	line0[0] = P;								\
 	line0[1] = P;
+#define SCALERVECTOR								\
+	Scaler_Widen32(line0,pix,count,2);
 #include "render_simple.h"
 #undef SCALERNAME
 #undef SCALERWIDTH
 #undef SCALERHEIGHT
 #undef SCALERFUNC
+#undef SCALERVECTOR
 
 #define SCALERNAME		NormalDh
 #define SCALERWIDTH		1
@@ -327,11 +347,16 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 	line1[0]=halfpixel;						\
 	line1[1]=halfpixel;						\
 }
+#define SCALERVECTOR								\
+	Scaler_Widen32(line0,pix,count,2);			\
+	Scaler_Dim32(pix,pix,count,3);			\
+	Scaler_Widen32(line1,pix,count,2);
 #include "render_simple.h"
 #undef SCALERNAME
 #undef SCALERWIDTH
 #undef SCALERHEIGHT
 #undef SCALERFUNC
+#undef SCALERVECTOR
 
 #define SCALERNAME		TV3x
 #define SCALERWIDTH		3
@@ -352,11 +377,21 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 	line2[1]=halfpixel;						\
 	line2[2]=halfpixel;						\
 }
+#define SCALERVECTOR								\
+{											\
+	Bit32u dim[32];			\
+	Scaler_Widen32(line0,pix,count,3);			\
+	Scaler_Dim32(dim,pix,count,3);			\
+	Scaler_Widen32(line1,dim,count,3);			\
+	Scaler_Dim32(dim,pix,count,4);			\
+	Scaler_Widen32(line2,dim,count,3);			\
+}
 #include "render_simple.h"
 #undef SCALERNAME
 #undef SCALERWIDTH
 #undef SCALERHEIGHT
 #undef SCALERFUNC
+#undef SCALERVECTOR
 
 #define SCALERNAME		RGB2x
 #define SCALERWIDTH		2
@@ -399,11 +434,15 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 	line0[1]=P;							\
 	line1[0]=0;							\
 	line1[1]=0;
+#define SCALERVECTOR								\
+	Scaler_Widen32(line0,pix,count,2);			\
+	memset(line1,0,count*2*sizeof(Bit32u));
 #include "render_simple.h"
 #undef SCALERNAME
 #undef SCALERWIDTH
 #undef SCALERHEIGHT
 #undef SCALERFUNC
+#undef SCALERVECTOR
 
 #define SCALERNAME		Scan3x
 #define SCALERWIDTH		3
@@ -418,11 +457,16 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 	line2[0]=0;				\
 	line2[1]=0;				\
 	line2[2]=0;
+#define SCALERVECTOR								\
+	Scaler_Widen32(line0,pix,count,3);			\
+	memcpy(line1,line0,count*3*sizeof(Bit32u));			\
+	memset(line2,0,count*3*sizeof(Bit32u));
 #include "render_simple.h"
 #undef SCALERNAME
 #undef SCALERWIDTH
 #undef SCALERHEIGHT
 #undef SCALERFUNC
+#undef SCALERVECTOR
 
 #endif		//#if RENDER_USE_ADVANCED_SCALERS>0
 
@@ -594,9 +638,9 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 #undef PTYPE
 #undef PMAKE
 #undef WC
+#undef BWC
 #undef LC
 #undef FC
-#undef SC
 #undef redMask
 #undef greenMask
 #undef blueMask
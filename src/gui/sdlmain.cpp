@@ -27,6 +27,8 @@
 #include <unistd.h>
 #include <stdarg.h>
 #include <sys/types.h>
+#include <atomic>
+#include <exception>
 #ifdef WIN32
 #include <signal.h>
 #include <process.h>
@@ -50,6 +52,8 @@
 #include "cross.h"
 #include "control.h"
 #include "render.h"
+#include "shm_output.h"
+#include "perf.h"
 
 //DWD BEGIN
 #if C_GAMELINK
@@ -227,6 +231,7 @@ enum SCREEN_TYPES	{
 // DWD BEGIN
 	,SCREEN_GAMELINK
 // DWD END
+	,SCREEN_SHM
 };
 
 enum PRIORITY_LEVELS {
@@ -239,6 +244,59 @@ enum PRIORITY_LEVELS {
 };
 
 
+#if C_GAMELINK
+/* A frame handed from the emulation to the presentation thread. Three of
+   them form a lock-free triple buffer: the emulation fills 'back', swaps it
+   with 'middle' and the presentation thread swaps 'middle' with 'front'. */
+struct GameLinkFrame {
+	Bit8u * pixels;
+	Bitu size;
+	Bit16u width, height;
+	double ratio;
+};
+#define GAMELINK_FRAME_FRESH 4	// set in present.middle when it holds an unsent frame
+#endif // C_GAMELINK
+
+/* With emuthread the emulation draws into its own buffer and hands the
+   frames to the main thread through a triple buffer like the Game Link one.
+   'changed' lists the lines that differ from the frame on the screen, in the
+   unchanged/changed runs GFX_EndUpdate takes. */
+struct EmuFrame {
+	Bit8u * pixels;
+	Bit32u seq;						// frame of the emulation it holds
+	Bit16u changed[SCALER_MAXHEIGHT+1];
+};
+#define EMU_FRAME_FRESH 4	// set in emu.middle when it holds an unshown frame
+
+struct EmuPresent {
+	Bit64u start, end;
+};
+
+/* Queue with one thread pushing and another one popping */
+template <typename T,Bitu SIZE> struct EmuQueue {
+	T items[SIZE];
+	std::atomic<Bitu> write;
+	std::atomic<Bitu> read;
+
+	bool Full(void) const {
+		return write.load(std::memory_order_relaxed) - read.load(std::memory_order_acquire) >= SIZE;
+	}
+	bool Push(const T & item) {
+		if (Full()) return false;
+		Bitu pos = write.load(std::memory_order_relaxed);
+		items[pos % SIZE] = item;
+		write.store(pos + 1,std::memory_order_release);
+		return true;
+	}
+	bool Pop(T & item) {
+		Bitu pos = read.load(std::memory_order_relaxed);
+		if (pos == write.load(std::memory_order_acquire)) return false;
+		item = items[pos % SIZE];
+		read.store(pos + 1,std::memory_order_release);
+		return true;
+	}
+};
+
 struct SDL_Block {
 	bool inited;
 	bool active;							//If this isn't set don't draw
@@ -302,13 +360,51 @@ struct SDL_Block {
 	struct {
 		Bitu pitch;
 		void * framebuf;
+		Bitu framesize;
 		GameLink::sSharedMMapInput_R2 input_prev;
 		GameLink::sSharedMMapInput_R2 input;
 		GameLink::sSharedMMapAudio_R1 audio;
 		bool want_mouse;
+		struct {
+			SDL_Thread * thread;
+			SDL_sem * wakeup;
+			volatile bool quit;
+			GameLinkFrame frames[3];
+			Bitu back, front;
+			std::atomic<Bitu> middle;
+		} present;
 	} gamelink;
 #endif // C_GAMELINK
 // DWD END
+	struct {
+		bool enabled;
+		bool running;					// the emulation is on its own thread
+		SDL_Thread * thread;
+		Uint32 main_id;
+		SDL_sem * wakeup;				// frames, calls and the end for the main thread
+		std::atomic<bool> done;
+		std::exception_ptr error;
+		/* The buffer the emulation draws into */
+		Bit8u * pixels;
+		Bitu pitch, lines, size;
+		bool updating;
+		Bit32u seq;
+		Bit32u lineSeq[SCALER_MAXHEIGHT];	// frame each line last changed in
+		EmuFrame frames[3];
+		Bitu back, front;
+		std::atomic<Bitu> middle;
+		std::atomic<Bit32u> shown;		// frame on the screen
+		/* A call the emulation waits on the main thread for */
+		struct {
+			void (*func)(void *);
+			void * arg;
+			std::atomic<bool> pending;
+			SDL_sem * done;
+			std::exception_ptr error;
+		} call;
+		EmuQueue<SDL_Event,256> events;
+		EmuQueue<EmuPresent,16> presents;
+	} emu;
 	struct {
 		SDL_Surface * surface;
 #if C_DDRAW
@@ -479,6 +575,103 @@ SDL_Surface* SDL_SetVideoMode_Wrap(int width,int height,int bpp,Bit32u flags){
 	return s;
 }
 
+/* SDL 1.2 wants the window, the GL context and the event pump on the main
+   thread. When the emulation runs on its own thread, it has the calls that
+   change the window run there and waits for them. While it waits the main
+   thread is free to change the state they share. */
+static bool GFX_OnCore(void) {
+	return sdl.emu.running && SDL_ThreadID() != sdl.emu.main_id;
+}
+
+static void GFX_RunOnMain(void (*func)(void *),void * arg) {
+	if (!GFX_OnCore()) {
+		func(arg);
+		return;
+	}
+	sdl.emu.call.func = func;
+	sdl.emu.call.arg = arg;
+	sdl.emu.call.pending.store(true,std::memory_order_release);
+	SDL_SemPost(sdl.emu.wakeup);
+	SDL_SemWait(sdl.emu.call.done);
+	if (sdl.emu.call.error) {
+		std::exception_ptr error = sdl.emu.call.error;
+		sdl.emu.call.error = std::exception_ptr();
+		std::rethrow_exception(error);
+	}
+}
+
+static void GFX_RunCall(void) {
+	if (!sdl.emu.call.pending.load(std::memory_order_acquire))
+		return;
+	try {
+		sdl.emu.call.func(sdl.emu.call.arg);
+	} catch (...) {
+		sdl.emu.call.error = std::current_exception();
+	}
+	sdl.emu.call.pending.store(false,std::memory_order_relaxed);
+	SDL_SemPost(sdl.emu.call.done);
+}
+
+static int GFX_PollSDLEvent(SDL_Event * event) {
+	while (SDL_PollEvent(event)) {
+#if SDL_XORG_FIX
+		// Special code for broken SDL with Xorg 1.20.1, where pairs of inputfocus gain and loss events are generated
+		// when locking the mouse in windowed mode.
+		if (event->type == SDL_ACTIVEEVENT && event->active.state == SDL_APPINPUTFOCUS && event->active.gain == 0) {
+			SDL_Event test; //Check if the next event would undo this one.
+			if (SDL_PeepEvents(&test,1,SDL_PEEKEVENT,SDL_ACTIVEEVENTMASK) == 1 && test.active.state == SDL_APPINPUTFOCUS && test.active.gain == 1) {
+				// Skip both events.
+				SDL_PeepEvents(&test,1,SDL_GETEVENT,SDL_ACTIVEEVENTMASK);
+				continue;
+			}
+		}
+#endif
+		return 1;
+	}
+	return 0;
+}
+
+/* The emulation thread gets the events the main thread pumped */
+static int GFX_PollEvent(SDL_Event * event) {
+	if (GFX_OnCore())
+		return sdl.emu.events.Pop(*event) ? 1 : 0;
+	return GFX_PollSDLEvent(event);
+}
+
+static void GFX_WaitEvent(SDL_Event * event) {
+	if (!GFX_OnCore()) {
+		SDL_WaitEvent(event);
+		return;
+	}
+	while (!sdl.emu.events.Pop(*event))
+		SDL_Delay(10);
+}
+
+static void GFX_PumpEvents(void) {
+	SDL_Event event;
+	while (!sdl.emu.events.Full() && GFX_PollSDLEvent(&event))
+		sdl.emu.events.Push(event);
+}
+
+/* The render measures the host refresh rate from the presents */
+static void GFX_Presented(Bit64u start) {
+	EmuPresent present;
+	present.start = start;
+	present.end = PERF_Now();
+	if (sdl.emu.running)
+		sdl.emu.presents.Push(present);
+	else
+		RENDER_Presented(present.start,present.end);
+}
+
+static void GFX_ShowCursorOnMain(void * toggle) {
+	SDL_ShowCursor(*(int *)toggle);
+}
+
+static void GFX_ShowCursor(int toggle) {
+	GFX_RunOnMain(&GFX_ShowCursorOnMain,&toggle);
+}
+
 extern const char* RunningProgram;
 // DWD BEGIN
 extern Bit32u RunningProgramHash[ 4 ];
@@ -488,7 +681,25 @@ extern bool CPU_CycleAutoAdjust;
 bool startup_state_numlock=false;
 bool startup_state_capslock=false;
 
+void GFX_SetTitle(Bit32s cycles,int frameskip,bool paused);
+
+struct GFX_SetTitleArgs {
+	Bit32s cycles;
+	int frameskip;
+	bool paused;
+};
+
+static void GFX_SetTitleOnMain(void * arg) {
+	GFX_SetTitleArgs * args = (GFX_SetTitleArgs *)arg;
+	GFX_SetTitle(args->cycles,args->frameskip,args->paused);
+}
+
 void GFX_SetTitle(Bit32s cycles,int frameskip,bool paused){
+	if (GFX_OnCore()) {
+		GFX_SetTitleArgs args = { cycles, frameskip, paused };
+		GFX_RunOnMain(&GFX_SetTitleOnMain,&args);
+		return;
+	}
 	char title[200] = { 0 };
 	
 // DWD BEGIN
@@ -623,7 +834,7 @@ void PauseDOSBox(bool pressed) { // DWD (was static)
 	KEYBOARD_ClrBuffer();
 	SDL_Delay(500);
 	SDL_Event event;
-	while (SDL_PollEvent(&event)) {
+	while (GFX_PollEvent(&event)) {
 		// flush event queue.
 	}
 
@@ -632,10 +843,10 @@ void PauseDOSBox(bool pressed) { // DWD (was static)
 		// Keep GameLink ticking over.
 		SDL_Delay(100);
 		GFX_OutputGameLink();
-		if ( SDL_PollEvent(&event) == 0 )
+		if ( GFX_PollEvent(&event) == 0 )
 			continue;
 #else // C_GAMELINK
-		SDL_WaitEvent(&event);    // since we're not polling, cpu usage drops to 0.
+		GFX_WaitEvent(&event);    // since we're not polling, cpu usage drops to 0.
 #endif // C_GAMELINK
 		switch (event.type) {
 
@@ -736,6 +947,13 @@ check_gotbpp:
 		break;
 #endif // C_GAMELINK
 // DWD END
+#if C_SHMOUTPUT
+	case SCREEN_SHM:
+		if (flags & GFX_RGBONLY || !(flags&GFX_CAN_32)) goto check_surface;
+		flags|=GFX_SCALING;
+		flags&=~(GFX_CAN_8|GFX_CAN_15|GFX_CAN_16);
+		break;
+#endif
 	default:
 		goto check_surface;
 		break;
@@ -744,7 +962,15 @@ check_gotbpp:
 }
 
 
+static void GFX_ResetScreenOnMain(void *) {
+	GFX_ResetScreen();
+}
+
 void GFX_ResetScreen(void) {
+	if (GFX_OnCore()) {
+		GFX_RunOnMain(&GFX_ResetScreenOnMain,0);
+		return;
+	}
 	GFX_Stop();
 	if (sdl.draw.callback)
 		(sdl.draw.callback)( GFX_CallBackReset );
@@ -899,7 +1125,137 @@ static bool LoadGLShaders(const char *src, GLuint *vertex, GLuint *fragment) {
 }
 #endif
 
+/* Size the emulation's buffer and the frames for the new mode. Runs on the
+   main thread, before the emulation thread starts or while it waits for
+   GFX_SetSize. */
+static void GFX_ResizeFrames(Bitu flags) {
+	Bitu bpp = (flags & GFX_CAN_32) ? 4 : (flags & (GFX_CAN_15|GFX_CAN_16)) ? 2 : 1;
+	sdl.emu.updating = false;
+	sdl.emu.pitch = sdl.draw.width * bpp;
+	sdl.emu.lines = flags ? sdl.draw.height : 0;
+	if (sdl.emu.lines > SCALER_MAXHEIGHT) sdl.emu.lines = SCALER_MAXHEIGHT;
+	Bitu size = sdl.emu.pitch * sdl.emu.lines;
+	if (sdl.emu.size < size) {
+		free(sdl.emu.pixels);
+		sdl.emu.pixels = (Bit8u *)malloc(size);
+		bool failed = !sdl.emu.pixels;
+		for (Bitu i=0;i<3;i++) {
+			free(sdl.emu.frames[i].pixels);
+			sdl.emu.frames[i].pixels = (Bit8u *)malloc(size);
+			if (!sdl.emu.frames[i].pixels) failed = true;
+		}
+		if (failed) E_Exit("SDL: Can't allocate the frames for the emulation thread");
+		sdl.emu.size = size;
+	}
+	/* Nothing of the old mode is on the screen, so every line is changed */
+	sdl.emu.seq++;
+	for (Bitu y=0;y<sdl.emu.lines;y++)
+		sdl.emu.lineSeq[y] = sdl.emu.seq;
+	for (Bitu i=0;i<3;i++)
+		sdl.emu.frames[i].seq = 0;
+	sdl.emu.middle.store(sdl.emu.middle.load() & 3);
+	sdl.emu.shown.store(0);
+}
+
+static bool GFX_StartFrame(Bit8u * & pixels,Bitu & pitch) {
+	if (!sdl.active || sdl.emu.updating || !sdl.emu.lines)
+		return false;
+	pixels = sdl.emu.pixels;
+	pitch = sdl.emu.pitch;
+	sdl.emu.updating = true;
+	return true;
+}
+
+/* Bring the back frame up to date and hand it to the main thread, unless
+   all of it is on the screen already */
+static void GFX_EndFrame(const Bit16u * changedLines) {
+	EmuPresent present;
+	while (sdl.emu.presents.Pop(present))
+		RENDER_Presented(present.start,present.end);
+	if (!sdl.emu.updating)
+		return;
+	sdl.emu.updating = false;
+	Bit32u seq = ++sdl.emu.seq;
+	Bitu y, index;
+	if (!changedLines) {
+		/* An aborted frame may have changed any line */
+		for (y=0;y<sdl.emu.lines;y++)
+			sdl.emu.lineSeq[y] = seq;
+		return;
+	}
+	for (y = 0, index = 0;y < sdl.emu.lines;index++) {
+		Bitu count = changedLines[index];
+		if (count > sdl.emu.lines - y) count = sdl.emu.lines - y;
+		if (index & 1) {
+			for (Bitu i=0;i<count;i++)
+				sdl.emu.lineSeq[y+i] = seq;
+		}
+		y += count;
+	}
+	EmuFrame * frame = &sdl.emu.frames[sdl.emu.back];
+	Bit32u shown = sdl.emu.shown.load(std::memory_order_acquire);
+	index = 0;
+	frame->changed[0] = 0;
+	for (y=0;y<sdl.emu.lines;y++) {
+		Bit32u line = sdl.emu.lineSeq[y];
+		if (line > frame->seq)
+			memcpy(frame->pixels + y * sdl.emu.pitch,sdl.emu.pixels + y * sdl.emu.pitch,sdl.emu.pitch);
+		if ((line > shown) != (bool)(index & 1))
+			frame->changed[++index] = 0;
+		frame->changed[index]++;
+	}
+	frame->seq = seq;
+	if (!index)
+		return;
+	sdl.emu.back = sdl.emu.middle.exchange(sdl.emu.back | EMU_FRAME_FRESH,std::memory_order_acq_rel) & 3;
+	SDL_SemPost(sdl.emu.wakeup);
+}
+
+/* Put the newest frame of the emulation on the screen */
+static void GFX_PresentFrame(void) {
+	if (!(sdl.emu.middle.load(std::memory_order_acquire) & EMU_FRAME_FRESH))
+		return;
+	sdl.emu.front = sdl.emu.middle.exchange(sdl.emu.front,std::memory_order_acq_rel) & 3;
+	const EmuFrame * frame = &sdl.emu.frames[sdl.emu.front];
+	Bit8u * pixels;
+	Bitu pitch;
+	if (!GFX_StartUpdate(pixels,pitch))
+		return;
+	bool full = false;
+#if C_OPENGL
+	/* The mapped buffer isn't kept from the last frame */
+	full = sdl.desktop.type == SCREEN_OPENGL && sdl.opengl.pixel_buffer_object;
+#endif
+	for (Bitu y = 0, index = 0;y < sdl.emu.lines;index++) {
+		Bitu count = frame->changed[index];
+		if (full || (index & 1)) {
+			for (Bitu i=0;i<count;i++)
+				memcpy(pixels + (y+i) * pitch,frame->pixels + (y+i) * sdl.emu.pitch,sdl.emu.pitch);
+		}
+		y += count;
+	}
+	GFX_EndUpdate(frame->changed);
+	sdl.emu.shown.store(frame->seq,std::memory_order_release);
+}
+
+struct GFX_SetSizeArgs {
+	Bitu width, height, flags;
+	double scalex, scaley;
+	GFX_CallBack_t callback;
+	Bitu result;
+};
+
+static void GFX_SetSizeOnMain(void * arg) {
+	GFX_SetSizeArgs * args = (GFX_SetSizeArgs *)arg;
+	args->result = GFX_SetSize(args->width,args->height,args->flags,args->scalex,args->scaley,args->callback);
+}
+
 Bitu GFX_SetSize(Bitu width,Bitu height,Bitu flags,double scalex,double scaley,GFX_CallBack_t callback) {
+	if (GFX_OnCore()) {
+		GFX_SetSizeArgs args = { width, height, flags, scalex, scaley, callback, 0 };
+		GFX_RunOnMain(&GFX_SetSizeOnMain,&args);
+		return args.result;
+	}
 	if (sdl.updating)
 		GFX_EndUpdate( 0 );
 
@@ -1276,8 +1632,11 @@ dosurface:
 	case SCREEN_GAMELINK:
 	{
 		sdl.surface = 0;
-		if (sdl.gamelink.framebuf == 0 ) {
-			sdl.gamelink.framebuf = malloc( SCALER_MAXWIDTH * SCALER_MAXHEIGHT * 4 );	// 32 bit color frame buffer
+		if (sdl.gamelink.framesize < width * height * 4) {
+			free(sdl.gamelink.framebuf);
+			sdl.gamelink.framesize = width * height * 4;
+			sdl.gamelink.framebuf = malloc( sdl.gamelink.framesize );	// 32 bit color frame buffer
+			if (!sdl.gamelink.framebuf) E_Exit("GAMELINK: Can't allocate a %dx%d frame buffer",(int)width,(int)height);
 		}
 		sdl.gamelink.pitch=width*4;
 
@@ -1287,20 +1646,37 @@ dosurface:
 	}
 #endif //C_GAMELINK
 // DWD END
+#if C_SHMOUTPUT
+	case SCREEN_SHM:
+		if (!SHMOUT_SetSize(width,height)) break;
+		sdl.desktop.type=SCREEN_SHM;
+		retFlags = GFX_CAN_32 | GFX_SCALING;
+		break;
+#endif
 	default:
 		goto dosurface;
 		break;
 	}//CASE
+	if (sdl.emu.enabled)
+		GFX_ResizeFrames(retFlags);
 	if (retFlags)
 		GFX_Start();
 	if (!sdl.mouse.autoenable) SDL_ShowCursor(sdl.mouse.autolock?SDL_DISABLE:SDL_ENABLE);
 	return retFlags;
 }
 
+static void GFX_SetShaderOnMain(void * src) {
+	GFX_SetShader((const char *)src);
+}
+
 void GFX_SetShader(const char* src) {
 #if C_OPENGL
 	if (!sdl.opengl.use_shader || src == sdl.opengl.shader_src)
 		return;
+	if (GFX_OnCore()) {
+		GFX_RunOnMain(&GFX_SetShaderOnMain,(void *)src);
+		return;
+	}
 
 	sdl.opengl.shader_src = src;
 	if (sdl.opengl.program_object) {
@@ -1310,7 +1686,15 @@ void GFX_SetShader(const char* src) {
 #endif
 }
 
+static void GFX_CaptureMouseOnMain(void *) {
+	GFX_CaptureMouse();
+}
+
 void GFX_CaptureMouse(void) {
+	if (GFX_OnCore()) {
+		GFX_RunOnMain(&GFX_CaptureMouseOnMain,0);
+		return;
+	}
 	sdl.mouse.locked=!sdl.mouse.locked;
 	if (sdl.mouse.locked) {
 		SDL_WM_GrabInput(SDL_GRAB_ON);
@@ -1322,7 +1706,17 @@ void GFX_CaptureMouse(void) {
         mouselocked=sdl.mouse.locked;
 }
 
+void GFX_UpdateSDLCaptureState(void);
+
+static void GFX_UpdateSDLCaptureStateOnMain(void *) {
+	GFX_UpdateSDLCaptureState();
+}
+
 void GFX_UpdateSDLCaptureState(void) {
+	if (GFX_OnCore()) {
+		GFX_RunOnMain(&GFX_UpdateSDLCaptureStateOnMain,0);
+		return;
+	}
 	if (sdl.mouse.locked) {
 		SDL_WM_GrabInput(SDL_GRAB_ON);
 		SDL_ShowCursor(SDL_DISABLE);
@@ -1363,7 +1757,15 @@ void sticky_keys(bool restore){
 }
 #endif
 
+static void GFX_SwitchFullScreenOnMain(void *) {
+	GFX_SwitchFullScreen();
+}
+
 void GFX_SwitchFullScreen(void) {
+	if (GFX_OnCore()) {
+		GFX_RunOnMain(&GFX_SwitchFullScreenOnMain,0);
+		return;
+	}
 	sdl.desktop.fullscreen=!sdl.desktop.fullscreen;
 	if (sdl.desktop.fullscreen) {
 		if (!sdl.mouse.locked) GFX_CaptureMouse();
@@ -1412,6 +1814,8 @@ void GFX_RestoreMode(void) {
 
 
 bool GFX_StartUpdate(Bit8u * & pixels,Bitu & pitch) {
+	if (GFX_OnCore())
+		return GFX_StartFrame(pixels,pitch);
 	if (!sdl.active || sdl.updating)
 		return false;
 	switch (sdl.desktop.type) {
@@ -1471,6 +1875,13 @@ bool GFX_StartUpdate(Bit8u * & pixels,Bitu & pitch) {
 		return true;
 #endif // C_GAMELINK
 // DWD END
+#if C_SHMOUTPUT
+	case SCREEN_SHM:
+		pixels=SHMOUT_StartFrame(pitch);
+		if (pixels == NULL) return false;
+		sdl.updating=true;
+		return true;
+#endif
 	default:
 		break;
 	}
@@ -1479,10 +1890,85 @@ bool GFX_StartUpdate(Bit8u * & pixels,Bitu & pitch) {
 
 // DWD BEGIN
 #if C_GAMELINK
+static int GameLink_PresentThread(void *) {
+	for (;;) {
+		SDL_SemWait(sdl.gamelink.present.wakeup);
+		if (sdl.gamelink.present.quit) break;
+		if (!(sdl.gamelink.present.middle.load() & GAMELINK_FRAME_FRESH)) continue;
+		sdl.gamelink.present.front = sdl.gamelink.present.middle.exchange(sdl.gamelink.present.front) & 3;
+		const GameLinkFrame * frame = &sdl.gamelink.present.frames[sdl.gamelink.present.front];
+		GameLink::OutFrame(frame->width,frame->height,frame->ratio,frame->pixels);
+	}
+	return 0;
+}
+
+static void GameLink_StartPresent(void) {
+	for (Bitu i=0;i<3;i++) {
+		/* Grown by the emulation thread when it fills the frame */
+		sdl.gamelink.present.frames[i].pixels = 0;
+		sdl.gamelink.present.frames[i].size = 0;
+		sdl.gamelink.present.frames[i].width = 0;
+		sdl.gamelink.present.frames[i].height = 0;
+	}
+	sdl.gamelink.present.back = 0;
+	sdl.gamelink.present.middle = 1;
+	sdl.gamelink.present.front = 2;
+	sdl.gamelink.present.quit = false;
+	sdl.gamelink.present.wakeup = SDL_CreateSemaphore(0);
+	sdl.gamelink.present.thread = SDL_CreateThread(&GameLink_PresentThread,0);
+	if (!sdl.gamelink.present.thread) {
+		LOG_MSG("GAMELINK: Can't start presentation thread, frames are sent directly.");
+		SDL_DestroySemaphore(sdl.gamelink.present.wakeup);
+		sdl.gamelink.present.wakeup = 0;
+	}
+}
+
+static void GameLink_StopPresent(void) {
+	if (!sdl.gamelink.present.thread) return;
+	sdl.gamelink.present.quit = true;
+	SDL_SemPost(sdl.gamelink.present.wakeup);
+	SDL_WaitThread(sdl.gamelink.present.thread,0);
+	sdl.gamelink.present.thread = 0;
+	SDL_DestroySemaphore(sdl.gamelink.present.wakeup);
+	sdl.gamelink.present.wakeup = 0;
+	for (Bitu i=0;i<3;i++) {
+		free(sdl.gamelink.present.frames[i].pixels);
+		sdl.gamelink.present.frames[i].pixels = 0;
+		sdl.gamelink.present.frames[i].size = 0;
+	}
+}
+
 void GFX_OutputGameLink()
 {
 	// don't check sdl.desktop.type == SCREEN_GAMELINK here, we may be in slim track-only mode.
 
+	if ( sdl.gamelink.present.thread && sdl.desktop.type == SCREEN_GAMELINK ) {
+		/* Hand the frame over, the presentation thread waits for the client */
+		GameLinkFrame * frame = &sdl.gamelink.present.frames[sdl.gamelink.present.back];
+		frame->width = (Bit16u)sdl.draw.width;
+		frame->height = (Bit16u)sdl.draw.height;
+		frame->ratio = render.src.ratio;
+		/* The back frame is never seen by the presentation thread */
+		if (frame->size < sdl.draw.width * sdl.draw.height * 4) {
+			free(frame->pixels);
+			frame->size = sdl.draw.width * sdl.draw.height * 4;
+			frame->pixels = (Bit8u *)malloc( frame->size );
+			if (!frame->pixels) E_Exit("GAMELINK: Can't allocate presentation frames");
+		}
+		memcpy( frame->pixels, sdl.gamelink.framebuf, sdl.draw.width * sdl.draw.height * 4 );
+		sdl.gamelink.present.back = sdl.gamelink.present.middle.exchange(
+			sdl.gamelink.present.back | GAMELINK_FRAME_FRESH ) & 3;
+		SDL_SemPost( sdl.gamelink.present.wakeup );
+
+		GameLink::Out( (Bit16u)sdl.draw.width, (Bit16u)sdl.draw.height, render.src.ratio,
+			sdl.gamelink.want_mouse,
+			RunningProgram,
+			RunningProgramHash,
+			NULL,
+			MemBase );
+		return;
+	}
+
 	GameLink::Out( (Bit16u)sdl.draw.width, (Bit16u)sdl.draw.height, render.src.ratio,
 		sdl.gamelink.want_mouse,
 		RunningProgram,
@@ -1497,6 +1983,10 @@ void GFX_EndUpdate( const Bit16u *changedLines ) {
 #if C_DDRAW
 	int ret;
 #endif
+	if (GFX_OnCore()) {
+		GFX_EndFrame(changedLines);
+		return;
+	}
 	if (((sdl.desktop.type != SCREEN_OPENGL) || !RENDER_GetForceUpdate()) && !sdl.updating)
 		return;
 	bool actually_updating = sdl.updating;
@@ -1509,6 +1999,11 @@ void GFX_EndUpdate( const Bit16u *changedLines ) {
 		break;
 #endif // C_GAMELINK
 // DWD END
+#if C_SHMOUTPUT
+	case SCREEN_SHM:
+		if (actually_updating) SHMOUT_EndFrame(changedLines,render.src.ratio);
+		break;
+#endif
 	case SCREEN_SURFACE:
 		if (SDL_MUSTLOCK(sdl.surface)) {
 			if (sdl.blit.surface) {
@@ -1518,7 +2013,9 @@ void GFX_EndUpdate( const Bit16u *changedLines ) {
 			} else {
 				SDL_UnlockSurface(sdl.surface);
 			}
+			Bit64u start = PERF_Now();
 			SDL_Flip(sdl.surface);
+			GFX_Presented(start);
 		} else if (changedLines) {
 			Bitu y = 0, index = 0, rectCount = 0;
 			while (y < sdl.draw.height) {
@@ -1539,8 +2036,11 @@ void GFX_EndUpdate( const Bit16u *changedLines ) {
 				}
 				index++;
 			}
-			if (rectCount)
+			if (rectCount) {
+				Bit64u start = PERF_Now();
 				SDL_UpdateRects( sdl.surface, rectCount, sdl.updateRects );
+				GFX_Presented(start);
+			}
 		}
 		break;
 #if C_DDRAW
@@ -1564,8 +2064,12 @@ void GFX_EndUpdate( const Bit16u *changedLines ) {
 		break;
 #endif
 	case SCREEN_OVERLAY:
-		SDL_UnlockYUVOverlay(sdl.overlay);
-		SDL_DisplayYUVOverlay(sdl.overlay,&sdl.clip);
+		{
+			SDL_UnlockYUVOverlay(sdl.overlay);
+			Bit64u start = PERF_Now();
+			SDL_DisplayYUVOverlay(sdl.overlay,&sdl.clip);
+			GFX_Presented(start);
+		}
 		break;
 #if C_OPENGL
 	case SCREEN_OPENGL:
@@ -1612,7 +2116,11 @@ void GFX_EndUpdate( const Bit16u *changedLines ) {
 			glUniform1i(sdl.opengl.ruby.frame_count, sdl.opengl.actual_frame_count++);
 			glDrawArrays(GL_TRIANGLES, 0, 3);
 		} else glCallList(sdl.opengl.displaylist);
-		SDL_GL_SwapBuffers();
+		{
+			Bit64u start = PERF_Now();
+			SDL_GL_SwapBuffers();
+			GFX_Presented(start);
+		}
 		break;
 #endif
 	default:
@@ -1621,7 +2129,22 @@ void GFX_EndUpdate( const Bit16u *changedLines ) {
 }
 
 
+struct GFX_SetPaletteArgs {
+	Bitu start, count;
+	GFX_PalEntry * entries;
+};
+
+static void GFX_SetPaletteOnMain(void * arg) {
+	GFX_SetPaletteArgs * args = (GFX_SetPaletteArgs *)arg;
+	GFX_SetPalette(args->start,args->count,args->entries);
+}
+
 void GFX_SetPalette(Bitu start,Bitu count,GFX_PalEntry * entries) {
+	if (GFX_OnCore()) {
+		GFX_SetPaletteArgs args = { start, count, entries };
+		GFX_RunOnMain(&GFX_SetPaletteOnMain,&args);
+		return;
+	}
 	/* I should probably not change the GFX_PalEntry :) */
 	if (sdl.surface->flags & SDL_HWPALETTE) {
 		if (!SDL_SetPalette(sdl.surface,SDL_PHYSPAL,(SDL_Color *)entries,start,count)) {
@@ -1654,6 +2177,7 @@ Bitu GFX_GetRGB(Bit8u red,Bit8u green,Bit8u blue) {
 // DWD BEGIN
 	case SCREEN_GAMELINK:
 // DWD END
+	case SCREEN_SHM:
 //		return ((red << 0) | (green << 8) | (blue << 16)) | (255 << 24);
 		//USE BGRA
 		return ((blue << 0) | (green << 8) | (red << 16)) | (255 << 24);
@@ -1661,7 +2185,15 @@ Bitu GFX_GetRGB(Bit8u red,Bit8u green,Bit8u blue) {
 	return 0;
 }
 
+static void GFX_StopOnMain(void *) {
+	GFX_Stop();
+}
+
 void GFX_Stop() {
+	if (GFX_OnCore()) {
+		GFX_RunOnMain(&GFX_StopOnMain,0);
+		return;
+	}
 	if (sdl.updating)
 		GFX_EndUpdate( 0 );
 	sdl.active=false;
@@ -1671,11 +2203,24 @@ void GFX_Start() {
 	sdl.active=true;
 }
 
-static void GUI_ShutDown(Section * /*sec*/) {
+static void GUI_ShutDown(Section * sec);
+
+static void GUI_ShutDownOnMain(void * sec) {
+	GUI_ShutDown((Section *)sec);
+}
+
+static void GUI_ShutDown(Section * sec) {
+	if (GFX_OnCore()) {
+		GFX_RunOnMain(&GUI_ShutDownOnMain,sec);
+		return;
+	}
 	GFX_Stop();
 	if (sdl.draw.callback) (sdl.draw.callback)( GFX_CallBackStop );
 	if (sdl.mouse.locked) GFX_CaptureMouse();
 	if (sdl.desktop.fullscreen) GFX_SwitchFullScreen();
+#if C_SHMOUTPUT
+	SHMOUT_Close();
+#endif
 }
 
 
@@ -1756,7 +2301,17 @@ static void OutputString(Bitu x,Bitu y,const char * text,Bit32u color,Bit32u col
 //extern void UI_Run(bool);
 void Restart(bool pressed);
 
+static void GUI_StartUp(Section * sec);
+
+static void GUI_StartUpOnMain(void * sec) {
+	GUI_StartUp((Section *)sec);
+}
+
 static void GUI_StartUp(Section * sec) {
+	if (GFX_OnCore()) {
+		GFX_RunOnMain(&GUI_StartUpOnMain,sec);
+		return;
+	}
 	sec->AddDestroyFunction(&GUI_ShutDown);
 	Section_prop * section=static_cast<Section_prop *>(sec);
 	sdl.active=false;
@@ -1969,6 +2524,15 @@ static void GUI_StartUp(Section * sec) {
 	} else if (output == "openglnb") {
 		sdl.desktop.want_type=SCREEN_OPENGL;
 		sdl.opengl.bilinear=false;
+#endif
+#if C_SHMOUTPUT
+	} else if (output == "shm") {
+		if (SHMOUT_Open(section->Get_string("shmname"))) {
+			sdl.desktop.want_type=SCREEN_SHM;
+		} else {
+			LOG_MSG("SDL: Can't use shared memory output, switching back to surface");
+			sdl.desktop.want_type=SCREEN_SURFACE;
+		}
 #endif
 	} else {
 		LOG_MSG("SDL: Unsupported output device %s, switching back to surface",output.c_str());
@@ -2039,6 +2603,14 @@ static void GUI_StartUp(Section * sec) {
 	} /* OPENGL is requested end */
 
 #endif	//OPENGL
+	if (!sdl.emu.running) {
+		/* The Game Link and shared memory outputs don't wait for the host */
+		sdl.emu.enabled = section->Get_bool("emuthread") &&
+			sdl.desktop.want_type != SCREEN_GAMELINK && sdl.desktop.want_type != SCREEN_SHM;
+		sdl.emu.back = 0;
+		sdl.emu.middle = 1;
+		sdl.emu.front = 2;
+	}
 	/* Initialize screen for first time */
 	sdl.surface=SDL_SetVideoMode_Wrap(640,400,0,0);
 	if (sdl.surface == NULL) E_Exit("Could not initialize video: %s",SDL_GetError());
@@ -2081,6 +2653,10 @@ static void GUI_StartUp(Section * sec) {
 			
 				KillSwitch( true );
 			}
+
+			if ( sdl.desktop.want_type == SCREEN_GAMELINK && section->Get_bool("presentthread") ) {
+				GameLink_StartPresent();
+			}
 		}
 	}
 #endif // C_GAMELINK
@@ -2145,7 +2721,7 @@ void Mouse_AutoLock(bool enable) {
 		sdl.mouse.autolock = enable;
 		if ( sdl.mouse.autoenable ) sdl.mouse.requestlock = enable;
 		else {
-			SDL_ShowCursor( enable ? SDL_DISABLE : SDL_ENABLE );
+			GFX_ShowCursor( enable ? SDL_DISABLE : SDL_ENABLE );
 			sdl.mouse.requestlock = false;
 		}
 	}
@@ -2211,7 +2787,17 @@ bool GFX_IsFullscreen(void) {
 }
 
 // === DWD BEGIN - moved here from sdl_mapper.cpp
+void MAPPER_RunEvent(Bitu /*val*/);
+
+static void MAPPER_RunOnMain(void *) {
+	MAPPER_RunEvent(0);
+}
+
 void MAPPER_RunEvent(Bitu /*val*/) {
+	if (GFX_OnCore()) {
+		GFX_RunOnMain(&MAPPER_RunOnMain,0);
+		return;
+	}
 	KEYBOARD_ClrBuffer();	//Clear buffer
 	GFX_LosingFocus();		//Release any keys pressed (buffer gets filled again).
 	MAPPER_RunInternal();
@@ -2363,20 +2949,7 @@ void GFX_Events() {
 
 	int run_mapper = 0; // DWD
 	
-	while (SDL_PollEvent(&event)) {
-#if SDL_XORG_FIX
-		// Special code for broken SDL with Xorg 1.20.1, where pairs of inputfocus gain and loss events are generated
-		// when locking the mouse in windowed mode.
-		if (event.type == SDL_ACTIVEEVENT && event.active.state == SDL_APPINPUTFOCUS && event.active.gain == 0) {
-			SDL_Event test; //Check if the next event would undo this one.
-			if (SDL_PeepEvents(&test,1,SDL_PEEKEVENT,SDL_ACTIVEEVENTMASK) == 1 && test.active.state == SDL_APPINPUTFOCUS && test.active.gain == 1) {
-				// Skip both events.
-				SDL_PeepEvents(&test,1,SDL_GETEVENT,SDL_ACTIVEEVENTMASK);
-				continue;
-			}
-		}
-#endif
-
+	while (GFX_PollEvent(&event)) {
 		switch (event.type) {
 		case SDL_ACTIVEEVENT:
 //DWD BEGIN
@@ -2430,7 +3003,7 @@ void GFX_Events() {
 
 					while (paused) {
 						// WaitEvent waits for an event rather than polling, so CPU usage drops to zero
-						SDL_WaitEvent(&ev);
+						GFX_WaitEvent(&ev);
 
 						switch (ev.type) {
 						case SDL_QUIT: throw(0); break; // a bit redundant at linux at least as the active events gets before the quit event.
@@ -2687,6 +3260,9 @@ void Config_Add_SDL() {
 		"gamelink",
 #endif
 // DWD END
+#if C_SHMOUTPUT
+		"shm",
+#endif
 		0 };
  	
 
@@ -2698,6 +3274,13 @@ void Config_Add_SDL() {
 	Pstring->Set_help("What video system to use for output.");
 	Pstring->Set_values(outputs);
 
+#if C_SHMOUTPUT
+	Pstring = sdl_sec->Add_string("shmname",Property::Changeable::OnlyAtStart,"dosbox-frames");
+	Pstring->Set_help("Name of the shared memory object that output=shm writes the frames to (/dev/shm/<name> on Linux).\n"
+	                  "The layout is described in include/shm_output.h. Without a display, run with SDL_VIDEODRIVER=dummy.\n"
+	                  "The object is only readable by the user running DOSBox. Instances running at the same time need different names.");
+#endif
+
 	Pbool = sdl_sec->Add_bool("autolock",Property::Changeable::Always,true);
 	Pbool->Set_help("Mouse will automatically lock, if you click on the screen. (Press CTRL-F10 to unlock)");
 
@@ -2735,6 +3318,13 @@ void Config_Add_SDL() {
 	Pbool = sdl_sec->Add_bool("gamelinkmaster",Property::Changeable::Always,true);
 	Pbool->Set_help("Master enable for Game Link. Use this to completely disable Game Link including video, input and tracking.");
 // DWD END
+
+	Pbool = sdl_sec->Add_bool("presentthread",Property::Changeable::OnlyAtStart,false);
+	Pbool->Set_help("Send Game Link frames from a separate thread, so a slow client never holds up the emulation.");
+
+	Pbool = sdl_sec->Add_bool("emuthread",Property::Changeable::OnlyAtStart,false);
+	Pbool->Set_help("Run the emulation on its own thread. The main thread puts the frames on the screen and reads the input,\n"
+	                "so a slow buffer swap or event pump doesn't hold up the emulation. Not used with output=gamelink or shm.");
 }
 
 static void show_warning(char const * const message) {
@@ -2805,9 +3395,20 @@ static void launcheditor() {
 extern void DEBUG_ShutDown(Section * /*sec*/);
 #endif
 
+void restart_program(std::vector<std::string> & parameters);
+
+static void RestartProgramOnMain(void * parameters) {
+	restart_program(*(std::vector<std::string> *)parameters);
+}
+
 void restart_program(std::vector<std::string> & parameters) {
+	if (GFX_OnCore()) {
+		GFX_RunOnMain(&RestartProgramOnMain,&parameters);
+		return;
+	}
 // DWD BEGIN
 #if C_GAMELINK
+	GameLink_StopPresent();
 	GameLink::Term();
 #endif // C_GAMELINK
 // DWD END
@@ -2933,6 +3534,56 @@ void Disable_OS_Scaling() {
 #endif
 }
 
+static int GFX_EmulationThread(void *) {
+	try {
+		control->StartUp();
+	} catch (...) {
+		sdl.emu.error = std::current_exception();
+	}
+	sdl.emu.done.store(true,std::memory_order_release);
+	SDL_SemPost(sdl.emu.wakeup);
+	return 0;
+}
+
+/* Run the machine. With emuthread it runs on its own thread, while this one
+   puts its frames on the screen, pumps the events to it and runs the calls
+   it makes to SDL. Sound already plays from SDL's audio thread. */
+static void GFX_RunEmulation(void) {
+	if (!sdl.emu.enabled) {
+		control->StartUp();
+		return;
+	}
+	sdl.emu.main_id = SDL_ThreadID();
+	sdl.emu.wakeup = SDL_CreateSemaphore(0);
+	sdl.emu.call.done = SDL_CreateSemaphore(0);
+	sdl.emu.done = false;
+	/* Anything drawn so far went straight to the screen */
+	if (sdl.draw.callback) sdl.draw.callback( GFX_CallBackRedraw );
+	sdl.emu.running = true;
+	sdl.emu.thread = SDL_CreateThread(&GFX_EmulationThread,0);
+	if (!sdl.emu.thread) {
+		LOG_MSG("SDL: Can't start the emulation thread, running it on the main thread.");
+		sdl.emu.running = false;
+		SDL_DestroySemaphore(sdl.emu.wakeup);
+		SDL_DestroySemaphore(sdl.emu.call.done);
+		control->StartUp();
+		return;
+	}
+	while (!sdl.emu.done.load(std::memory_order_acquire)) {
+		SDL_SemWaitTimeout(sdl.emu.wakeup,5);
+		GFX_RunCall();
+		GFX_PresentFrame();
+		GFX_PumpEvents();
+	}
+	SDL_WaitThread(sdl.emu.thread,0);
+	sdl.emu.thread = 0;
+	sdl.emu.running = false;
+	SDL_DestroySemaphore(sdl.emu.wakeup);
+	SDL_DestroySemaphore(sdl.emu.call.done);
+	if (sdl.emu.error)
+		std::rethrow_exception(sdl.emu.error);
+}
+
 //extern void UI_Init(void);
 int main(int argc, char* argv[]) {
 	try {
@@ -3158,7 +3809,7 @@ int main(int argc, char* argv[]) {
 		MAPPER_Init();
 		if (control->cmdline->FindExist("-startmapper")) MAPPER_RunInternal();
 		/* Start up main machine */
-		control->StartUp();
+		GFX_RunEmulation();
 		/* Shutdown everything */
 	} catch (char * error) {
 #if defined (WIN32)
@@ -3193,6 +3844,7 @@ int main(int argc, char* argv[]) {
 	
 // DWD BEGIN
 #if C_GAMELINK
+	GameLink_StopPresent();
 	GameLink::Term();
 #endif // C_GAMELINK
 // DWD END
@@ -0,0 +1,183 @@
+/*
+ *  Copyright (C) 2002-2020  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "dosbox.h"
+
+#if C_SHMOUTPUT
+
+#include <string.h>
+#include <string>
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "shm_output.h"
+#include "perf.h"
+
+#define SHMOUT_PAGEALIGN(_VAL) (((Bitu)(_VAL) + 4095) & ~(Bitu)4095)
+
+static struct {
+	ShmOutputHeader * header;
+	Bitu size;
+	int fd;
+	std::string name;
+	Bitu width, height;
+	Bitu slot;					// slot being drawn
+	Bit32u number;
+	/* Lines that changed in the other slots since a slot was drawn */
+	Bit8u stale[SHMOUT_SLOTS][SHMOUT_MAXHEIGHT];
+} shmout;
+
+static Bit8u * SHMOUT_Pixels(Bitu slot) {
+	return (Bit8u *)shmout.header + shmout.header->headerSize + slot * shmout.header->slotSize;
+}
+
+bool SHMOUT_Open(const char * name) {
+	SHMOUT_Close();
+	shmout.name = (name[0] == '/') ? name : std::string("/") + name;
+	Bitu headerSize = SHMOUT_PAGEALIGN(sizeof(ShmOutputHeader));
+	Bitu slotSize = SHMOUT_PAGEALIGN(SHMOUT_MAXWIDTH * SHMOUT_MAXHEIGHT * 4);
+	shmout.size = headerSize + SHMOUT_SLOTS * slotSize;
+	/* Only the user running DOSBox can open the frames. An existing object
+	   may be in use by another instance, so it is never taken over. */
+	shmout.fd = shm_open(shmout.name.c_str(),O_CREAT | O_EXCL | O_RDWR,0600);
+	if (shmout.fd < 0) {
+		if (errno == EEXIST)
+			LOG_MSG("SHM: %s already exists, another instance may use it. Set a different shmname, or remove it if it was left by a crash",shmout.name.c_str());
+		else LOG_MSG("SHM: Can't create %s",shmout.name.c_str());
+		return false;
+	}
+	/* The slots only take memory once frames of that size are drawn */
+	void * map = MAP_FAILED;
+	if (ftruncate(shmout.fd,(off_t)shmout.size) == 0)
+		map = mmap(0,shmout.size,PROT_READ | PROT_WRITE,MAP_SHARED,shmout.fd,0);
+	if (map == MAP_FAILED) {
+		LOG_MSG("SHM: Can't map %d bytes of %s",(int)shmout.size,shmout.name.c_str());
+		close(shmout.fd);
+		shm_unlink(shmout.name.c_str());
+		shmout.fd = -1;
+		return false;
+	}
+	ShmOutputHeader * header = (ShmOutputHeader *)map;
+	memset(header,0,sizeof(ShmOutputHeader));
+	header->version = SHMOUT_VERSION;
+	header->headerSize = (Bit32u)headerSize;
+	header->slotSize = (Bit32u)slotSize;
+	header->slots = SHMOUT_SLOTS;
+	header->maxWidth = SHMOUT_MAXWIDTH;
+	header->maxHeight = SHMOUT_MAXHEIGHT;
+	header->latest = SHMOUT_NOFRAME;
+	/* Readers wait for the magic */
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = SHMOUT_MAGIC;
+	shmout.header = header;
+	shmout.width = 0;
+	shmout.height = 0;
+	shmout.number = 0;
+	memset(shmout.stale,1,sizeof(shmout.stale));
+	LOG_MSG("SHM: Writing frames to %s",shmout.name.c_str());
+	return true;
+}
+
+void SHMOUT_Close(void) {
+	if (!shmout.header) return;
+	munmap(shmout.header,shmout.size);
+	close(shmout.fd);
+	//The header is only set for an object this process created
+	shm_unlink(shmout.name.c_str());
+	shmout.header = 0;
+	shmout.fd = -1;
+}
+
+bool SHMOUT_SetSize(Bitu width,Bitu height) {
+	if (width > SHMOUT_MAXWIDTH || height > SHMOUT_MAXHEIGHT) {
+		LOG_MSG("SHM: %dx%d doesn't fit the %dx%d slots",(int)width,(int)height,SHMOUT_MAXWIDTH,SHMOUT_MAXHEIGHT);
+		return false;
+	}
+	shmout.width = width;
+	shmout.height = height;
+	memset(shmout.stale,1,sizeof(shmout.stale));
+	return true;
+}
+
+Bit8u * SHMOUT_StartFrame(Bitu & pitch) {
+	if (!shmout.header || !shmout.width) return 0;
+	ShmOutputHeader * header = shmout.header;
+	Bitu latest = header->latest;
+	Bitu slot = (latest == SHMOUT_NOFRAME) ? 0 : (latest + 1) % SHMOUT_SLOTS;
+	ShmOutputFrame * frame = &header->frame[slot];
+	frame->seq++;
+	std::atomic_thread_fence(std::memory_order_release);
+	pitch = shmout.width * 4;
+	Bit8u * pixels = SHMOUT_Pixels(slot);
+	/* Only the changed lines are drawn, so first bring the slot up to date
+	   with the latest frame. After a size change the whole frame is drawn. */
+	if (latest != SHMOUT_NOFRAME && header->frame[latest].width == shmout.width &&
+		header->frame[latest].height == shmout.height) {
+		const Bit8u * src = SHMOUT_Pixels(latest);
+		for (Bitu y = 0;y < shmout.height;y++) {
+			if (shmout.stale[slot][y]) memcpy(pixels + y * pitch,src + y * pitch,pitch);
+		}
+	}
+	memset(shmout.stale[slot],0,shmout.height);
+	shmout.slot = slot;
+	return pixels;
+}
+
+void SHMOUT_EndFrame(const Bit16u * changedLines,double ratio) {
+	if (!shmout.header) return;
+	ShmOutputHeader * header = shmout.header;
+	ShmOutputFrame * frame = &header->frame[shmout.slot];
+	if (!changedLines) {
+		/* Whatever was drawn is refreshed from the latest frame next time */
+		memset(shmout.stale[shmout.slot],1,shmout.height);
+		std::atomic_thread_fence(std::memory_order_release);
+		frame->seq++;
+		return;
+	}
+	Bitu y = 0, index = 0;
+	while (y < shmout.height && index < SHMOUT_MAXHEIGHT + 2) {
+		Bitu count = changedLines[index];
+		frame->changed[index] = (Bit16u)count;
+		if (index & 1) {
+			Bitu lines = (y + count > shmout.height) ? shmout.height - y : count;
+			for (Bitu s = 0;s < SHMOUT_SLOTS;s++) {
+				if (s != shmout.slot) memset(&shmout.stale[s][y],1,lines);
+			}
+		}
+		y += count;
+		index++;
+	}
+	frame->changedCount = (Bit32u)index;
+	frame->number = ++shmout.number;
+	frame->timestamp = PERF_Now();
+	frame->width = (Bit32u)shmout.width;
+	frame->height = (Bit32u)shmout.height;
+	frame->pitch = (Bit32u)(shmout.width * 4);
+	frame->format = SHMOUT_FORMAT_ARGB32;
+	frame->ratio = (float)ratio;
+	std::atomic_thread_fence(std::memory_order_release);
+	frame->seq++;
+	header->latest = (Bit32u)shmout.slot;
+}
+
+#endif // C_SHMOUTPUT
@@ -489,6 +489,62 @@ Bit8u Chip::Read( ) {
 	return ret;
 }
 
+void Module::FlushEvents() {
+	for ( Bitu i = 0; i < eventCount; i++ ) {
+		handler->WriteReg( events[i].reg, events[i].val );
+	}
+	eventCount = 0;
+}
+
+void Module::HandlerWrite( Bit32u reg, Bit8u val ) {
+	//The opl3 enable changes the way the handlers decode the next address,
+	//so it can't wait for the sound to be generated
+	if ( reg == 0x105 || eventCount >= sizeof( events ) / sizeof( events[0] ) ) {
+		//Generate up to now, so the queued writes still land at their sample
+		fillIndex = PIC_TickIndex();
+		mixerChan->FillUp();
+		fillIndex = 1.0f;
+		FlushEvents();
+		handler->WriteReg( reg, val );
+		return;
+	}
+	events[eventCount].reg = reg;
+	events[eventCount].val = val;
+	events[eventCount].index = PIC_TickIndex();
+	eventCount++;
+}
+
+void Module::Generate( Bitu samples ) {
+	//The part of the tick this generates, it starts later than the tick when
+	//a flush generated up to a write, or the last tick gave some samples extra
+	float end = fillIndex;
+	float start = mixerChan->needed ? end * mixerChan->done / mixerChan->needed : 0.0f;
+	float length = end - start;
+	Bitu done = 0;
+	//Generate up to the sample each write happened at
+	for ( Bitu i = 0; i < eventCount; i++ ) {
+		Bitu pos = 0;
+		if ( events[i].index > start && length > 0.0f )
+			pos = (Bitu)( ( events[i].index - start ) / length * samples );
+		if ( pos > samples )
+			pos = samples;
+		if ( pos > done ) {
+			handler->Generate( mixerChan, pos - done );
+			done = pos;
+		}
+		handler->WriteReg( events[i].reg, events[i].val );
+	}
+	eventCount = 0;
+	if ( done >= samples )
+		return;
+	//Nothing to hear until the next write
+	if ( handler->Silent() ) {
+		mixerChan->AddSilence();
+		return;
+	}
+	handler->Generate( mixerChan, samples - done );
+}
+
 void Module::CacheWrite( Bit32u reg, Bit8u val ) {
 	//capturing?
 	if ( capture ) {
@@ -517,7 +573,7 @@ void Module::DualWrite( Bit8u index, Bit8u reg, Bit8u val ) {
 		val |= index ? 0xA0 : 0x50;
 	}
 	Bit32u fullReg = reg + (index ? 0x100 : 0);
-	handler->WriteReg( fullReg, val );
+	HandlerWrite( fullReg, val );
 	CacheWrite( fullReg, val );
 }
 
@@ -559,6 +615,7 @@ void Module::PortWrite( Bitu port, Bitu val, Bitu iolen ) {
 	if ( !mixerChan->enabled ) {
 		mixerChan->Enable(true);
 	}
+	mixerChan->WakeUp();
 	if ( port&1 ) {
 		switch ( mode ) {
 		case MODE_OPL3GOLD:
@@ -572,7 +629,7 @@ void Module::PortWrite( Bitu port, Bitu val, Bitu iolen ) {
 		case MODE_OPL2:
 		case MODE_OPL3:
 			if ( !chip[0].Write( reg.normal, val ) ) {
-				handler->WriteReg( reg.normal, val );
+				HandlerWrite( reg.normal, val );
 				CacheWrite( reg.normal, val );
 			}
 			break;
@@ -688,7 +745,7 @@ void Module::Init( Mode m ) {
 static Adlib::Module* module = 0;
 
 static void OPL_CallBack(Bitu len) {
-	module->handler->Generate( module->mixerChan, len );
+	module->Generate( len );
 	//Disable the sound generation after 30 seconds of silence
 	if ((PIC_Ticks - module->lastUsed) > 30000) {
 		Bitu i;
@@ -776,6 +833,8 @@ Module::Module( Section* configuration ) : Module_base(configuration) {
 	ctrl.rvol = 0xff;
 	handler = 0;
 	capture = 0;
+	eventCount = 0;
+	fillIndex = 1.0f;
 
 	Section_prop * section=static_cast<Section_prop *>(configuration);
 	Bitu base = section->Get_hex("sbbase");
@@ -789,6 +848,7 @@ Module::Module( Section* configuration ) : Module_base(configuration) {
 	mixerChan = mixerObject.Install(OPL_CallBack,rate,"FM");
 	//Used to be 2.0, which was measured to be too high. Exact value depends on card/clone.
 	mixerChan->SetScale( 1.5f );  
+	mixerChan->SetAutoSleep( true );
 
 	if (oplemu == "fast") {
 		handler = new DBOPL::Handler();
@@ -131,6 +131,10 @@ public:
 	virtual void Generate( MixerChannel* chan, Bitu samples ) = 0;
 	//Initialize at a specific sample rate and mode
 	virtual void Init( Bitu rate ) = 0;
+	//True when the output stays silent until the next register write
+	virtual bool Silent() {
+		return false;
+	}
 	virtual ~Handler() {
 	}
 };
@@ -160,6 +164,18 @@ class Module: public Module_base {
 		Bit8u rvol;
 		bool mixer;
 	} ctrl;
+	//Register writes of the current tick, applied when the sound is generated
+	struct {
+		Bit32u reg;
+		Bit8u val;
+		//Position of the write in the tick
+		float index;
+	} events[ 1024 ];
+	Bitu eventCount;
+	//Position in the tick the sound is generated up to, below 1 while a flush fills up
+	float fillIndex;
+	void HandlerWrite( Bit32u reg, Bit8u val );
+	void FlushEvents();
 	void CacheWrite( Bit32u reg, Bit8u val );
 	void DualWrite( Bit8u index, Bit8u reg, Bit8u val );
 	void CtrlWrite( Bit8u val );
@@ -174,6 +190,8 @@ public:
 	Capture* capture;
 	Chip	chip[2];
 
+	//Generate the sound of the tick up to each register write
+	void Generate( Bitu samples );
 	//Handle port writes
 	void PortWrite( Bitu port, Bitu val, Bitu iolen );
 	Bitu PortRead( Bitu port, Bitu iolen );
@@ -40,6 +40,7 @@
 #include <stddef.h>
 #include "dosbox.h"
 #include "dbopl.h"
+#include "mixer_simd.h"
 
 
 #ifndef PI
@@ -176,6 +177,10 @@ static Bit16u MulTable[ 384 ];
 #endif
 
 static Bit8u KslTable[ 8 * 16 ];
+#if !defined(DBOPL_NO_BLOCK)
+//The noise generator 8 steps at a time, indexed by the low bits that get shifted out
+static Bit32u NoiseTable[ 256 ];
+#endif
 static Bit8u TremoloTable[ TREMOLO_TABLE ];
 //Start of a channel behind the chip struct start
 static Bit16u ChanOffsetTable[32];
@@ -587,8 +592,7 @@ INLINE Bits Operator::GetWave( Bitu index, Bitu vol ) {
 #endif
 }
 
-Bits INLINE Operator::GetSample( Bits modulation ) {
-	Bitu vol = ForwardVolume();
+Bits INLINE Operator::GetSample( Bits modulation, Bitu vol ) {
 	if ( ENV_SILENT( vol ) ) {
 		//Simply forward the wave
 		waveIndex += waveCurrent;
@@ -600,6 +604,142 @@ Bits INLINE Operator::GetSample( Bits modulation ) {
 	}
 }
 
+Bits INLINE Operator::GetSample( Bits modulation ) {
+	return GetSample( modulation, ForwardVolume() );
+}
+
+#if !defined(DBOPL_NO_BLOCK)
+//Fill in the envelope volumes of the next samples, a state at a time
+//Does the same steps as the TemplateVolume handlers, but keeps the envelope in registers
+void Operator::ForwardVolumeBlock( Bit32u samples, Bit32u* output ) {
+	Bit32u i = 0;
+	Bit32s vol = volume;
+	Bit32u rate = rateIndex;
+	while ( i < samples ) {
+		switch ( state ) {
+		case OFF:
+			for ( ; i < samples; i++ ) {
+				output[i] = currentLevel + ENV_MAX;
+			}
+			break;
+		case ATTACK:
+			for ( ; i < samples; i++ ) {
+				rate += attackAdd;
+				Bit32s change = rate >> RATE_SH;
+				rate &= RATE_MASK;
+				if ( change ) {
+					vol += ( (~vol) * change ) >> 3;
+					if ( vol < ENV_MIN ) {
+						vol = ENV_MIN;
+						rate = 0;
+						SetState( DECAY );
+						output[i++] = currentLevel + ENV_MIN;
+						break;
+					}
+				}
+				output[i] = currentLevel + vol;
+			}
+			break;
+		case DECAY:
+			for ( ; i < samples; i++ ) {
+				rate += decayAdd;
+				vol += rate >> RATE_SH;
+				rate &= RATE_MASK;
+				if ( GCC_UNLIKELY(vol >= sustainLevel) ) {
+					//Check if we didn't overshoot max attenuation, then just go off
+					if ( GCC_UNLIKELY(vol >= ENV_MAX) ) {
+						vol = ENV_MAX;
+						SetState( OFF );
+					} else {
+						//Continue as sustain
+						rate = 0;
+						SetState( SUSTAIN );
+					}
+					output[i++] = currentLevel + vol;
+					break;
+				}
+				output[i] = currentLevel + vol;
+			}
+			break;
+		case SUSTAIN:
+			if ( reg20 & MASK_SUSTAIN ) {
+				for ( ; i < samples; i++ ) {
+					output[i] = currentLevel + vol;
+				}
+				break;
+			}
+			//In sustain phase, but not sustaining, do regular release
+		case RELEASE:
+			for ( ; i < samples; i++ ) {
+				rate += releaseAdd;
+				vol += rate >> RATE_SH;
+				rate &= RATE_MASK;
+				if ( GCC_UNLIKELY(vol >= ENV_MAX) ) {
+					vol = ENV_MAX;
+					SetState( OFF );
+					output[i++] = currentLevel + ENV_MAX;
+					break;
+				}
+				output[i] = currentLevel + vol;
+			}
+			break;
+		}
+	}
+	volume = vol;
+	rateIndex = rate;
+}
+
+//Add the samples of an operator to the output
+static INLINE void AddBlock( Bit32s* output, const Bit32s* input, Bit32u samples ) {
+	Bit32u i = 0;
+#if defined(MIXER_SIMD_SSE2)
+	for ( ; i + 4 <= samples; i += 4 ) {
+		__m128i in = _mm_loadu_si128( (const __m128i*)( input + i ) );
+		__m128i out = _mm_loadu_si128( (const __m128i*)( output + i ) );
+		_mm_storeu_si128( (__m128i*)( output + i ), _mm_add_epi32( out, in ) );
+	}
+#elif defined(MIXER_SIMD_NEON)
+	for ( ; i + 4 <= samples; i += 4 ) {
+		vst1q_s32( output + i, vaddq_s32( vld1q_s32( output + i ), vld1q_s32( input + i ) ) );
+	}
+#endif
+	for ( ; i < samples; i++ ) {
+		output[i] += input[i];
+	}
+}
+
+//Add the samples of an operator to the stereo output, masked for the panning
+static INLINE void AddBlockStereo( Bit32s* output, const Bit32s* input, Bit32u samples, Bit32s maskLeft, Bit32s maskRight ) {
+	Bit32u i = 0;
+#if defined(MIXER_SIMD_SSE2)
+	const __m128i left = _mm_set1_epi32( maskLeft );
+	const __m128i right = _mm_set1_epi32( maskRight );
+	for ( ; i + 4 <= samples; i += 4 ) {
+		__m128i in = _mm_loadu_si128( (const __m128i*)( input + i ) );
+		__m128i l = _mm_and_si128( in, left );
+		__m128i r = _mm_and_si128( in, right );
+		__m128i* out = (__m128i*)( output + i * 2 );
+		_mm_storeu_si128( out + 0, _mm_add_epi32( _mm_loadu_si128( out + 0 ), _mm_unpacklo_epi32( l, r ) ) );
+		_mm_storeu_si128( out + 1, _mm_add_epi32( _mm_loadu_si128( out + 1 ), _mm_unpackhi_epi32( l, r ) ) );
+	}
+#elif defined(MIXER_SIMD_NEON)
+	const int32x4_t left = vdupq_n_s32( maskLeft );
+	const int32x4_t right = vdupq_n_s32( maskRight );
+	for ( ; i + 4 <= samples; i += 4 ) {
+		int32x4_t in = vld1q_s32( input + i );
+		int32x4x2_t out = vld2q_s32( output + i * 2 );
+		out.val[0] = vaddq_s32( out.val[0], vandq_s32( in, left ) );
+		out.val[1] = vaddq_s32( out.val[1], vandq_s32( in, right ) );
+		vst2q_s32( output + i * 2, out );
+	}
+#endif
+	for ( ; i < samples; i++ ) {
+		output[ i * 2 + 0 ] += input[i] & maskLeft;
+		output[ i * 2 + 1 ] += input[i] & maskRight;
+	}
+}
+#endif
+
 Operator::Operator() {
 	chanData = 0;
 	freqMul = 0;
@@ -842,49 +982,32 @@ INLINE void Channel::GeneratePercussion( Chip* chip, Bit32s* output ) {
 	}
 }
 
+//True when the operators that can be heard in this mode are silent and will stay that way
 template<SynthMode mode>
-Channel* Channel::BlockTemplate( Chip* chip, Bit32u samples, Bit32s* output ) {
+INLINE bool Channel::Silent() {
 	switch( mode ) {
 	case sm2AM:
 	case sm3AM:
-		if ( Op(0)->Silent() && Op(1)->Silent() ) {
-			old[0] = old[1] = 0;
-			return (this + 1);
-		}
-		break;
+		return Op(0)->Silent() && Op(1)->Silent();
 	case sm2FM:
 	case sm3FM:
-		if ( Op(1)->Silent() ) {
-			old[0] = old[1] = 0;
-			return (this + 1);
-		}
-		break;
+		return Op(1)->Silent();
 	case sm3FMFM:
-		if ( Op(3)->Silent() ) {
-			old[0] = old[1] = 0;
-			return (this + 2);
-		}
-		break;
+		return Op(3)->Silent();
 	case sm3AMFM:
-		if ( Op(0)->Silent() && Op(3)->Silent() ) {
-			old[0] = old[1] = 0;
-			return (this + 2);
-		}
-		break;
+		return Op(0)->Silent() && Op(3)->Silent();
 	case sm3FMAM:
-		if ( Op(1)->Silent() && Op(3)->Silent() ) {
-			old[0] = old[1] = 0;
-			return (this + 2);
-		}
-		break;
+		return Op(1)->Silent() && Op(3)->Silent();
 	case sm3AMAM:
-		if ( Op(0)->Silent() && Op(2)->Silent() && Op(3)->Silent() ) {
-			old[0] = old[1] = 0;
-			return (this + 2);
-		}
-		break;
+		return Op(0)->Silent() && Op(2)->Silent() && Op(3)->Silent();
+	default:
+		return false;
 	}
-	//Init the operators with the the current vibrato and tremolo values
+}
+
+//Init the operators with the the current vibrato and tremolo values
+template<SynthMode mode>
+INLINE void Channel::Prepare( const Chip* chip ) {
 	Op( 0 )->Prepare( chip );
 	Op( 1 )->Prepare( chip );
 	if ( mode > sm4Start ) {
@@ -895,6 +1018,38 @@ Channel* Channel::BlockTemplate( Chip* chip, Bit32u samples, Bit32s* output ) {
 		Op( 4 )->Prepare( chip );
 		Op( 5 )->Prepare( chip );
 	}
+}
+
+template<SynthMode mode>
+Channel* Channel::BlockTemplate( Chip* chip, Bit32u samples, Bit32s* output ) {
+	Channel* next = ( mode > sm4Start ) ? ( this + 2 ) : ( this + 1 );
+	if ( Silent< mode >() ) {
+		old[0] = old[1] = 0;
+		return next;
+	}
+	Prepare< mode >( chip );
+#if !defined(DBOPL_NO_BLOCK)
+	if ( mode != sm2Percussion && mode != sm3Percussion ) {
+		//When the channel the chip does next is in the same mode do it along with this one,
+		//the first operators have to wait for their feedback and can take turns doing that
+		Channel* pair = 0;
+		Channel* last = chip->chan + ( ( mode == sm2AM || mode == sm2FM ) ? 9 : 18 );
+		if ( next < last && next->synthHandler == &Channel::BlockTemplate< mode > && !next->Silent< mode >() ) {
+			pair = next;
+			pair->Prepare< mode >( chip );
+			next = ( mode > sm4Start ) ? ( pair + 2 ) : ( pair + 1 );
+		}
+		const Bitu stereo = ( mode > sm2FM ) ? 2 : 1;
+		for ( Bit32u done = 0; done < samples; ) {
+			Bit32u todo = samples - done;
+			if ( todo > BLOCK_SAMPLES )
+				todo = BLOCK_SAMPLES;
+			GenerateBlock< mode >( pair, todo, output + done * stereo );
+			done += todo;
+		}
+		return next;
+	}
+#endif
 	for ( Bitu i = 0; i < samples; i++ ) {
 		//Early out for percussion handlers
 		if ( mode == sm2Percussion ) {
@@ -968,6 +1123,88 @@ Channel* Channel::BlockTemplate( Chip* chip, Bit32u samples, Bit32s* output ) {
 	return 0;
 }
 
+#if !defined(DBOPL_NO_BLOCK)
+template<SynthMode mode>
+INLINE Bit32s Channel::BlockSample( Bit32u vol[][ BLOCK_SAMPLES ], Bit32u i, Bit32s& old0, Bit32s& old1 ) {
+	//Do unsigned shift so we can shift out all bits but still stay in 10 bit range otherwise
+	Bit32s mod = (Bit32u)((old0 + old1)) >> feedback;
+	old0 = old1;
+	old1 = Op(0)->GetSample( mod, vol[0][i] );
+	Bit32s sample = 0;
+	Bit32s out0 = old0;
+	if ( mode == sm2AM || mode == sm3AM ) {
+		sample = out0 + Op(1)->GetSample( 0, vol[1][i] );
+	} else if ( mode == sm2FM || mode == sm3FM ) {
+		sample = Op(1)->GetSample( out0, vol[1][i] );
+	} else if ( mode == sm3FMFM ) {
+		Bits next = Op(1)->GetSample( out0, vol[1][i] );
+		next = Op(2)->GetSample( next, vol[2][i] );
+		sample = Op(3)->GetSample( next, vol[3][i] );
+	} else if ( mode == sm3AMFM ) {
+		sample = out0;
+		Bits next = Op(1)->GetSample( 0, vol[1][i] );
+		next = Op(2)->GetSample( next, vol[2][i] );
+		sample += Op(3)->GetSample( next, vol[3][i] );
+	} else if ( mode == sm3FMAM ) {
+		sample = Op(1)->GetSample( out0, vol[1][i] );
+		Bits next = Op(2)->GetSample( 0, vol[2][i] );
+		sample += Op(3)->GetSample( next, vol[3][i] );
+	} else if ( mode == sm3AMAM ) {
+		sample = out0;
+		Bits next = Op(1)->GetSample( 0, vol[1][i] );
+		sample += Op(2)->GetSample( next, vol[2][i] );
+		sample += Op(3)->GetSample( 0, vol[3][i] );
+	}
+	return sample;
+}
+
+template<SynthMode mode>
+INLINE void Channel::ForwardVolumeBlock( Bit32u samples, Bit32u vol[][ BLOCK_SAMPLES ] ) {
+	Op(0)->ForwardVolumeBlock( samples, vol[0] );
+	Op(1)->ForwardVolumeBlock( samples, vol[1] );
+	if ( mode > sm4Start ) {
+		Op(2)->ForwardVolumeBlock( samples, vol[2] );
+		Op(3)->ForwardVolumeBlock( samples, vol[3] );
+	}
+}
+
+template<SynthMode mode>
+void Channel::GenerateBlock( Channel* pair, Bit32u samples, Bit32s* output ) {
+	//The envelopes first, so the loop below is left with the waves
+	Bit32u vol[ 2 ][ 4 ][ BLOCK_SAMPLES ];
+	Bit32s buffer[ 2 ][ BLOCK_SAMPLES ];
+	ForwardVolumeBlock< mode >( samples, vol[0] );
+	Bit32s old0 = old[0];
+	Bit32s old1 = old[1];
+	if ( pair ) {
+		pair->ForwardVolumeBlock< mode >( samples, vol[1] );
+		Bit32s pairOld0 = pair->old[0];
+		Bit32s pairOld1 = pair->old[1];
+		for ( Bit32u i = 0; i < samples; i++ ) {
+			buffer[0][i] = BlockSample< mode >( vol[0], i, old0, old1 );
+			buffer[1][i] = pair->BlockSample< mode >( vol[1], i, pairOld0, pairOld1 );
+		}
+		pair->old[0] = pairOld0;
+		pair->old[1] = pairOld1;
+	} else {
+		for ( Bit32u i = 0; i < samples; i++ ) {
+			buffer[0][i] = BlockSample< mode >( vol[0], i, old0, old1 );
+		}
+	}
+	old[0] = old0;
+	old[1] = old1;
+	if ( mode == sm2AM || mode == sm2FM ) {
+		AddBlock( output, buffer[0], samples );
+		if ( pair )
+			AddBlock( output, buffer[1], samples );
+	} else {
+		AddBlockStereo( output, buffer[0], samples, maskLeft, maskRight );
+		if ( pair )
+			AddBlockStereo( output, buffer[1], samples, pair->maskLeft, pair->maskRight );
+	}
+}
+#endif
+
 /*
 	Chip
 */
@@ -984,6 +1221,12 @@ INLINE Bit32u Chip::ForwardNoise() {
 	noiseCounter += noiseAdd;
 	Bitu count = noiseCounter >> LFO_SH;
 	noiseCounter &= WAVE_MASK;
+#if !defined(DBOPL_NO_BLOCK)
+	//The counter keeps the bits above LFO_SH, so this can be hundreds of steps
+	for ( ; count >= 8; count -= 8 ) {
+		noiseValue = ( noiseValue >> 8 ) ^ NoiseTable[ noiseValue & 0xff ];
+	}
+#endif
 	for ( ; count > 0; --count ) {
 		//Noise calculation from mame
 		noiseValue ^= ( 0x800302 ) & ( 0 - (noiseValue & 1 ) );
@@ -1211,6 +1454,14 @@ void Chip::GenerateBlock3( Bitu total, Bit32s* output  ) {
 	}
 }
 
+bool Chip::Silent() const {
+	for ( Bitu i = 0; i < 18; i++ ) {
+		if ( !chan[i].op[0].Silent() || !chan[i].op[1].Silent() )
+			return false;
+	}
+	return true;
+}
+
 void Chip::Setup( Bit32u rate ) {
 	double original = OPLRATE;
 //	double original = rate;
@@ -1341,6 +1592,17 @@ void InitTables( void ) {
 	if ( doneTables )
 		return;
 	doneTables = true;
+#if !defined(DBOPL_NO_BLOCK)
+	//Each step shifts in the taps when the low bit is set, which only depends on the low 8 bits for 8 steps
+	for ( int i = 0; i < 256; i++ ) {
+		Bit32u value = i;
+		for ( int step = 0; step < 8; step++ ) {
+			value ^= ( 0x800302 ) & ( 0 - (value & 1 ) );
+			value >>= 1;
+		}
+		NoiseTable[i] = value;
+	}
+#endif
 #if ( DBOPL_WAVE == WAVE_HANDLER ) || ( DBOPL_WAVE == WAVE_TABLELOG )
 	//Exponential volume table, same as the real adlib
 	for ( int i = 0; i < 256; i++ ) {
@@ -1499,17 +1761,23 @@ void Handler::WriteReg( Bit32u addr, Bit8u val ) {
 
 void Handler::Generate( MixerChannel* chan, Bitu samples ) {
 	Bit32s buffer[ 512 * 2 ];
-	if ( GCC_UNLIKELY(samples > 512) )
-		samples = 512;
-	if ( !chip.opl3Active ) {
-		chip.GenerateBlock2( samples, buffer );
-		chan->AddSamples_m32( samples, buffer );
-	} else {
-		chip.GenerateBlock3( samples, buffer );
-		chan->AddSamples_s32( samples, buffer );
+	while ( samples > 0 ) {
+		Bitu todo = samples > 512 ? 512 : samples;
+		samples -= todo;
+		if ( !chip.opl3Active ) {
+			chip.GenerateBlock2( todo, buffer );
+			chan->AddSamples_m32( todo, buffer );
+		} else {
+			chip.GenerateBlock3( todo, buffer );
+			chan->AddSamples_s32( todo, buffer );
+		}
 	}
 }
 
+bool Handler::Silent() {
+	return chip.Silent();
+}
+
 void Handler::Init( Bitu rate ) {
 	InitTables();
 	chip.Setup( rate );
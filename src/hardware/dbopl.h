@@ -29,6 +29,10 @@
 //Select the type of wave generator routine
 #define DBOPL_WAVE WAVE_TABLEMUL
 
+//Samples the envelopes are done ahead of the waves, define DBOPL_NO_BLOCK to do everything a sample at a time
+//and to step the noise generator one bit at a time
+#define BLOCK_SAMPLES 64
+
 namespace DBOPL {
 
 struct Chip;
@@ -150,7 +154,9 @@ public:
 	Bitu ForwardVolume();
 
 	Bits GetSample( Bits modulation );
+	Bits GetSample( Bits modulation, Bitu vol );
 	Bits GetWave( Bitu index, Bitu vol );
+	void ForwardVolumeBlock( Bit32u samples, Bit32u* output );
 public:
 	Operator();
 };
@@ -188,6 +194,17 @@ struct Channel {
 	//Generate blocks of data in specific modes
 	template<SynthMode mode>
 	Channel* BlockTemplate( Chip* chip, Bit32u samples, Bit32s* output );
+	template<SynthMode mode>
+	bool Silent();
+	template<SynthMode mode>
+	void Prepare( const Chip* chip );
+	//Generate up to BLOCK_SAMPLES with the envelopes done first, along with a pair in the same mode
+	template<SynthMode mode>
+	void ForwardVolumeBlock( Bit32u samples, Bit32u vol[][ BLOCK_SAMPLES ] );
+	template<SynthMode mode>
+	Bit32s BlockSample( Bit32u vol[][ BLOCK_SAMPLES ], Bit32u i, Bit32s& old0, Bit32s& old1 );
+	template<SynthMode mode>
+	void GenerateBlock( Channel* pair, Bit32u samples, Bit32s* output );
 	Channel();
 };
 
@@ -238,6 +255,8 @@ struct Chip {
 
 	void GenerateBlock2( Bitu samples, Bit32s* output );
 	void GenerateBlock3( Bitu samples, Bit32s* output );
+	//All envelopes done, the output stays silent until the next write
+	bool Silent() const;
 
 	//Update the synth handlers in all channels
 	void UpdateSynths();
@@ -253,6 +272,7 @@ struct Handler : public Adlib::Handler {
 	virtual void WriteReg( Bit32u addr, Bit8u val );
 	virtual void Generate( MixerChannel* chan, Bitu samples );
 	virtual void Init( Bitu rate );
+	virtual bool Silent();
 };
 
 
@@ -0,0 +1,242 @@
+/*
+ *  Copyright (C) 2002-2020  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* DBOPL benchmark, built with "make dbopl_bench" in src/hardware.
+   Usage: dbopl_bench [seconds] [capture.dro ...]
+   Plays a few seconds of random notes in every synth mode, and then the raw
+   opl captures made with the capture key, through the block generation of
+   dbopl.cpp and through the sample at a time generation it replaced, which
+   dbopl_ref.cpp builds. Reports the best time of each for one second of
+   output and stops at the first sample where the two differ. */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "dosbox.h"
+#include "dbopl.h"
+#define DBOPL DBOPLRef
+#include "dbopl.h"
+#undef DBOPL
+
+/* Only reached through Handler::Generate, which the bench doesn't use */
+void MixerChannel::AddSamples_m32(Bitu /*len*/,const Bit32s * /*data*/) {}
+void MixerChannel::AddSamples_s32(Bitu /*len*/,const Bit32s * /*data*/) {}
+
+#define RATE 49716
+
+static Bit64u Now(void) {
+	return (Bit64u)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Register writes, each after delay milliseconds of output */
+struct Event {
+	Bit32u delay;
+	Bit32u reg;
+	Bit8u val;
+};
+typedef std::vector<Event> Song;
+
+static void Write(Song & song,Bit32u & delay,Bit32u reg,Bit8u val) {
+	Event e = { delay, reg, val };
+	song.push_back(e);
+	delay = 0;
+}
+
+static Bit32u seed;
+static Bit8u Random(void) {
+	seed = seed * 1103515245 + 12345;
+	return (Bit8u)(seed >> 16);
+}
+
+/* Register offsets of the first operator of the 9 channels of a bank */
+static const Bit8u opSlot[9] = { 0, 1, 2, 8, 9, 10, 16, 17, 18 };
+
+enum { OPL2 = 0, OPL3 = 1, FOUROP = 2, PERCUSSION = 4 };
+
+static const struct {
+	const char * name;
+	Bitu chip;
+	/* Connection bits of the first and second channel of a 4 op pair */
+	Bit8u con0, con1;
+} modes[] = {
+	{ "2AM",   OPL2, 1, 0 },
+	{ "2FM",   OPL2, 0, 0 },
+	{ "2Perc", OPL2 | PERCUSSION, 0, 0 },
+	{ "3AM",   OPL3, 1, 0 },
+	{ "3FM",   OPL3, 0, 0 },
+	{ "3FMFM", OPL3 | FOUROP, 0, 0 },
+	{ "3AMFM", OPL3 | FOUROP, 1, 0 },
+	{ "3FMAM", OPL3 | FOUROP, 0, 1 },
+	{ "3AMAM", OPL3 | FOUROP, 1, 1 },
+	{ "3Perc", OPL3 | PERCUSSION, 0, 0 },
+};
+
+/* Random instruments on every channel in the synth mode, with a new note
+   every 100 milliseconds on each of them */
+static void MakeSong(Song & song,Bitu mode,Bitu seconds) {
+	Bitu chip = modes[mode].chip;
+	Bitu banks = (chip & OPL3) ? 2 : 1;
+	Bit32u delay = 0;
+	seed = (Bit32u)mode + 1;
+	if (chip & OPL3) Write(song,delay,0x105,1);
+	if (chip & FOUROP) Write(song,delay,0x104,0x3f);
+	Write(song,delay,0x01,0x20);
+	for (Bitu note = 0;note < seconds * 10;note++) {
+		for (Bitu bank = 0;bank < banks;bank++) {
+			for (Bitu c = 0;c < 9;c++) {
+				Bit32u base = (Bit32u)(bank << 8);
+				Write(song,delay,base + 0xb0 + c,0);
+				for (Bitu op = 0;op < 2;op++) {
+					Bit32u slot = base + opSlot[c] + op * 3;
+					Write(song,delay,slot + 0x20,Random());
+					/* Keep most of the operators loud enough to hear */
+					Write(song,delay,slot + 0x40,Random() & 0x9f);
+					Write(song,delay,slot + 0x60,Random());
+					Write(song,delay,slot + 0x80,Random());
+					Write(song,delay,slot + 0xe0,Random());
+				}
+				Bit8u con = (c < 3) ? modes[mode].con0 : modes[mode].con1;
+				if (!(chip & FOUROP)) con = modes[mode].con0;
+				else if (c >= 6) con = Random() & 1;
+				Write(song,delay,base + 0xc0 + c,(Random() & 0x0e) | con | 0x30);
+				Write(song,delay,base + 0xa0 + c,Random());
+				Write(song,delay,base + 0xb0 + c,0x20 | (Random() & 0x1f));
+			}
+		}
+		Bit8u bd = Random() & 0xc0;
+		if (chip & PERCUSSION) bd |= 0x20 | (Random() & 0x1f);
+		Write(song,delay,0xbd,bd);
+		delay = 100;
+	}
+	delay = 100;
+	Write(song,delay,0xbd,0);
+}
+
+/* Raw opl capture, the format the Capture class of adlib.cpp writes */
+static bool LoadSong(Song & song,const char * name) {
+	FILE * file = fopen(name,"rb");
+	if (!file) return false;
+	std::vector<Bit8u> data;
+	Bit8u buf[4096];
+	size_t read;
+	while ((read = fread(buf,1,sizeof(buf),file)) > 0) data.insert(data.end(),buf,buf + read);
+	fclose(file);
+	if (data.size() < 0x1a || memcmp(&data[0],"DBRAWOPL",8) || data[8] != 2) return false;
+	Bit8u delay256 = data[0x17];
+	Bit8u delayShift8 = data[0x18];
+	Bitu tableSize = data[0x19];
+	const Bit8u * table = &data[0x1a];
+	Bit32u delay = 0;
+	for (Bitu pos = 0x1a + tableSize;pos + 1 < data.size();pos += 2) {
+		Bit8u raw = data[pos];
+		Bit8u val = data[pos + 1];
+		if (raw == delay256) delay += val + 1;
+		else if (raw == delayShift8) delay += (val + 1) << 8;
+		else if ((raw & 0x7f) < tableSize) Write(song,delay,table[raw & 0x7f] | ((raw & 0x80) << 1),val);
+	}
+	delay += 100;
+	Write(song,delay,0xbd,0);
+	return true;
+}
+
+/* Plays the song like the adlib module does a millisecond at a time, returns
+   the time spent generating */
+template <class H> static Bit64u Play(const Song & song,std::vector<Bit32s> & out) {
+	H * handler = new H;
+	handler->Init(RATE);
+	out.clear();
+	Bit64u time = 0;
+	Bitu ms = 0;
+	Bit32s buffer[512 * 2];
+	for (Bitu e = 0;e < song.size();e++) {
+		for (Bitu d = 0;d < song[e].delay;d++,ms++) {
+			Bitu samples = ((ms + 1) * RATE) / 1000 - (ms * RATE) / 1000;
+			Bitu stereo = handler->chip.opl3Active ? 2 : 1;
+			Bit64u start = Now();
+			if (stereo == 2) handler->chip.GenerateBlock3(samples,buffer);
+			else handler->chip.GenerateBlock2(samples,buffer);
+			time += Now() - start;
+			out.insert(out.end(),buffer,buffer + samples * stereo);
+		}
+		handler->WriteReg(song[e].reg,song[e].val);
+	}
+	delete handler;
+	return time;
+}
+
+static double Seconds(const Song & song) {
+	Bitu ms = 0;
+	for (Bitu e = 0;e < song.size();e++) ms += song[e].delay;
+	return ms / 1000.0;
+}
+
+static bool Run(const char * name,const Song & song,Bitu rounds) {
+	std::vector<Bit32s> out[2];
+	Bit64u best[2] = { ~(Bit64u)0, ~(Bit64u)0 };
+	for (Bitu r = 0;r < rounds;r++) {
+		Bit64u time = Play<DBOPLRef::Handler>(song,out[0]);
+		if (time < best[0]) best[0] = time;
+		time = Play<DBOPL::Handler>(song,out[1]);
+		if (time < best[1]) best[1] = time;
+	}
+	double length = Seconds(song);
+	printf("%-16s %12.0f %12.0f %7.2f\n",name,best[0] / length,best[1] / length,(double)best[0] / best[1]);
+	fflush(stdout);
+	for (Bitu i = 0;i < out[0].size() && i < out[1].size();i++) {
+		if (out[0][i] != out[1][i]) {
+			printf("Output differs at value %d: %d instead of %d\n",(int)i,(int)out[1][i],(int)out[0][i]);
+			return false;
+		}
+	}
+	if (out[0].size() != out[1].size()) {
+		printf("Output differs in length\n");
+		return false;
+	}
+	return true;
+}
+
+int main(int argc,char * argv[]) {
+	Bitu seconds = argc > 1 ? (Bitu)atoi(argv[1]) : 5;
+	if (!seconds) {
+		printf("Usage: dbopl_bench [seconds] [capture.dro ...]\n");
+		return 1;
+	}
+	bool same = true;
+	printf("%-16s %12s %12s %7s\n","mode","sample ns/s","block ns/s","speedup");
+	for (Bitu m = 0;m < sizeof(modes) / sizeof(modes[0]);m++) {
+		Song song;
+		MakeSong(song,m,seconds);
+		same &= Run(modes[m].name,song,3);
+	}
+	for (int i = 2;i < argc;i++) {
+		Song song;
+		if (!LoadSong(song,argv[i])) {
+			printf("Can't load the raw opl capture %s\n",argv[i]);
+			same = false;
+			continue;
+		}
+		const char * name = strrchr(argv[i],'/');
+		same &= Run(name ? name + 1 : argv[i],song,3);
+	}
+	return same ? 0 : 1;
+}
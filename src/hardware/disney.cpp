@@ -179,6 +179,7 @@ static void DISNEY_analyze(Bitu channel){
 static void disney_write(Bitu port,Bitu val,Bitu iolen) {
 	//LOG_MSG("write disney time %f addr%x val %x",PIC_FullIndex(),port,val);
 	disney.last_used=PIC_Ticks;
+	disney.chan->WakeUp();
 	switch (port-DISNEY_BASE) {
 	case 0:		/* Data Port */
 	{
@@ -376,6 +377,7 @@ public:
 
 		disney.mo = new MixerObject();
 		disney.chan=disney.mo->Install(&DISNEY_CallBack,10000,"DISNEY");
+		disney.chan->SetAutoSleep(true);
 		DISNEY_disable(0);
 
 
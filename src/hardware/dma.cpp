@@ -41,45 +41,56 @@ static void UpdateEMSMapping(void) {
 	}
 }
 
-/* read a block from physical memory */
+/* physical page of a page the dma controller addresses */
+static INLINE Bitu DMA_MapPage(Bitu page) {
+	/* care for EMS pageframe etc. */
+	if (page < EMM_PAGEFRAME4K) return paging.firstmb[page];
+	else if (page < EMM_PAGEFRAME4K+0x10) return ems_board_mapping[page];
+	else if (page < LINK_START) return paging.firstmb[page];
+	return page;
+}
+
+/* read a block from physical memory, a page at a time */
 static void DMA_BlockRead(PhysPt spage,PhysPt offset,void * data,Bitu size,Bit8u dma16) {
 	Bit8u * write=(Bit8u *) data;
 	Bitu highpart_addr_page = spage>>12;
 	size <<= dma16;
 	offset <<= dma16;
 	Bit32u dma_wrap = ((0xffff<<dma16)+dma16) | dma_wrapping;
-	for ( ; size ; size--, offset++) {
+	while (size) {
 		if (offset>(dma_wrapping<<dma16)) {
 			LOG_MSG("DMA segbound wrapping (read): %x:%x size %" sBitfs(x) " [%x] wrap %x",spage,offset,size,dma16,dma_wrapping);
 		}
 		offset &= dma_wrap;
-		Bitu page = highpart_addr_page+(offset >> 12);
-		/* care for EMS pageframe etc. */
-		if (page < EMM_PAGEFRAME4K) page = paging.firstmb[page];
-		else if (page < EMM_PAGEFRAME4K+0x10) page = ems_board_mapping[page];
-		else if (page < LINK_START) page = paging.firstmb[page];
-		*write++=phys_readb(page*4096 + (offset & 4095));
+		Bitu todo = 4096 - (offset & 4095);
+		if (todo > size) todo = size;
+		Bitu page = DMA_MapPage(highpart_addr_page+(offset >> 12));
+		memcpy(write,MemBase+page*4096+(offset & 4095),todo);
+		write+=todo;
+		offset+=todo;
+		size-=todo;
 	}
 }
 
-/* write a block into physical memory */
+/* write a block into physical memory, a page at a time */
 static void DMA_BlockWrite(PhysPt spage,PhysPt offset,void * data,Bitu size,Bit8u dma16) {
 	Bit8u * read=(Bit8u *) data;
 	Bitu highpart_addr_page = spage>>12;
 	size <<= dma16;
 	offset <<= dma16;
 	Bit32u dma_wrap = ((0xffff<<dma16)+dma16) | dma_wrapping;
-	for ( ; size ; size--, offset++) {
+	while (size) {
 		if (offset>(dma_wrapping<<dma16)) {
 			LOG_MSG("DMA segbound wrapping (write): %x:%x size %" sBitfs(x) " [%x] wrap %x",spage,offset,size,dma16,dma_wrapping);
 		}
 		offset &= dma_wrap;
-		Bitu page = highpart_addr_page+(offset >> 12);
-		/* care for EMS pageframe etc. */
-		if (page < EMM_PAGEFRAME4K) page = paging.firstmb[page];
-		else if (page < EMM_PAGEFRAME4K+0x10) page = ems_board_mapping[page];
-		else if (page < LINK_START) page = paging.firstmb[page];
-		phys_writeb(page*4096 + (offset & 4095), *read++);
+		Bitu todo = 4096 - (offset & 4095);
+		if (todo > size) todo = size;
+		Bitu page = DMA_MapPage(highpart_addr_page+(offset >> 12));
+		memcpy(MemBase+page*4096+(offset & 4095),read,todo);
+		read+=todo;
+		offset+=todo;
+		size-=todo;
 	}
 }
 
@@ -288,13 +299,15 @@ Bitu DmaChannel::Read(Bitu want, Bit8u * buffer) {
 again:
 	Bitu left=(currcnt+1);
 	if (want<left) {
-		DMA_BlockRead(pagebase,curraddr,buffer,want,DMA16);
+		if (buffer) DMA_BlockRead(pagebase,curraddr,buffer,want,DMA16);
 		done+=want;
 		curraddr+=want;
 		currcnt-=want;
 	} else {
-		DMA_BlockRead(pagebase,curraddr,buffer,want,DMA16);
-		buffer+=left << DMA16;
+		if (buffer) {
+			DMA_BlockRead(pagebase,curraddr,buffer,want,DMA16);
+			buffer+=left << DMA16;
+		}
 		want-=left;
 		done+=left;
 		ReachedTC();
@@ -314,6 +327,26 @@ again:
 	return done;
 }
 
+Bitu DmaChannel::Map(Bitu want, Bit8u * & data) {
+	Bitu left=(currcnt+1);
+	if (want>left) want=left;
+	Bitu highpart_addr_page = pagebase>>12;
+	Bit32u dma_wrap = ((0xffff<<DMA16)+DMA16) | dma_wrapping;
+	Bitu offset = ((curraddr & dma_wrapping) << DMA16) & dma_wrap;
+	Bitu page = DMA_MapPage(highpart_addr_page+(offset >> 12));
+	if (page >= MEM_TotalPages()) return 0;
+	/* Take the next pages along while they follow in memory too */
+	Bitu bytes = 4096 - (offset & 4095);
+	while ((bytes >> DMA16) < want && offset+bytes-1 < dma_wrap) {
+		Bitu next = DMA_MapPage(highpart_addr_page+((offset+bytes) >> 12));
+		if (next != page+((offset+bytes) >> 12)-(offset >> 12) || next >= MEM_TotalPages()) break;
+		bytes += 4096;
+	}
+	data = MemBase+page*4096+(offset & 4095);
+	bytes >>= DMA16;
+	return bytes < want ? bytes : want;
+}
+
 Bitu DmaChannel::Write(Bitu want, Bit8u * buffer) {
 	Bitu done=0;
 	curraddr &= dma_wrapping;
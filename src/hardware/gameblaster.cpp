@@ -41,6 +41,7 @@ static saa1099_device* device[2];
 
 static void write_cms(Bitu port, Bitu val, Bitu /* iolen */) {
 	if(cms_chan && (!cms_chan->enabled)) cms_chan->Enable(true);
+	if(cms_chan) cms_chan->WakeUp();
 	lastWriteTicks = PIC_Ticks;
 	switch ( port - cmsBase ) {
 	case 1:
@@ -142,6 +143,7 @@ public:
 
 		/* Register the Mixer CallBack */
 		cms_chan = MixerChan.Install(CMS_CallBack,sampleRate,"CMS");
+		cms_chan->SetAutoSleep(true);
 	
 		lastWriteTicks = PIC_Ticks;
 
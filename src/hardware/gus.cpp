@@ -23,6 +23,7 @@
 #include "dosbox.h"
 #include "inout.h"
 #include "mixer.h"
+#include "mixer_simd.h"
 #include "dma.h"
 #include "pic.h"
 #include "setup.h"
@@ -47,6 +48,9 @@ using namespace std;
 
 #define VOL_SHIFT 14
 
+//Samples a voice renders at a time between wave and ramp boundaries
+#define GUS_BLOCK 64
+
 #define WCTRL_STOPPED			0x01
 #define WCTRL_STOP				0x02
 #define WCTRL_16BIT				0x04
@@ -161,8 +165,8 @@ public:
 
 	// Returns a single 16-bit sample from the Gravis's RAM
 
-	INLINE Bit32s GetSample8() const {
-		Bit32u useAddr = WaveAddr >> WAVE_FRACT;
+	INLINE Bit32s GetSample8(Bit32u addr) const {
+		Bit32u useAddr = addr >> WAVE_FRACT;
 		if (WaveAdd >= (1 << WAVE_FRACT)) {
 			Bit32s tmpsmall = (Bit8s)GUSRam[useAddr];
 			return tmpsmall << 8;
@@ -173,13 +177,13 @@ public:
 			Bit32s w1 = ((Bit8s)GUSRam[useAddr]) << 8;
 			Bit32s w2 = ((Bit8s)GUSRam[nextAddr]) << 8;
 			Bit32s diff = w2 - w1;
-			Bit32s scale = (Bit32s)(WaveAddr&WAVE_FRACT_MASK);
+			Bit32s scale = (Bit32s)(addr&WAVE_FRACT_MASK);
 			return (w1 + ((diff*scale) >> WAVE_FRACT));
 		}
 	}
 
-	INLINE Bit32s GetSample16() const {
-		Bit32u useAddr = WaveAddr >> WAVE_FRACT;
+	INLINE Bit32s GetSample16(Bit32u addr) const {
+		Bit32u useAddr = addr >> WAVE_FRACT;
 		// Formula used to convert addresses for use with 16-bit samples
 		Bit32u holdAddr = useAddr & 0xc0000L;
 		useAddr = useAddr & 0x1ffffL;
@@ -193,7 +197,7 @@ public:
 			Bit32s w1 = (GUSRam[useAddr + 0] | (((Bit8s)GUSRam[useAddr + 1]) << 8));
 			Bit32s w2 = (GUSRam[useAddr + 2] | (((Bit8s)GUSRam[useAddr + 3]) << 8));
 			Bit32s diff = w2 - w1;
-			Bit32s scale = (Bit32s)(WaveAddr&WAVE_FRACT_MASK);
+			Bit32s scale = (Bit32s)(addr&WAVE_FRACT_MASK);
 			return (w1 + ((diff*scale) >> WAVE_FRACT));
 		}
 	}
@@ -320,32 +324,93 @@ public:
 		UpdateVolumes();
 	}
 
-	void generateSamples(Bit32s * stream,Bit32u len) {
-		//Disabled channel
-		if (RampCtrl & WaveCtrl & 3) return;
-
-		if (WaveCtrl & WCTRL_16BIT) {
-			for (int i = 0; i < (int)len; i++) {
-				// Get sample
-				Bit32s tmpsamp = GetSample16();
-				// Output stereo sample
-				stream[i << 1] += tmpsamp * VolLeft;
-				stream[(i << 1) + 1] += tmpsamp * VolRight;
-				WaveUpdate();
-				RampUpdate();
+	//Updates that can be done before the wave reaches its start or end
+	INLINE Bit32u WaveSteps(void) const {
+		if (WaveCtrl & ( WCTRL_STOP | WCTRL_STOPPED)) return 0xffffffff;
+		Bit32s WaveLeft = (WaveCtrl & WCTRL_DECREASING) ? (Bit32s)(WaveAddr-WaveStart) : (Bit32s)(WaveEnd-WaveAddr);
+		if (WaveLeft <= 0) return 0;
+		if (!WaveAdd) return 0xffffffff;
+		return (Bit32u)(WaveLeft - 1) / WaveAdd;
+	}
+	//Updates that can be done before the ramp reaches its start or end
+	INLINE Bit32u RampSteps(void) const {
+		if (RampCtrl & 0x3) return 0xffffffff;
+		Bit32s RampLeft = (RampCtrl & 0x40) ? (Bit32s)(RampVol-RampStart) : (Bit32s)(RampEnd-RampVol);
+		if (RampLeft <= 0) return 0;
+		if (!RampAdd) return 0xffffffff;
+		return (Bit32u)(RampLeft - 1) / RampAdd;
+	}
+
+	//Samples in which neither the wave nor the ramp reach a boundary
+	void generateBlock(Bit32s * stream,Bitu len) {
+		Bit16s samples[GUS_BLOCK];
+		Bit16s left[GUS_BLOCK];
+		Bit16s right[GUS_BLOCK];
+		if (RampCtrl & 0x3) {
+			for (Bitu i = 0; i < len; i++) left[i] = (Bit16s)VolLeft;
+			for (Bitu i = 0; i < len; i++) right[i] = (Bit16s)VolRight;
+		} else {
+			Bit32u add = (RampCtrl & 0x40) ? 0 - RampAdd : RampAdd;
+			for (Bitu i = 0; i < len; i++) {
+				left[i] = (Bit16s)VolLeft;
+				right[i] = (Bit16s)VolRight;
+				RampVol += add;
+				UpdateVolumes();
 			}
 		}
-		else {
-			for (int i = 0; i < (int)len; i++) {
-				// Get sample
-				Bit32s tmpsamp = GetSample8();
-				// Output stereo sample
-				stream[i << 1] += tmpsamp * VolLeft;
-				stream[(i << 1) + 1] += tmpsamp * VolRight;
+		Bit32u addr = WaveAddr;
+		Bit32u add = 0;
+		if (!(WaveCtrl & ( WCTRL_STOP | WCTRL_STOPPED)))
+			add = (WaveCtrl & WCTRL_DECREASING) ? 0 - WaveAdd : WaveAdd;
+		if (WaveCtrl & WCTRL_16BIT) {
+			for (Bitu i = 0; i < len; i++, addr += add)
+				samples[i] = (Bit16s)GetSample16(addr);
+		} else {
+			for (Bitu i = 0; i < len; i++, addr += add)
+				samples[i] = (Bit16s)GetSample8(addr);
+		}
+		WaveAddr = addr;
+		Mixer_AddPanned(stream, samples, left, right, len);
+	}
+
+	//Returns false when the voice added nothing
+	bool generateSamples(Bit32s * stream,Bit32u len) {
+		//Disabled channel
+		if (RampCtrl & WaveCtrl & 3) return false;
+
+		bool added = false;
+		while (len) {
+			Bit32u todo = WaveSteps();
+			Bit32u ramp = RampSteps();
+			if (todo > ramp) todo = ramp;
+			if (todo > len) todo = len;
+			if (!todo) {
+				//Sample that hits a boundary
+				Bit32s tmpsamp = (WaveCtrl & WCTRL_16BIT) ? GetSample16(WaveAddr) : GetSample8(WaveAddr);
+				stream[0] += tmpsamp * VolLeft;
+				stream[1] += tmpsamp * VolRight;
 				WaveUpdate();
 				RampUpdate();
+				stream += 2;
+				len--;
+				added = true;
+			} else if ((RampCtrl & 0x3) && !VolLeft && !VolRight) {
+				//Silent voice, only the wave position moves on
+				if (!(WaveCtrl & ( WCTRL_STOP | WCTRL_STOPPED))) {
+					if (WaveCtrl & WCTRL_DECREASING) WaveAddr -= todo * WaveAdd;
+					else WaveAddr += todo * WaveAdd;
+				}
+				stream += todo * 2;
+				len -= todo;
+			} else {
+				if (todo > GUS_BLOCK) todo = GUS_BLOCK;
+				generateBlock(stream, todo);
+				stream += todo * 2;
+				len -= todo;
+				added = true;
 			}
 		}
+		return added;
 	}
 };
 
@@ -782,12 +847,15 @@ static void GUS_CallBack(Bitu len) {
 	Bit32s buffer[MIXER_BUFSIZE][2];
 	memset(buffer, 0, len * sizeof(buffer[0]));
 
+	bool added = false;
 	for (Bitu i = 0; i < myGUS.ActiveChannels; i++) {
-		guschan[i]->generateSamples(buffer[0], len);
+		added |= guschan[i]->generateSamples(buffer[0], len);
 	}
-	for (Bitu i = 0; i < len; i++) {
-		buffer[i][0] >>= VOL_SHIFT;
-		buffer[i][1] >>= VOL_SHIFT;
+	if (added) {
+		for (Bitu i = 0; i < len; i++) {
+			buffer[i][0] >>= VOL_SHIFT;
+			buffer[i][1] >>= VOL_SHIFT;
+		}
 	}
 	gus_chan->AddSamples_s32(len, buffer[0]);
 	CheckVoiceIrq();
@@ -435,6 +435,10 @@ static struct {
 	struct {
 		Bitu rowlen;
 	} image;
+	struct {
+		FILE * handle;
+		Bitu count;
+	} frames;
 #if (C_SRECORD)
 	struct {
 		AVIFILE		*avi_out;
@@ -833,6 +837,55 @@ static void CAPTURE_ScreenShotEvent(bool pressed) {
 #endif
 
 
+/* Raw frame capturing, the frames are replayed by render_bench in src/gui.
+   The file starts with "DBFRAME1", then for every frame follow the little
+   endian Bit32u width, height, bpp and capture flags, for 8 bpp the 256 rgb
+   triplets of the palette and the lines of width pixels in host byte order,
+   as they were passed to the scalers. */
+void CAPTURE_AddFrame(Bitu width, Bitu height, Bitu bpp, Bitu pitch, Bitu flags, const Bit8u * data, const Bit8u * pal) {
+	if (!capture.frames.handle) {
+		capture.frames.handle=OpenCaptureFile("Raw Frames",".frm");
+		if (!capture.frames.handle) {
+			CaptureState &= ~CAPTURE_FRAMES;
+			return;
+		}
+		fwrite("DBFRAME1",1,8,capture.frames.handle);
+		capture.frames.count=0;
+	}
+	Bit8u header[16];
+	host_writed(&header[0x0],(Bit32u)width);
+	host_writed(&header[0x4],(Bit32u)height);
+	host_writed(&header[0x8],(Bit32u)bpp);
+	host_writed(&header[0xc],(Bit32u)(flags & (CAPTURE_FLAG_DBLW|CAPTURE_FLAG_DBLH)));
+	fwrite(header,1,sizeof(header),capture.frames.handle);
+	if (bpp==8) {
+		Bit8u rgb[256*3];
+		for (Bitu i=0;i<256;i++) {
+			rgb[i*3+0]=pal[i*4+0];
+			rgb[i*3+1]=pal[i*4+1];
+			rgb[i*3+2]=pal[i*4+2];
+		}
+		fwrite(rgb,1,sizeof(rgb),capture.frames.handle);
+	}
+	Bitu rowlen=width*((bpp+7)/8);
+	for (Bitu i=0;i<height;i++) 
+		fwrite(data+i*pitch,1,rowlen,capture.frames.handle);
+	capture.frames.count++;
+}
+
+static void CAPTURE_FramesEvent(bool pressed) {
+	if (!pressed)
+		return;
+	if (capture.frames.handle) {
+		LOG_MSG("Stopped capturing raw frames, %d frames written.",(int)capture.frames.count);
+		fclose(capture.frames.handle);
+		capture.frames.handle=0;
+		CaptureState &= ~CAPTURE_FRAMES;
+		return;
+	}
+	CaptureState ^= CAPTURE_FRAMES;
+}
+
 /* WAV capturing */
 static Bit8u wavheader[]={
 	'R','I','F','F',	0x0,0x0,0x0,0x0,		/* Bit32u Riff Chunk ID /  Bit32u riff size */
@@ -1031,6 +1084,7 @@ public:
 		CaptureState = 0;
 		MAPPER_AddHandler(CAPTURE_WaveEvent,MK_f6,MMOD1,"recwave","Rec Wave");
 		MAPPER_AddHandler(CAPTURE_MidiEvent,MK_f8,MMOD1|MMOD2,"caprawmidi","Cap MIDI");
+		MAPPER_AddHandler(CAPTURE_FramesEvent,MK_f6,MMOD1|MMOD2,"recframes","Rec Frames");
 #if (C_SSHOT)
 		MAPPER_AddHandler(CAPTURE_ScreenShotEvent,MK_f5,MMOD1,"scrshot","Screenshot");
 #endif
@@ -1044,6 +1098,7 @@ public:
 #endif
 		if (capture.wave.handle) CAPTURE_WaveEvent(true);
 		if (capture.midi.handle) CAPTURE_MidiEvent(true);
+		if (capture.frames.handle) CAPTURE_FramesEvent(true);
 	}
 };
 
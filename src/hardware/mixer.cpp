@@ -25,6 +25,7 @@
 #include <string.h>
 #include <sys/types.h>
 #include <math.h>
+#include <atomic>
 
 #if defined (WIN32)
 //Midi listing
@@ -48,6 +49,8 @@
 #include "hardware.h"
 #include "programs.h"
 #include "midi.h"
+#include "perf.h"
+#include "mixer_sinc.h"
 
 #define MIXER_SSIZE 4
 
@@ -65,19 +68,11 @@
 #define TICK_MASK (TICK_NEXT -1)
 
 
-static INLINE Bit16s MIXER_CLIP(Bits SAMP) {
-	if (SAMP < MAX_AUDIO) {
-		if (SAMP > MIN_AUDIO)
-			return SAMP;
-		else return MIN_AUDIO;
-	} else return MAX_AUDIO;
-}
-
 static struct {
 	Bit32s work[MIXER_BUFSIZE][2];
 	//Write/Read pointers for the buffer
 	Bitu pos,done;
-	Bitu needed, min_needed, max_needed;
+	Bitu needed, min_needed;
 	//For every millisecond tick how many samples need to be generated
 	Bit32u tick_add;
 	Bit32u tick_counter;
@@ -86,8 +81,37 @@ static struct {
 	bool nosound;
 	Bit32u freq;
 	Bit32u blocksize;
+	Bitu sinc_taps;				// 0 for the linear interpolation
+	Bitu sleep_after;			// samples of silence before a channel sleeps, 0 never
+	struct {
+		bool enabled;
+		Bitu ticks;				// ticks into the current window
+		Bitu stable;			// windows without the buffer running low
+		Bitu hold;				// stable windows needed before shrinking
+		Bitu lowest, highest;	// limits of min_needed
+	} adapt;
 } mixer;
 
+/* The finished output goes from the emulation thread to the audio callback
+   through this ring. Each side only moves its own index, so neither ever
+   waits for the other. The callback can't change the mixer state, it leaves
+   what it saw in feedback and the next tick adjusts the tick rate. */
+static struct {
+	Bit16s data[MIXER_BUFSIZE][2];
+	std::atomic<Bitu> write;		// frames written by the mixer
+	std::atomic<Bitu> read;			// frames played by the callback
+	std::atomic<Bit32u> feedback;
+	std::atomic<Bitu> min_needed;	// prebuffer the callback aims for
+	std::atomic<Bitu> lowest;		// least left over by a callback, for the adaptive prebuffer
+	std::atomic<Bit32u> underruns;
+} ring;
+
+#define MIXER_FEEDBACK_UNDERRUN		0x10000000
+#define MIXER_FEEDBACK_LOW			0x20000000	// value is how much is missing
+#define MIXER_FEEDBACK_REGULAR		0x30000000	// value is how much is left
+#define MIXER_FEEDBACK_OVERFLOW		0x40000000
+#define MIXER_FEEDBACK_VALUE		0x0fffffff
+
 Bit8u MixTemp[MIXER_BUFSIZE];
 
 // DWD BEGIN
@@ -118,6 +142,10 @@ MixerChannel * MIXER_AddChannel(MIXER_Handler handler,Bitu freq,const char * nam
 	chan->SetVolume(1,1);
 	chan->enabled=false;
 	chan->interpolate = false;
+	chan->sinc = 0;
+	chan->quiet = 0;
+	chan->autosleep = false;
+	chan->sleeping = false;
 	chan->SetFreq(freq); //Sets interpolate as well.
 	chan->last_samples_were_silence = true;
 	chan->last_samples_were_stereo = false;
@@ -142,6 +170,7 @@ void MIXER_DelChannel(MixerChannel* delchan) {
 	while (chan) {
 		if (chan==delchan) {
 			*where=chan->next;
+			delete delchan->sinc;
 			delete delchan;
 			return;
 		}
@@ -171,16 +200,41 @@ void MixerChannel::Enable(bool _yesno) {
 	enabled=_yesno;
 	if (enabled) {
 		freq_counter = 0;
-		SDL_LockAudio();
 		if (done<mixer.done) done=mixer.done;
-		SDL_UnlockAudio();
 	}
 }
 
+void MixerChannel::SetAutoSleep(bool _yesno) {
+	autosleep = _yesno && mixer.sleep_after;
+	if (!autosleep) WakeUp();
+}
+
+void MixerChannel::Wake(void) {
+	sleeping = false;
+	if (done < mixer.done) done = mixer.done;
+}
+
+/* A channel that can sleep stops being mixed once it gave nothing but zeros
+   for a while. Its device wakes it up again when it's used. */
+void MixerChannel::UpdateSleep(Bitu frames,bool silent) {
+	if (!silent) {
+		quiet = 0;
+		return;
+	}
+	quiet += frames;
+	if (autosleep && quiet >= mixer.sleep_after) sleeping = true;
+}
+
 void MixerChannel::SetFreq(Bitu freq) {
 	freq_add=(freq<<FREQ_SHIFT)/mixer.freq;
 
 	if (freq != mixer.freq) {
+		if (mixer.sinc_taps) {
+			if (!sinc) sinc = new MixerSinc();
+			//Don't play what was left from the last time it resampled
+			if (!interpolate) sinc->Clear();
+			sinc->Setup(mixer.sinc_taps,freq,mixer.freq);
+		}
 		interpolate = true;
 	} else {
 		interpolate = false;
@@ -189,7 +243,11 @@ void MixerChannel::SetFreq(Bitu freq) {
 
 void MixerChannel::Mix(Bitu _needed) {
 	needed=_needed;
-	while (enabled && needed>done) {
+	if (sleeping) {
+		if (done < needed) done = needed;
+		return;
+	}
+	while (enabled && !sleeping && needed>done) {
 		Bitu left = (needed - done);
 		left *= freq_add;
 		left  = (left >> FREQ_SHIFT) + ((left & FREQ_MASK)!=0);
@@ -197,9 +255,48 @@ void MixerChannel::Mix(Bitu _needed) {
 	}
 }
 
+static INLINE Bits MIXER_Decay(Bits sample) {
+	// Maybe depend on sample rate. (the 4)
+	if (sample > 4) return sample - 4;
+	else if (sample < -4) return sample + 4;
+	else return 0;
+}
+
 void MixerChannel::AddSilence(void) {
+	MixerSinc * resample = interpolate ? sinc : 0;
+	if (done < needed && resample && !resample->Silent()) {
+		/* Let the filter run out, it still holds the last input samples.
+		   It gets the last sample going down to zero like below. */
+		bool stereo = last_samples_were_stereo;
+		Bitu mixpos = mixer.pos + done;
+		while (done < needed && !resample->Silent()) {
+			while (freq_counter >= FREQ_NEXT) {
+				if (!resample->Left()) {
+					nextSample[0] = MIXER_Decay(nextSample[0]);
+					nextSample[1] = stereo ? MIXER_Decay(nextSample[1]) : nextSample[0];
+					resample->Input(0)[0] = (float)nextSample[0];
+					resample->Input(1)[0] = (float)nextSample[1];
+					resample->Added(1);
+				}
+				freq_counter -= FREQ_NEXT;
+				resample->Next();
+			}
+			mixpos &= MIXER_BUFMASK;
+			Bit32s* write = mixer.work[mixpos];
+			Bitu frac = freq_counter & FREQ_MASK;
+			Bits sample = resample->Sample(0,frac);
+			write[0] += sample*volmul[0];
+			if (stereo) sample = resample->Sample(1,frac);
+			write[1] += sample*volmul[1];
+			freq_counter += freq_add;
+			mixpos++;
+			done++;
+		}
+		prevSample[0] = prevSample[1] = 0;
+	}
 	if (done < needed) {
 		if(prevSample[0] == 0 && prevSample[1] == 0) {
+			UpdateSleep(needed - done,true);
 			done = needed;
 			//Make sure the next samples are zero when they get switched to prev
 			nextSample[0] = 0;
@@ -241,12 +338,105 @@ void MixerChannel::AddSilence(void) {
 #define MIXER_UPRAMP_STEPS 0
 #define MIXER_UPRAMP_SAVE 512
 
+//Sample of the input as 16 bit signed value
+template<class Type,bool signeddata,bool nativeorder>
+static INLINE Bits MIXER_ReadSample(const Type * data) {
+	if ( sizeof( Type) == 1) {
+		if (!signeddata) return (((Bit8s)(data[0] ^ 0x80)) << 8);
+		else return (data[0] << 8);
+	//16bit and 32bit both contain 16bit data internally
+	} else if (signeddata) {
+		if (nativeorder) return data[0];
+		else if ( sizeof( Type) == 2) return (Bit16s)host_readw((HostPt)data);
+		else return (Bit32s)host_readd((HostPt)data);
+	} else {
+		if (nativeorder) return (Bits)data[0]-32768;
+		else if ( sizeof( Type) == 2) return (Bits)host_readw((HostPt)data)-32768;
+		else return (Bits)host_readd((HostPt)data)-32768;
+	}
+}
+
+/* The channels gather their samples in blocks before the volume is applied,
+   so the work buffer is updated by the vector kernel */
+#define MIXER_BLOCK 128
+
+/* Adds count frames of samples times the volume to the work buffer from mixpos on */
+static void MIXER_AddWork(Bitu mixpos,Bit32s (*samples)[2],Bitu count,const Bit32s * volume) {
+	mixpos &= MIXER_BUFMASK;
+	Bitu first = MIXER_BUFSIZE - mixpos;
+	if (first > count) first = count;
+	Mixer_AddScaled(mixer.work[mixpos],samples[0],first,volume);
+	if (count > first) Mixer_AddScaled(mixer.work[0],samples[first],count - first,volume);
+}
+
+template<class Type,bool stereo,bool signeddata,bool nativeorder>
+inline void MixerChannel::AddResampled(Bitu len, const Type* data) {
+	Bit32s block[MIXER_BLOCK][2];
+	Bitu blocked = 0;
+	Bitu start = done;
+	Bit32s loud = 0;
+	//Position in the incoming data
+	Bitu pos = 0;
+	while (1) {
+		//Does new data need to get read?
+		while (freq_counter >= FREQ_NEXT) {
+			if (!sinc->Left()) {
+				//Would this overflow the source data, then it's time to leave
+				if (pos >= len) {
+					MIXER_AddWork(mixer.pos + done - blocked,block,blocked,volmul);
+					UpdateSleep(done - start,!loud);
+					last_samples_were_silence = false;
+					return;
+				}
+				//Convert a block of the source data at once
+				Bitu count = len - pos;
+				if (count > MIXER_SINC_BLOCK) count = MIXER_SINC_BLOCK;
+				float * left = sinc->Input(0);
+				float * right = sinc->Input(1);
+				for (Bitu i = 0;i < count;i++,pos++) {
+					if (stereo) {
+						left[i] = (float)MIXER_ReadSample<Type,signeddata,nativeorder>(&data[pos*2+0]);
+						right[i] = (float)MIXER_ReadSample<Type,signeddata,nativeorder>(&data[pos*2+1]);
+					} else {
+						left[i] = right[i] = (float)MIXER_ReadSample<Type,signeddata,nativeorder>(&data[pos]);
+					}
+				}
+				sinc->Added(count);
+				//AddSilence goes down to zero from the last sample
+				nextSample[0] = (Bits)left[count - 1];
+				nextSample[1] = (Bits)right[count - 1];
+			}
+			freq_counter -= FREQ_NEXT;
+			sinc->Next();
+		}
+		Bitu frac = freq_counter & FREQ_MASK;
+		Bits sample = sinc->Sample(0,frac);
+		block[blocked][0] = (Bit32s)sample;
+		if (stereo) sample = sinc->Sample(1,frac);
+		block[blocked][1] = (Bit32s)sample;
+		//Prepare for next sample
+		freq_counter += freq_add;
+		done++;
+		loud |= block[blocked][0] | block[blocked][1];
+		if (++blocked == MIXER_BLOCK) {
+			MIXER_AddWork(mixer.pos + done - blocked,block,blocked,volmul);
+			blocked = 0;
+		}
+	}
+}
+
 template<class Type,bool stereo,bool signeddata,bool nativeorder>
 inline void MixerChannel::AddSamples(Bitu len, const Type* data) {
 	last_samples_were_stereo = stereo;
+	if (interpolate && sinc) {
+		AddResampled<Type,stereo,signeddata,nativeorder>(len,data);
+		return;
+	}
 	
-	//Position where to write the data
-	Bitu mixpos = mixer.pos + done;
+	Bit32s block[MIXER_BLOCK][2];
+	Bitu blocked = 0;
+	Bitu start = done;
+	Bit32s loud = 0;
 	//Position in the incoming data
 	Bitu pos = 0;
 	//Mix and data for the full length
@@ -255,6 +445,8 @@ inline void MixerChannel::AddSamples(Bitu len, const Type* data) {
 		while (freq_counter >= FREQ_NEXT) {
 			//Would this overflow the source data, then it's time to leave
 			if (pos >= len) {
+				MIXER_AddWork(mixer.pos + done - blocked,block,blocked,volmul);
+				UpdateSleep(done - start,!loud);
 				last_samples_were_silence = false;
 #if MIXER_UPRAMP_STEPS > 0
 				if (offset[0] || offset[1]) {
@@ -272,75 +464,11 @@ inline void MixerChannel::AddSamples(Bitu len, const Type* data) {
 			if (stereo) {
 				prevSample[1] = nextSample[1];
 			}
-			if ( sizeof( Type) == 1) {
-				if (!signeddata) {
-					if (stereo) {
-						nextSample[0]=(((Bit8s)(data[pos*2+0] ^ 0x80)) << 8);
-						nextSample[1]=(((Bit8s)(data[pos*2+1] ^ 0x80)) << 8);
-					} else {
-						nextSample[0]=(((Bit8s)(data[pos] ^ 0x80)) << 8);
-					}
-				} else {
-					if (stereo) {
-						nextSample[0]=(data[pos*2+0] << 8);
-						nextSample[1]=(data[pos*2+1] << 8);
-					} else {
-						nextSample[0]=(data[pos] << 8);
-					}
-				}
-			//16bit and 32bit both contain 16bit data internally
-			} else  {
-				if (signeddata) {
-					if (stereo) {
-						if (nativeorder) {
-							nextSample[0]=data[pos*2+0];
-							nextSample[1]=data[pos*2+1];
-						} else {
-							if ( sizeof( Type) == 2) {
-								nextSample[0]=(Bit16s)host_readw((HostPt)&data[pos*2+0]);
-								nextSample[1]=(Bit16s)host_readw((HostPt)&data[pos*2+1]);
-							} else {
-								nextSample[0]=(Bit32s)host_readd((HostPt)&data[pos*2+0]);
-								nextSample[1]=(Bit32s)host_readd((HostPt)&data[pos*2+1]);
-							}
-						}
-					} else {
-						if (nativeorder) {
-							nextSample[0] = data[pos];
-						} else {
-							if ( sizeof( Type) == 2) {
-								nextSample[0]=(Bit16s)host_readw((HostPt)&data[pos]);
-							} else {
-								nextSample[0]=(Bit32s)host_readd((HostPt)&data[pos]);
-							}
-						}
-					}
-				} else {
-					if (stereo) {
-						if (nativeorder) {
-							nextSample[0]=(Bits)data[pos*2+0]-32768;
-							nextSample[1]=(Bits)data[pos*2+1]-32768;
-						} else {
-							if ( sizeof( Type) == 2) {
-								nextSample[0]=(Bits)host_readw((HostPt)&data[pos*2+0])-32768;
-								nextSample[1]=(Bits)host_readw((HostPt)&data[pos*2+1])-32768;
-							} else {
-								nextSample[0]=(Bits)host_readd((HostPt)&data[pos*2+0])-32768;
-								nextSample[1]=(Bits)host_readd((HostPt)&data[pos*2+1])-32768;
-							}
-						}
-					} else {
-						if (nativeorder) {
-							nextSample[0]=(Bits)data[pos]-32768;
-						} else {
-							if ( sizeof( Type) == 2) {
-								nextSample[0]=(Bits)host_readw((HostPt)&data[pos])-32768;
-							} else {
-								nextSample[0]=(Bits)host_readd((HostPt)&data[pos])-32768;
-							}
-						}
-					}
-				}
+			if (stereo) {
+				nextSample[0] = MIXER_ReadSample<Type,signeddata,nativeorder>(&data[pos*2+0]);
+				nextSample[1] = MIXER_ReadSample<Type,signeddata,nativeorder>(&data[pos*2+1]);
+			} else {
+				nextSample[0] = MIXER_ReadSample<Type,signeddata,nativeorder>(&data[pos]);
 			}
 			//This sample has been handled now, increase position
 			pos++;
@@ -359,26 +487,27 @@ inline void MixerChannel::AddSamples(Bitu len, const Type* data) {
 			}
 #endif
 		}
-		//Where to write
-		mixpos &= MIXER_BUFMASK;
-		Bit32s* write = mixer.work[mixpos];
 		if (!interpolate) {
-			write[0] += prevSample[0] * volmul[0];
-			write[1] += (stereo ? prevSample[1] : prevSample[0]) * volmul[1];
+			block[blocked][0] = (Bit32s)prevSample[0];
+			block[blocked][1] = (Bit32s)(stereo ? prevSample[1] : prevSample[0]);
 		}
 		else {
 			Bits diff_mul = freq_counter & FREQ_MASK;
 			Bits sample = prevSample[0] + (((nextSample[0] - prevSample[0]) * diff_mul) >> FREQ_SHIFT);
-			write[0] += sample*volmul[0];
+			block[blocked][0] = (Bit32s)sample;
 			if (stereo) {
 				sample = prevSample[1] + (((nextSample[1] - prevSample[1]) * diff_mul) >> FREQ_SHIFT);
 			}
-			write[1] += sample*volmul[1];
+			block[blocked][1] = (Bit32s)sample;
 		}
 		//Prepare for next sample
 		freq_counter += freq_add;
-		mixpos++;
 		done++;
+		loud |= block[blocked][0] | block[blocked][1];
+		if (++blocked == MIXER_BLOCK) {
+			MIXER_AddWork(mixer.pos + done - blocked,block,blocked,volmul);
+			blocked = 0;
+		}
 	}
 }
 
@@ -394,6 +523,8 @@ void MixerChannel::AddStretched(Bitu len,Bit16s * data) {
 	Bitu mixpos = mixer.pos + done;
 	done = needed;
 	Bitu pos = 0;
+	Bit32s block[MIXER_BLOCK][2];
+	Bitu blocked = 0;
 
 	while (outlen--) {
 		Bitu new_pos = index >> FREQ_SHIFT;
@@ -406,11 +537,13 @@ void MixerChannel::AddStretched(Bitu len,Bit16s * data) {
 		Bits diff = data[0] - prevSample[0];
 		Bits diff_mul = index & FREQ_MASK;
 		index += index_add;
-		mixpos &= MIXER_BUFMASK;
 		Bits sample = prevSample[0] + ((diff * diff_mul) >> FREQ_SHIFT);
-		mixer.work[mixpos][0] += sample * volmul[0];
-		mixer.work[mixpos][1] += sample * volmul[1];
-		mixpos++;
+		block[blocked][0] = block[blocked][1] = (Bit32s)sample;
+		if (++blocked == MIXER_BLOCK || !outlen) {
+			MIXER_AddWork(mixpos,block,blocked,volmul);
+			mixpos += blocked;
+			blocked = 0;
+		}
 	}
 }
 
@@ -465,15 +598,11 @@ void MixerChannel::AddSamples_s32_nonnative(Bitu len,const Bit32s * data) {
 
 void MixerChannel::FillUp(void) {
 	if (!enabled) return;
-
-	SDL_LockAudio();
-	if (done < mixer.done) {
-		SDL_UnlockAudio();
-		return;
-	}
+	if (done < mixer.done) return;
 	float index = PIC_TickIndex();
+	Bit64u perfstart = PERF_Start();
 	Mix((Bitu)(index * mixer.needed));
-	SDL_UnlockAudio();
+	PERF_Stop(PERF_HOST_MIXER,perfstart);
 }
 
 extern bool ticksLocked;
@@ -507,13 +636,10 @@ static void MIXER_MixData(Bitu needed) {
 		if (added>1024)
 			added=1024;
 		Bitu readpos=(mixer.pos+mixer.done)&MIXER_BUFMASK;
-		for (Bitu i=0;i<added;i++) {
-			Bits sample=mixer.work[readpos][0] >> MIXER_VOLSHIFT;
-			convert[i][0]=MIXER_CLIP(sample);
-			sample=mixer.work[readpos][1] >> MIXER_VOLSHIFT;
-			convert[i][1]=MIXER_CLIP(sample);
-			readpos=(readpos+1)&MIXER_BUFMASK;
-		}
+		Bitu first=MIXER_BUFSIZE-readpos;
+		if (first>added) first=added;
+		Mixer_Clip(convert[0],mixer.work[readpos],first*2,MIXER_VOLSHIFT);
+		Mixer_Clip(convert[first],mixer.work[0],(added-first)*2,MIXER_VOLSHIFT);
 		CAPTURE_AddWave( mixer.freq, added, (Bit16s*)convert );
 	}
 	//Reset the the tick_add for constant speed
@@ -522,23 +648,49 @@ static void MIXER_MixData(Bitu needed) {
 	mixer.done = needed;
 }
 
-static void MIXER_Mix(void) {
-	SDL_LockAudio();
-	MIXER_MixData(mixer.needed);
-	mixer.tick_counter += mixer.tick_add;
-	mixer.needed+=(mixer.tick_counter >> TICK_SHIFT);
-	mixer.tick_counter &= TICK_MASK;
-	SDL_UnlockAudio();
+/* Adjust the tick rate to what the last audio callback saw */
+static void MIXER_UpdateTickAdd(void) {
+	Bit32u feedback = ring.feedback.exchange(0,std::memory_order_relaxed);
+	Bitu diff = feedback & MIXER_FEEDBACK_VALUE;
+	switch (feedback & ~MIXER_FEEDBACK_VALUE) {
+	case MIXER_FEEDBACK_UNDERRUN:
+		mixer.tick_add = calc_tickadd(mixer.freq+mixer.min_needed);
+		break;
+	case MIXER_FEEDBACK_LOW:
+		mixer.tick_add = calc_tickadd(mixer.freq+(diff*3));
+		break;
+	case MIXER_FEEDBACK_REGULAR:
+		/* Mixer tick value being updated:
+		 * 3 cases:
+		 * 1) A lot too high. >division by 5. but maxed by 2* min to prevent too fast drops.
+		 * 2) A little too high > division by 8
+		 * 3) A little to nothing above the min_needed buffer > go to default value
+		 */
+		if(diff > (mixer.min_needed<<1)) diff = mixer.min_needed<<1;
+		if(diff > (mixer.min_needed>>1))
+			mixer.tick_add = calc_tickadd(mixer.freq-(diff/5));
+		else if (diff > (mixer.min_needed>>2))
+			mixer.tick_add = calc_tickadd(mixer.freq-(diff>>3));
+		else
+			mixer.tick_add = calc_tickadd(mixer.freq);
+		break;
+	case MIXER_FEEDBACK_OVERFLOW:
+		mixer.tick_add = calc_tickadd(mixer.freq-(mixer.min_needed/5));
+		break;
+	}
 }
 
-static void MIXER_Mix_NoSound(void) {
-	MIXER_MixData(mixer.needed);
-	/* Clear piece we've just generated */
-	for (Bitu i=0;i<mixer.needed;i++) {
-		mixer.work[mixer.pos][0]=0;
-		mixer.work[mixer.pos][1]=0;
-		mixer.pos=(mixer.pos+1)&MIXER_BUFMASK;
-	}
+/* Clear the piece that was just generated */
+static void MIXER_ClearWork(Bitu count) {
+	Bitu first = MIXER_BUFSIZE - mixer.pos;
+	if (first > count) first = count;
+	memset(mixer.work[mixer.pos],0,first * sizeof(mixer.work[0]));
+	memset(mixer.work[0],0,(count - first) * sizeof(mixer.work[0]));
+	mixer.pos = (mixer.pos + count) & MIXER_BUFMASK;
+}
+
+/* Set up the work buffer and the channels for the next tick */
+static void MIXER_NextTick(void) {
 	/* Reduce count in channels */
 	for (MixerChannel * chan=mixer.channels;chan;chan=chan->next) {
 		if (chan->done>mixer.needed) chan->done-=mixer.needed;
@@ -551,111 +703,146 @@ static void MIXER_Mix_NoSound(void) {
 	mixer.done=0;
 }
 
+/* Adaptive prebuffer: after an underrun it grows by half, while the buffer
+   never came close to running dry for a while it shrinks a millisecond at a
+   time. Every underrun doubles how long it has to stay stable before the
+   next shrink, so it settles just above what the host needs. */
+#define MIXER_ADAPT_WINDOW	1000	// ticks between evaluations
+#define MIXER_ADAPT_HOLD	60		// most stable windows asked for a shrink
+
+static void MIXER_AdaptPrebuffer(void) {
+	if (++mixer.adapt.ticks < MIXER_ADAPT_WINDOW) return;
+	mixer.adapt.ticks = 0;
+	Bit32u underruns = ring.underruns.exchange(0,std::memory_order_relaxed);
+	Bitu lowest = ring.lowest.exchange(~(Bitu)0,std::memory_order_relaxed);
+	Bitu step = mixer.freq / 1000;
+	Bitu min_needed = mixer.min_needed;
+	if (underruns) {
+		min_needed += (min_needed / 2 > step) ? min_needed / 2 : step;
+		if (min_needed > mixer.adapt.highest) min_needed = mixer.adapt.highest;
+		mixer.adapt.stable = 0;
+		mixer.adapt.hold *= 2;
+		if (mixer.adapt.hold > MIXER_ADAPT_HOLD) mixer.adapt.hold = MIXER_ADAPT_HOLD;
+	} else if (lowest == ~(Bitu)0 || lowest < min_needed / 2) {
+		/* No callbacks, or the buffer came within half the prebuffer of empty */
+		mixer.adapt.stable = 0;
+	} else if (++mixer.adapt.stable >= mixer.adapt.hold) {
+		mixer.adapt.stable = 0;
+		if (min_needed > mixer.adapt.lowest + step) min_needed -= step;
+		else min_needed = mixer.adapt.lowest;
+	}
+	if (min_needed == mixer.min_needed) return;
+	LOG(LOG_MISC,LOG_NORMAL)("MIXER: prebuffer %d ms after %d underruns",(int)(min_needed * 1000 / mixer.freq),(int)underruns);
+	mixer.min_needed = min_needed;
+	ring.min_needed.store(min_needed,std::memory_order_relaxed);
+}
+
+static void MIXER_Mix(void) {
+	Bit64u perfstart = PERF_Start();
+	MIXER_UpdateTickAdd();
+	if (mixer.adapt.enabled) MIXER_AdaptPrebuffer();
+	MIXER_MixData(mixer.needed);
+	/* Hand the finished samples to the callback. When it stopped taking
+	   them and the ring is full, the new ones are dropped. */
+	Bitu write = ring.write.load(std::memory_order_relaxed);
+	Bitu space = MIXER_BUFSIZE - (write - ring.read.load(std::memory_order_acquire));
+	Bitu count = (mixer.needed < space) ? mixer.needed : space;
+	/* Clip in runs where neither buffer wraps */
+	for (Bitu i=0;i<count;) {
+		Bitu from = (mixer.pos + i) & MIXER_BUFMASK;
+		Bitu to = (write + i) & MIXER_BUFMASK;
+		Bitu run = MIXER_BUFSIZE - (from > to ? from : to);
+		if (run > count - i) run = count - i;
+		Mixer_Clip(ring.data[to],mixer.work[from],run*2,MIXER_VOLSHIFT);
+		i += run;
+	}
+	ring.write.store(write + count,std::memory_order_release);
+	MIXER_ClearWork(mixer.needed);
+	MIXER_NextTick();
+	PERF_Stop(PERF_HOST_MIXER,perfstart);
+}
+
+static void MIXER_Mix_NoSound(void) {
+	Bit64u perfstart = PERF_Start();
+	MIXER_MixData(mixer.needed);
+	MIXER_ClearWork(mixer.needed);
+	MIXER_NextTick();
+	PERF_Stop(PERF_HOST_MIXER,perfstart);
+}
+
 static void SDLCALL MIXER_CallBack(void * userdata, Uint8 *stream, int len) {
 	Bitu need=(Bitu)len/MIXER_SSIZE;
 	Bit16s * output=(Bit16s *)stream;
 	Bitu reduce;
-	Bitu pos;
 	//Local resampling counter to manipulate the data when sending it off to the callback
 	Bitu index, index_add;
-	Bits sample;
+	PERF_Add(PERF_MIXER_CALLBACKS,1);
+	Bitu read = ring.read.load(std::memory_order_relaxed);
+	Bitu done = ring.write.load(std::memory_order_acquire) - read;
+	Bitu min_needed = ring.min_needed.load(std::memory_order_relaxed);
+	Bitu max_needed = mixer.blocksize * 2 + 2 * min_needed;
+	/* What was waiting plus the block the device plays from */
+	PERF_Add(PERF_MIXER_LATENCY,(Bit64u)(done + mixer.blocksize) * 1000000 / mixer.freq);
 	/* Enough room in the buffer ? */
-	if (mixer.done < need) {
-//		LOG_MSG("Full underrun need %d, have %d, min %d", need, mixer.done, mixer.min_needed);
-		if((need - mixer.done) > (need >>7) ) //Max 1 procent stretch.
+	if (done < need) {
+//		LOG_MSG("Full underrun need %d, have %d, min %d", need, done, min_needed);
+		PERF_Add(PERF_MIXER_UNDERRUNS,1);
+		ring.underruns.fetch_add(1,std::memory_order_relaxed);
+		ring.lowest.store(0,std::memory_order_relaxed);
+		ring.feedback.store(MIXER_FEEDBACK_UNDERRUN,std::memory_order_relaxed);
+		if((need - done) > (need >>7) ) { //Max 1 procent stretch.
+			memset(stream,0,len);
 			return;
-		reduce = mixer.done;
+		}
+		reduce = done;
 		index_add = (reduce << TICK_SHIFT) / need;
-		mixer.tick_add = calc_tickadd(mixer.freq+mixer.min_needed);
-	} else if (mixer.done < mixer.max_needed) {
-		Bitu left = mixer.done - need;
-		if (left < mixer.min_needed) {
+	} else if (done < max_needed) {
+		Bitu left = done - need;
+		//The emulation thread swaps in a new window at any time, don't lose that
+		Bitu lowest = ring.lowest.load(std::memory_order_relaxed);
+		while (left < lowest && !ring.lowest.compare_exchange_weak(lowest,left,std::memory_order_relaxed)) {}
+		if (left < min_needed) {
 			if( !Mixer_irq_important() ) {
-				Bitu needed = mixer.needed - need;
-				Bitu diff = (mixer.min_needed>needed?mixer.min_needed:needed) - left;
-				mixer.tick_add = calc_tickadd(mixer.freq+(diff*3));
+				ring.feedback.store(MIXER_FEEDBACK_LOW | (Bit32u)(min_needed - left),std::memory_order_relaxed);
 				left = 0; //No stretching as we compensate with the tick_add value
 			} else {
-				left = (mixer.min_needed - left);
-				left = 1 + (2*left) / mixer.min_needed; //left=1,2,3
+				left = (min_needed - left);
+				left = 1 + (2*left) / min_needed; //left=1,2,3
 			}
-//			LOG_MSG("needed underrun need %d, have %d, min %d, left %d", need, mixer.done, mixer.min_needed, left);
+//			LOG_MSG("needed underrun need %d, have %d, min %d, left %d", need, done, min_needed, left);
 			reduce = need - left;
 			index_add = (reduce << TICK_SHIFT) / need;
 		} else {
 			reduce = need;
 			index_add = (1 << TICK_SHIFT);
-//			LOG_MSG("regular run need %d, have %d, min %d, left %d", need, mixer.done, mixer.min_needed, left);
-
-			/* Mixer tick value being updated:
-			 * 3 cases:
-			 * 1) A lot too high. >division by 5. but maxed by 2* min to prevent too fast drops.
-			 * 2) A little too high > division by 8
-			 * 3) A little to nothing above the min_needed buffer > go to default value
-			 */
-			Bitu diff = left - mixer.min_needed;
-			if(diff > (mixer.min_needed<<1)) diff = mixer.min_needed<<1;
-			if(diff > (mixer.min_needed>>1))
-				mixer.tick_add = calc_tickadd(mixer.freq-(diff/5));
-			else if (diff > (mixer.min_needed>>2))
-				mixer.tick_add = calc_tickadd(mixer.freq-(diff>>3));
-			else
-				mixer.tick_add = calc_tickadd(mixer.freq);
+//			LOG_MSG("regular run need %d, have %d, min %d, left %d", need, done, min_needed, left);
+			ring.feedback.store(MIXER_FEEDBACK_REGULAR | (Bit32u)((left - min_needed) & MIXER_FEEDBACK_VALUE),std::memory_order_relaxed);
 		}
 	} else {
 		/* There is way too much data in the buffer */
-//		LOG_MSG("overflow run need %d, have %d, min %d", need, mixer.done, mixer.min_needed);
-		if (mixer.done > MIXER_BUFSIZE)
-			index_add = MIXER_BUFSIZE - 2*mixer.min_needed;
-		else
-			index_add = mixer.done - 2*mixer.min_needed;
+//		LOG_MSG("overflow run need %d, have %d, min %d", need, done, min_needed);
+		PERF_Add(PERF_MIXER_OVERRUNS,1);
+		index_add = done - 2*min_needed;
 		index_add = (index_add << TICK_SHIFT) / need;
-		reduce = mixer.done - 2* mixer.min_needed;
-		mixer.tick_add = calc_tickadd(mixer.freq-(mixer.min_needed/5));
+		reduce = done - 2* min_needed;
+		ring.feedback.store(MIXER_FEEDBACK_OVERFLOW,std::memory_order_relaxed);
 	}
-	/* Reduce done count in all channels */
-	for (MixerChannel * chan=mixer.channels;chan;chan=chan->next) {
-		if (chan->done>reduce) chan->done-=reduce;
-		else chan->done=0;
-	}
-
-	// Reset mixer.tick_add when irqs are important
-	if( Mixer_irq_important() )
-		mixer.tick_add = calc_tickadd(mixer.freq);
-
-	mixer.done -= reduce;
-	mixer.needed -= reduce;
-	pos = mixer.pos;
-	mixer.pos = (mixer.pos + reduce) & MIXER_BUFMASK;
 	index = 0;
 	if(need != reduce) {
+		PERF_Add(PERF_MIXER_STRETCHES,1);
 		while (need--) {
-			Bitu i = (pos + (index >> TICK_SHIFT )) & MIXER_BUFMASK;
+			const Bit16s * sample = ring.data[(read + (index >> TICK_SHIFT)) & MIXER_BUFMASK];
 			index += index_add;
-			sample=mixer.work[i][0]>>MIXER_VOLSHIFT;
-			*output++=MIXER_CLIP(sample);
-			sample=mixer.work[i][1]>>MIXER_VOLSHIFT;
-			*output++=MIXER_CLIP(sample);
-		}
-		/* Clean the used buffer */
-		while (reduce--) {
-			pos &= MIXER_BUFMASK;
-			mixer.work[pos][0]=0;
-			mixer.work[pos][1]=0;
-			pos++;
+			*output++=sample[0];
+			*output++=sample[1];
 		}
 	} else {
-		while (reduce--) {
-			pos &= MIXER_BUFMASK;
-			sample=mixer.work[pos][0]>>MIXER_VOLSHIFT;
-			*output++=MIXER_CLIP(sample);
-			sample=mixer.work[pos][1]>>MIXER_VOLSHIFT;
-			*output++=MIXER_CLIP(sample);
-			mixer.work[pos][0]=0;
-			mixer.work[pos][1]=0;
-			pos++;
-		}
+		Bitu pos = read & MIXER_BUFMASK;
+		Bitu first = (pos + reduce > MIXER_BUFSIZE) ? MIXER_BUFSIZE - pos : reduce;
+		memcpy(output,ring.data[pos],first * MIXER_SSIZE);
+		memcpy(output + first * 2,ring.data[0],(reduce - first) * MIXER_SSIZE);
 	}
+	ring.read.store(read + reduce,std::memory_order_release);
 }
 
 static void MIXER_Stop(Section* sec) {
@@ -708,13 +895,13 @@ public:
 		WriteOut("Channel  Main    Main(dB)\n");
 		ShowVolume("MASTER",mixer.mastervol[0],mixer.mastervol[1]);
 		for (chan = mixer.channels;chan;chan = chan->next)
-			ShowVolume(chan->name,chan->volmain[0],chan->volmain[1]);
+			ShowVolume(chan->name,chan->volmain[0],chan->volmain[1],chan->sleeping ? "sleeping" : "");
 	}
 private:
-	void ShowVolume(const char * name,float vol0,float vol1) {
-		WriteOut("%-8s %3.0f:%-3.0f  %+3.2f:%-+3.2f \n",name,
+	void ShowVolume(const char * name,float vol0,float vol1,const char * state = "") {
+		WriteOut("%-8s %3.0f:%-3.0f  %+3.2f:%-+3.2f %s\n",name,
 			vol0*100,vol1*100,
-			20*log(vol0)/log(10.0f),20*log(vol1)/log(10.0f)
+			20*log(vol0)/log(10.0f),20*log(vol1)/log(10.0f),state
 		);
 	}
 
@@ -754,6 +941,11 @@ void MIXER_Init(Section* sec) {
 	mixer.freq=section->Get_int("rate");
 	mixer.nosound=section->Get_bool("nosound");
 	mixer.blocksize=section->Get_int("blocksize");
+	std::string resampler = section->Get_string("resampler");
+	if (resampler == "low") mixer.sinc_taps = 8;
+	else if (resampler == "medium") mixer.sinc_taps = 16;
+	else if (resampler == "high") mixer.sinc_taps = 32;
+	else mixer.sinc_taps = 0;
 
 	/* Initialize the internal stuff */
 	mixer.channels=0;
@@ -791,12 +983,22 @@ void MIXER_Init(Section* sec) {
 		mixer.blocksize=obtained.samples;
 		mixer.tick_add=calc_tickadd(mixer.freq);
 		TIMER_AddTickHandler(MIXER_Mix);
-		SDL_PauseAudio(0);
 	}
 	mixer.min_needed=section->Get_int("prebuffer");
 	if (mixer.min_needed>100) mixer.min_needed=100;
 	mixer.min_needed=(mixer.freq*mixer.min_needed)/1000;
-	mixer.max_needed=mixer.blocksize * 2 + 2*mixer.min_needed;
+	mixer.adapt.enabled=section->Get_bool("adaptiveprebuffer");
+	mixer.adapt.ticks=0;
+	mixer.adapt.stable=0;
+	mixer.adapt.hold=2;
+	mixer.adapt.lowest=mixer.freq/1000;
+	mixer.adapt.highest=mixer.freq/10;
+	ring.min_needed.store(mixer.min_needed,std::memory_order_relaxed);
+	ring.lowest.store(~(Bitu)0,std::memory_order_relaxed);
+	ring.underruns.store(0,std::memory_order_relaxed);
+	mixer.sleep_after=(mixer.freq*section->Get_int("autosleep"))/1000;
 	mixer.needed=mixer.min_needed+1;
+	/* The callback reads the sizes above */
+	if (!mixer.nosound) SDL_PauseAudio(0);
 	PROGRAMS_MakeFile("MIXER.COM",MIXER_ProgramStart);
 }
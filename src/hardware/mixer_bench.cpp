@@ -0,0 +1,194 @@
+/*
+ *  Copyright (C) 2002-2020  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Resampler benchmark, built with "make mixer_bench" in src/hardware.
+   Usage: mixer_bench [output rate] [seconds]
+   Converts noise from the usual device rates to the output rate with the
+   linear interpolation of MixerChannel::AddSamples and every sinc quality,
+   and reports the best time for one second of one channel. Then adds eight
+   stereo channels into the work buffer and clips it to the output, once the
+   sample at a time way the mixer used to and once with the block kernels,
+   and reports the best time for one second of output. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "dosbox.h"
+#include "mixer_sinc.h"
+
+#define FREQ_SHIFT 14
+#define FREQ_NEXT ( 1 << FREQ_SHIFT)
+#define FREQ_MASK ( FREQ_NEXT -1 )
+
+static Bit64u Now(void) {
+	return (Bit64u)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* The same steps as AddSamples for a mono channel, but into a plain buffer */
+static void RunLinear(const Bit16s * in,Bit32s * out,Bitu outLen,Bitu freq_add) {
+	Bitu freq_counter = FREQ_NEXT;
+	Bits prevSample = 0, nextSample = 0;
+	Bitu pos = 0;
+	for (Bitu i = 0;i < outLen;i++) {
+		while (freq_counter >= FREQ_NEXT) {
+			freq_counter -= FREQ_NEXT;
+			prevSample = nextSample;
+			nextSample = in[pos++];
+		}
+		Bits diff_mul = freq_counter & FREQ_MASK;
+		Bits sample = prevSample + (((nextSample - prevSample) * diff_mul) >> FREQ_SHIFT);
+		out[i] += sample * 8192;
+		freq_counter += freq_add;
+	}
+}
+
+/* The same steps as AddResampled for a mono channel */
+static void RunSinc(MixerSinc & sinc,const Bit16s * in,Bit32s * out,Bitu outLen,Bitu freq_add) {
+	Bitu freq_counter = FREQ_NEXT;
+	Bitu pos = 0;
+	for (Bitu i = 0;i < outLen;i++) {
+		while (freq_counter >= FREQ_NEXT) {
+			if (!sinc.Left()) {
+				float * left = sinc.Input(0);
+				float * right = sinc.Input(1);
+				for (Bitu n = 0;n < MIXER_SINC_BLOCK;n++,pos++)
+					left[n] = right[n] = (float)in[pos];
+				sinc.Added(MIXER_SINC_BLOCK);
+			}
+			freq_counter -= FREQ_NEXT;
+			sinc.Next();
+		}
+		out[i] += sinc.Sample(0,freq_counter & FREQ_MASK) * 8192;
+		freq_counter += freq_add;
+	}
+}
+
+#define MIX_CHANNELS 8
+#define MIX_VOLSHIFT 13
+
+static void MixScalar(Bit32s (*work)[2],Bit32s (* const * chans)[2],Bit16s (*out)[2],Bitu frames,const Bit32s * vol) {
+	for (Bitu c = 0;c < MIX_CHANNELS;c++) {
+		for (Bitu i = 0;i < frames;i++) {
+			work[i][0] += chans[c][i][0] * vol[0];
+			work[i][1] += chans[c][i][1] * vol[1];
+		}
+	}
+	for (Bitu i = 0;i < frames;i++) {
+		for (Bitu n = 0;n < 2;n++) {
+			Bits sample = work[i][n] >> MIX_VOLSHIFT;
+			out[i][n] = (Bit16s)(sample < 32767 ? (sample > -32768 ? sample : -32768) : 32767);
+		}
+	}
+	memset(work,0,frames * sizeof(work[0]));
+}
+
+static void MixBlock(Bit32s (*work)[2],Bit32s (* const * chans)[2],Bit16s (*out)[2],Bitu frames,const Bit32s * vol) {
+	for (Bitu c = 0;c < MIX_CHANNELS;c++)
+		Mixer_AddScaled(work[0],chans[c][0],frames,vol);
+	Mixer_Clip(out[0],work[0],frames * 2,MIX_VOLSHIFT);
+	memset(work,0,frames * sizeof(work[0]));
+}
+
+/* One tick of the mixer at a time, like the timer runs it */
+static void TimeMix(Bitu outFreq,Bitu seconds) {
+	Bitu tick = outFreq / 1000;
+	std::vector<Bit32s> work(tick * 2);
+	std::vector<Bit16s> out[2];
+	std::vector<Bit32s> chanData[MIX_CHANNELS];
+	Bit32s (*chans[MIX_CHANNELS])[2];
+	Bit32u seed = 1;
+	for (Bitu c = 0;c < MIX_CHANNELS;c++) {
+		chanData[c].resize(outFreq * 2);
+		for (Bitu i = 0;i < outFreq * 2;i++) {
+			seed = seed * 1103515245 + 12345;
+			chanData[c][i] = (Bit16s)(seed >> 16);
+		}
+		chans[c] = (Bit32s (*)[2])&chanData[c][0];
+	}
+	const Bit32s vol[2] = { 8192, 6000 };
+	printf("\n%-8s %18s\n","mix","ns/second");
+	for (Bitu kind = 0;kind < 2;kind++) {
+		out[kind].resize(outFreq * 2);
+		Bit64u best = ~(Bit64u)0;
+		for (Bitu s = 0;s < seconds;s++) {
+			Bit64u start = Now();
+			for (Bitu pos = 0;pos + tick <= outFreq;pos += tick) {
+				Bit32s (*tickChans[MIX_CHANNELS])[2];
+				for (Bitu c = 0;c < MIX_CHANNELS;c++) tickChans[c] = chans[c] + pos;
+				Bit16s (*tickOut)[2] = (Bit16s (*)[2])&out[kind][pos * 2];
+				if (kind) MixBlock((Bit32s (*)[2])&work[0],tickChans,tickOut,tick,vol);
+				else MixScalar((Bit32s (*)[2])&work[0],tickChans,tickOut,tick,vol);
+			}
+			Bit64u time = Now() - start;
+			if (time < best) best = time;
+		}
+		printf("%-8s %18.0f\n",kind ? "block" : "scalar",(double)best);
+	}
+	if (out[0] != out[1]) printf("The block kernels give a different output!\n");
+}
+
+int main(int argc,char * argv[]) {
+	Bitu outFreq = argc > 1 ? (Bitu)atoi(argv[1]) : 48000;
+	Bitu seconds = argc > 2 ? (Bitu)atoi(argv[2]) : 2;
+	static const Bitu inFreqs[] = { 11025, 22050, 44100, 49716 };
+	static const struct {
+		const char * name;
+		Bitu taps;
+	} qualities[] = {
+		{ "linear", 0 }, { "low", 8 }, { "medium", 16 }, { "high", 32 },
+	};
+	if (!outFreq || !seconds) {
+		printf("Usage: mixer_bench [output rate] [seconds]\n");
+		return 1;
+	}
+
+	std::vector<Bit32s> out(outFreq);
+	printf("%-8s %8s %18s\n","quality","input","ns/channel-second");
+	for (Bitu q = 0;q < sizeof(qualities) / sizeof(qualities[0]);q++) {
+		for (Bitu f = 0;f < sizeof(inFreqs) / sizeof(inFreqs[0]);f++) {
+			Bitu inFreq = inFreqs[f];
+			Bitu freq_add = (inFreq << FREQ_SHIFT) / outFreq;
+			/* Enough input for one second of output and the rounding */
+			std::vector<Bit16s> in(inFreq + 16 + MIXER_SINC_BLOCK);
+			Bit32u seed = 1;
+			for (Bitu i = 0;i < in.size();i++) {
+				seed = seed * 1103515245 + 12345;
+				in[i] = (Bit16s)(seed >> 16);
+			}
+			MixerSinc sinc;
+			if (qualities[q].taps) sinc.Setup(qualities[q].taps,inFreq,outFreq);
+			Bit64u best = ~(Bit64u)0;
+			for (Bitu s = 0;s < seconds;s++) {
+				memset(&out[0],0,outFreq * sizeof(Bit32s));
+				Bit64u start = Now();
+				if (qualities[q].taps) RunSinc(sinc,&in[0],&out[0],outFreq,freq_add);
+				else RunLinear(&in[0],&out[0],outFreq,freq_add);
+				Bit64u time = Now() - start;
+				if (time < best) best = time;
+			}
+			printf("%-8s %8d %18.0f\n",qualities[q].name,(int)inFreq,(double)best);
+			fflush(stdout);
+		}
+	}
+	TimeMix(outFreq,seconds);
+	return 0;
+}
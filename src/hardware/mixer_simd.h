@@ -0,0 +1,170 @@
+/*
+ *  Copyright (C) 2002-2020  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Vector helpers for the mixer, picked when compiling like the ones of the
+   scalers in render_simd.h. Define MIXER_NO_SIMD to build the plain C
+   versions for comparison. */
+
+#ifndef DOSBOX_MIXER_SIMD_H
+#define DOSBOX_MIXER_SIMD_H
+
+#if !defined(MIXER_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define MIXER_SIMD_SSE2 1
+#define MIXER_SIMD 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MIXER_SIMD_NEON 1
+#define MIXER_SIMD 1
+#endif
+#endif
+
+/* Nearest integer, without the library call lrintf can be */
+static INLINE Bits Mixer_Round(float value) {
+#if defined(MIXER_SIMD_SSE2)
+	return _mm_cvtss_si32(_mm_set_ss(value));
+#else
+	return (Bits)(value >= 0 ? value + 0.5f : value - 0.5f);
+#endif
+}
+
+/* Sum of a[i]*b[i], count is a multiple of 8 */
+static INLINE float Mixer_Dot(const float * a,const float * b,Bitu count) {
+#if defined(MIXER_SIMD_SSE2)
+	__m128 s0 = _mm_setzero_ps();
+	__m128 s1 = _mm_setzero_ps();
+	for (Bitu i = 0;i < count;i += 8) {
+		s0 = _mm_add_ps(s0,_mm_mul_ps(_mm_loadu_ps(a + i),_mm_loadu_ps(b + i)));
+		s1 = _mm_add_ps(s1,_mm_mul_ps(_mm_loadu_ps(a + i + 4),_mm_loadu_ps(b + i + 4)));
+	}
+	s0 = _mm_add_ps(s0,s1);
+	s0 = _mm_add_ps(s0,_mm_movehl_ps(s0,s0));
+	s0 = _mm_add_ss(s0,_mm_shuffle_ps(s0,s0,1));
+	return _mm_cvtss_f32(s0);
+#elif defined(MIXER_SIMD_NEON)
+	float32x4_t s0 = vdupq_n_f32(0);
+	float32x4_t s1 = vdupq_n_f32(0);
+	for (Bitu i = 0;i < count;i += 8) {
+		s0 = vmlaq_f32(s0,vld1q_f32(a + i),vld1q_f32(b + i));
+		s1 = vmlaq_f32(s1,vld1q_f32(a + i + 4),vld1q_f32(b + i + 4));
+	}
+	s0 = vaddq_f32(s0,s1);
+	float32x2_t s = vadd_f32(vget_low_f32(s0),vget_high_f32(s0));
+	return vget_lane_f32(vpadd_f32(s,s),0);
+#else
+	float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	for (Bitu i = 0;i < count;i += 4) {
+		s0 += a[i] * b[i];
+		s1 += a[i + 1] * b[i + 1];
+		s2 += a[i + 2] * b[i + 2];
+		s3 += a[i + 3] * b[i + 3];
+	}
+	return (s0 + s1) + (s2 + s3);
+#endif
+}
+
+/* work[i] += samples[i] * volume[i & 1] over count interleaved stereo frames.
+   The products keep the low 32 bits like the plain multiply does. */
+static INLINE void Mixer_AddScaled(Bit32s * work,const Bit32s * samples,Bitu count,const Bit32s * volume) {
+	Bitu i = 0;
+	count *= 2;
+#if defined(MIXER_SIMD_SSE2)
+	/* SSE2 only multiplies the even lanes, the odd ones go through a shift */
+	const __m128i vol = _mm_set_epi32(volume[1],volume[0],volume[1],volume[0]);
+	const __m128i volOdd = _mm_srli_epi64(vol,32);
+	for (;i + 4 <= count;i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(samples + i));
+		__m128i even = _mm_mul_epu32(s,vol);
+		__m128i odd = _mm_mul_epu32(_mm_srli_epi64(s,32),volOdd);
+		__m128i prod = _mm_unpacklo_epi32(_mm_shuffle_epi32(even,_MM_SHUFFLE(0,0,2,0)),
+			_mm_shuffle_epi32(odd,_MM_SHUFFLE(0,0,2,0)));
+		__m128i w = _mm_loadu_si128((const __m128i *)(work + i));
+		_mm_storeu_si128((__m128i *)(work + i),_mm_add_epi32(w,prod));
+	}
+#elif defined(MIXER_SIMD_NEON)
+	const int32x4_t vol = vcombine_s32(vld1_s32(volume),vld1_s32(volume));
+	for (;i + 4 <= count;i += 4)
+		vst1q_s32(work + i,vmlaq_s32(vld1q_s32(work + i),vld1q_s32(samples + i),vol));
+#endif
+	for (;i < count;i += 2) {
+		work[i] = (Bit32s)((Bit32u)work[i] + (Bit32u)samples[i] * (Bit32u)volume[0]);
+		work[i + 1] = (Bit32s)((Bit32u)work[i + 1] + (Bit32u)samples[i + 1] * (Bit32u)volume[1]);
+	}
+}
+
+/* work[i*2] += samples[i] * left[i] and work[i*2+1] += samples[i] * right[i]
+   over count stereo frames, for a mono voice with its own volume per sample */
+static INLINE void Mixer_AddPanned(Bit32s * work,const Bit16s * samples,const Bit16s * left,const Bit16s * right,Bitu count) {
+	Bitu i = 0;
+#if defined(MIXER_SIMD_SSE2)
+	/* The low and high halves of the 16 bit products give 32 bit ones */
+	for (;i + 8 <= count;i += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(samples + i));
+		__m128i l = _mm_loadu_si128((const __m128i *)(left + i));
+		__m128i r = _mm_loadu_si128((const __m128i *)(right + i));
+		__m128i lLo = _mm_mullo_epi16(s,l), lHi = _mm_mulhi_epi16(s,l);
+		__m128i rLo = _mm_mullo_epi16(s,r), rHi = _mm_mulhi_epi16(s,r);
+		__m128i l0 = _mm_unpacklo_epi16(lLo,lHi), l1 = _mm_unpackhi_epi16(lLo,lHi);
+		__m128i r0 = _mm_unpacklo_epi16(rLo,rHi), r1 = _mm_unpackhi_epi16(rLo,rHi);
+		__m128i * w = (__m128i *)(work + i * 2);
+		_mm_storeu_si128(w + 0,_mm_add_epi32(_mm_loadu_si128(w + 0),_mm_unpacklo_epi32(l0,r0)));
+		_mm_storeu_si128(w + 1,_mm_add_epi32(_mm_loadu_si128(w + 1),_mm_unpackhi_epi32(l0,r0)));
+		_mm_storeu_si128(w + 2,_mm_add_epi32(_mm_loadu_si128(w + 2),_mm_unpacklo_epi32(l1,r1)));
+		_mm_storeu_si128(w + 3,_mm_add_epi32(_mm_loadu_si128(w + 3),_mm_unpackhi_epi32(l1,r1)));
+	}
+#elif defined(MIXER_SIMD_NEON)
+	for (;i + 4 <= count;i += 4) {
+		int16x4_t s = vld1_s16(samples + i);
+		int32x4x2_t w = vld2q_s32(work + i * 2);
+		w.val[0] = vmlal_s16(w.val[0],s,vld1_s16(left + i));
+		w.val[1] = vmlal_s16(w.val[1],s,vld1_s16(right + i));
+		vst2q_s32(work + i * 2,w);
+	}
+#endif
+	for (;i < count;i++) {
+		work[i * 2] = (Bit32s)((Bit32u)work[i * 2] + (Bit32u)(samples[i] * left[i]));
+		work[i * 2 + 1] = (Bit32s)((Bit32u)work[i * 2 + 1] + (Bit32u)(samples[i] * right[i]));
+	}
+}
+
+/* out[i] = in[i] >> shift, saturated to 16 bit */
+static INLINE void Mixer_Clip(Bit16s * out,const Bit32s * in,Bitu count,int shift) {
+	Bitu i = 0;
+#if defined(MIXER_SIMD_SSE2)
+	const __m128i sh = _mm_cvtsi32_si128(shift);
+	for (;i + 8 <= count;i += 8) {
+		__m128i a = _mm_sra_epi32(_mm_loadu_si128((const __m128i *)(in + i)),sh);
+		__m128i b = _mm_sra_epi32(_mm_loadu_si128((const __m128i *)(in + i + 4)),sh);
+		_mm_storeu_si128((__m128i *)(out + i),_mm_packs_epi32(a,b));
+	}
+#elif defined(MIXER_SIMD_NEON)
+	const int32x4_t sh = vdupq_n_s32(-shift);
+	for (;i + 8 <= count;i += 8) {
+		int16x4_t a = vqmovn_s32(vshlq_s32(vld1q_s32(in + i),sh));
+		int16x4_t b = vqmovn_s32(vshlq_s32(vld1q_s32(in + i + 4),sh));
+		vst1q_s16(out + i,vcombine_s16(a,b));
+	}
+#endif
+	for (;i < count;i++) {
+		Bit32s sample = in[i] >> shift;
+		out[i] = (Bit16s)(sample > 32767 ? 32767 : (sample < -32768 ? -32768 : sample));
+	}
+}
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ *  Copyright (C) 2002-2020  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include <string.h>
+#include <math.h>
+
+#include "dosbox.h"
+#include "mixer_sinc.h"
+
+/* Modified bessel function of order 0 for the kaiser window */
+static double BesselI0(double x) {
+	double sum = 1, term = 1;
+	for (int k = 1;k < 32;k++) {
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+		if (term < sum * 1e-12) break;
+	}
+	return sum;
+}
+
+MixerSinc::MixerSinc() {
+	table = 0;
+	taps = 0;
+	inFreq = outFreq = 0;
+	Clear();
+}
+
+MixerSinc::~MixerSinc() {
+	delete [] table;
+}
+
+void MixerSinc::Clear(void) {
+	memset(buffer,0,sizeof(buffer));
+	added = used = MIXER_SINC_MAXTAPS;
+	loudEnd = 0;
+}
+
+void MixerSinc::Compact(void) {
+	Bitu start = used - taps;
+	for (Bitu chan = 0;chan < 2;chan++)
+		memmove(&buffer[chan][0],&buffer[chan][start],(added - start) * sizeof(float));
+	added -= start;
+	used -= start;
+	loudEnd = (loudEnd > start) ? loudEnd - start : 0;
+}
+
+void MixerSinc::Setup(Bitu _taps,Bitu _inFreq,Bitu _outFreq) {
+	if (_taps == taps && _inFreq == inFreq && _outFreq == outFreq) return;
+	if (_taps != taps) {
+		delete [] table;
+		table = new float[MIXER_SINC_PHASES * _taps];
+		taps = _taps;
+		Clear();
+	}
+	inFreq = _inFreq;
+	outFreq = _outFreq;
+	/* The longer filters get a steeper edge, so they can go closer to
+	   the nyquist frequency and still keep the images out */
+	double beta, rolloff;
+	if (taps <= 8) { beta = 5.0; rolloff = 0.80; }
+	else if (taps <= 16) { beta = 6.5; rolloff = 0.88; }
+	else { beta = 8.0; rolloff = 0.93; }
+	/* Cutoff relative to the input nyquist frequency, lower when the
+	   output can't carry it */
+	double cutoff = rolloff;
+	if (outFreq < inFreq) cutoff *= (double)outFreq / (double)inFreq;
+	const double pi = 3.14159265358979323846;
+	const double half = (double)(taps / 2);
+	const double norm = BesselI0(beta);
+	for (Bitu phase = 0;phase < MIXER_SINC_PHASES;phase++) {
+		double frac = (double)phase / MIXER_SINC_PHASES;
+		float * coefs = table + phase * taps;
+		double sum = 0;
+		double row[MIXER_SINC_MAXTAPS];
+		for (Bitu i = 0;i < taps;i++) {
+			/* Distance of the tap from the output position in input samples */
+			double x = (double)i - (half - 1) - frac;
+			double s = (x == 0) ? cutoff : sin(pi * cutoff * x) / (pi * x);
+			double w = x / half;
+			w = (w <= -1 || w >= 1) ? 0 : BesselI0(beta * sqrt(1 - w * w)) / norm;
+			row[i] = s * w;
+			sum += row[i];
+		}
+		/* Every phase passes DC unchanged */
+		for (Bitu i = 0;i < taps;i++) coefs[i] = (float)(row[i] / sum);
+	}
+}
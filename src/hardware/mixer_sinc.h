@@ -0,0 +1,92 @@
+/*
+ *  Copyright (C) 2002-2020  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Polyphase windowed sinc resampler of a mixer channel.
+   The channel converts its input into the buffer a block at a time and then
+   asks for output samples at the fraction of its freq_counter, stepping to
+   the next input sample whenever the counter flows over. Writing the whole
+   block first keeps the vector loads of the filter away from the stores of
+   the samples they read. The filter is centered between the two samples
+   taps/2-1 and taps/2 back, so the output lags the input by taps/2-1 input
+   samples. */
+
+#ifndef DOSBOX_MIXER_SINC_H
+#define DOSBOX_MIXER_SINC_H
+
+#ifndef DOSBOX_DOSBOX_H
+#include "dosbox.h"
+#endif
+
+#include "mixer_simd.h"
+
+#define MIXER_SINC_MAXTAPS 32
+#define MIXER_SINC_PHASESHIFT 9
+#define MIXER_SINC_PHASES (1 << MIXER_SINC_PHASESHIFT)
+/* Bits of the fraction the output sample is asked at */
+#define MIXER_SINC_FRACSHIFT 14
+
+#define MIXER_SINC_BLOCK 256
+
+class MixerSinc {
+public:
+	MixerSinc();
+	~MixerSinc();
+	/* taps is 8, 16 or 32, the filter is only rebuilt when something changed */
+	void Setup(Bitu _taps,Bitu inFreq,Bitu outFreq);
+	void Clear(void);
+	/* The filter only gives zeros until new input is added */
+	bool Silent(void) const {
+		return loudEnd + taps <= used;
+	}
+	/* Input samples not stepped to yet */
+	Bitu Left(void) const {
+		return added - used;
+	}
+	/* Where the next input samples of a channel go, up to MIXER_SINC_BLOCK
+	   of them. Only when all earlier ones were used. */
+	float * Input(Bitu chan) {
+		if (used > taps) Compact();
+		return &buffer[chan][added];
+	}
+	/* Makes count samples written to Input available */
+	void Added(Bitu count) {
+		for (Bitu i = added;i < added + count;i++) {
+			if (buffer[0][i] != 0 || buffer[1][i] != 0) loudEnd = i + 1;
+		}
+		added += count;
+	}
+	void Next(void) {
+		used++;
+	}
+	Bits Sample(Bitu chan,Bitu frac) const {
+		const float * coefs = table + (frac >> (MIXER_SINC_FRACSHIFT - MIXER_SINC_PHASESHIFT)) * taps;
+		return Mixer_Round(Mixer_Dot(&buffer[chan][used - taps],coefs,taps));
+	}
+private:
+	void Compact(void);
+	float * table;
+	Bitu taps;
+	Bitu inFreq, outFreq;
+	/* The last taps samples before used are the ones the filter sees */
+	Bitu added, used;
+	/* One past the last sample that wasn't zero */
+	Bitu loudEnd;
+	float buffer[2][MIXER_SINC_MAXTAPS + MIXER_SINC_BLOCK];
+};
+
+#endif
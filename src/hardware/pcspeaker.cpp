@@ -177,6 +177,8 @@ void PCSPEAKER_SetCounter(Bitu cntr,Bitu mode) {
 		if(spkr.chan) spkr.chan->Enable(true);
 		spkr.last_index=0;
 	}
+	//The callback didn't run while the channel was sleeping
+	if (spkr.chan && spkr.chan->WakeUp()) spkr.last_index=0;
 	spkr.last_ticks=PIC_Ticks;
 	float newindex=PIC_TickIndex();
 	ForwardPIT(newindex);
@@ -278,6 +280,8 @@ void PCSPEAKER_SetType(Bitu mode) {
 		if(spkr.chan) spkr.chan->Enable(true);
 		spkr.last_index=0;
 	}
+	//The callback didn't run while the channel was sleeping
+	if (spkr.chan && spkr.chan->WakeUp()) spkr.last_index=0;
 	spkr.last_ticks=PIC_Ticks;
 	float newindex=PIC_TickIndex();
 	ForwardPIT(newindex);
@@ -447,6 +451,7 @@ public:
 		spkr.used=0;
 		/* Register the sound channel */
 		spkr.chan=MixerChan.Install(&PCSPEAKER_CallBack,spkr.rate,"SPKR");
+		spkr.chan->SetAutoSleep(true);
 	}
 	~PCSPEAKER(){
 		Section_prop * section=static_cast<Section_prop *>(m_configuration);
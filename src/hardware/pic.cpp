@@ -23,6 +23,7 @@
 #include "pic.h"
 #include "timer.h"
 #include "setup.h"
+#include "perf.h"
 
 #define PIC_QUEUESIZE 512
 
@@ -478,17 +479,22 @@ bool PIC_RunQueue(void) {
 	/* Check the queue for an entry */
 	Bits index_nd=PIC_TickIndexND();
 	InEventService = true;
+	Bit64u start = 0;
+	if (pic_queue.next_entry && (pic_queue.next_entry->index*CPU_CycleMax<=index_nd))
+		start = PERF_Start();
 	while (pic_queue.next_entry && (pic_queue.next_entry->index*CPU_CycleMax<=index_nd)) {
 		PICEntry * entry=pic_queue.next_entry;
 		pic_queue.next_entry=entry->next;
 
 		srv_lag = entry->index;
 		(entry->pic_event)(entry->value); // call the event handler
+		PERF_Add(PERF_PIC_EVENTS,1);
 
 		/* Put the entry in the free list */
 		entry->next=pic_queue.free_entry;
 		pic_queue.free_entry=entry;
 	}
+	PERF_Stop(PERF_HOST_PIC,start);
 	InEventService = false;
 
 	/* Check when to set the new cycle end */
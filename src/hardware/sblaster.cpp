@@ -416,6 +416,103 @@ INLINE Bit8u decode_ADPCM_3_sample(Bit8u sample,Bit8u & reference,Bits& scale) {
 	return reference;
 }
 
+/* Decoders for a block of adpcm data, with the reference and the step size
+   kept in locals while going through it */
+static Bitu decode_ADPCM_2_block(const Bit8u * in,Bitu count,Bit8u * out) {
+	Bit8u reference=sb.adpcm.reference;
+	Bits scale=sb.adpcm.stepsize;
+	for (Bitu i=0;i<count;i++) {
+		Bit8u val=in[i];
+		out[0]=decode_ADPCM_2_sample((val >> 6) & 0x3,reference,scale);
+		out[1]=decode_ADPCM_2_sample((val >> 4) & 0x3,reference,scale);
+		out[2]=decode_ADPCM_2_sample((val >> 2) & 0x3,reference,scale);
+		out[3]=decode_ADPCM_2_sample((val >> 0) & 0x3,reference,scale);
+		out+=4;
+	}
+	sb.adpcm.reference=reference;
+	sb.adpcm.stepsize=scale;
+	return count*4;
+}
+
+static Bitu decode_ADPCM_3_block(const Bit8u * in,Bitu count,Bit8u * out) {
+	Bit8u reference=sb.adpcm.reference;
+	Bits scale=sb.adpcm.stepsize;
+	for (Bitu i=0;i<count;i++) {
+		Bit8u val=in[i];
+		out[0]=decode_ADPCM_3_sample((val >> 5) & 0x7,reference,scale);
+		out[1]=decode_ADPCM_3_sample((val >> 2) & 0x7,reference,scale);
+		out[2]=decode_ADPCM_3_sample((val & 0x3) << 1,reference,scale);
+		out+=3;
+	}
+	sb.adpcm.reference=reference;
+	sb.adpcm.stepsize=scale;
+	return count*3;
+}
+
+static Bitu decode_ADPCM_4_block(const Bit8u * in,Bitu count,Bit8u * out) {
+	Bit8u reference=sb.adpcm.reference;
+	Bits scale=sb.adpcm.stepsize;
+	for (Bitu i=0;i<count;i++) {
+		Bit8u val=in[i];
+		out[0]=decode_ADPCM_4_sample(val >> 4,reference,scale);
+		out[1]=decode_ADPCM_4_sample(val & 0xf,reference,scale);
+		out+=2;
+	}
+	sb.adpcm.reference=reference;
+	sb.adpcm.stepsize=scale;
+	return count*2;
+}
+
+/* Sends frames of 8 or 16 bit pcm in the format of the transfer to the mixer */
+static void SendPCM(Bitu frames,Bit8u * data) {
+	if (sb.dma.mode == DSP_DMA_8) {
+		if (sb.dma.stereo) {
+			if (!sb.dma.sign) sb.chan->AddSamples_s8(frames,data);
+			else sb.chan->AddSamples_s8s(frames,(Bit8s *)data);
+		} else {
+			if (!sb.dma.sign) sb.chan->AddSamples_m8(frames,data);
+			else sb.chan->AddSamples_m8s(frames,(Bit8s *)data);
+		}
+		return;
+	}
+	Bit16s * data16=(Bit16s *)data;
+#if defined(WORDS_BIGENDIAN)
+	if (sb.dma.stereo) {
+		if (sb.dma.sign) sb.chan->AddSamples_s16_nonnative(frames,data16);
+		else sb.chan->AddSamples_s16u_nonnative(frames,(Bit16u *)data16);
+	} else {
+		if (sb.dma.sign) sb.chan->AddSamples_m16_nonnative(frames,data16);
+		else sb.chan->AddSamples_m16u_nonnative(frames,(Bit16u *)data16);
+	}
+#else
+	if (sb.dma.stereo) {
+		if (sb.dma.sign) sb.chan->AddSamples_s16(frames,data16);
+		else sb.chan->AddSamples_s16u(frames,(Bit16u *)data16);
+	} else {
+		if (sb.dma.sign) sb.chan->AddSamples_m16(frames,data16);
+		else sb.chan->AddSamples_m16u(frames,(Bit16u *)data16);
+	}
+#endif
+}
+
+/* Hands the mixer the pcm of the transfer where it lies in memory, for as
+   many whole frames as it can, and returns the dma units it read */
+static Bitu SendDirectPCM(Bitu size) {
+	Bitu frame=sb.dma.stereo ? 2 : 1;
+	Bitu read=0;
+	while (read < size) {
+		Bit8u * data;
+		Bitu todo=sb.dma.chan->Map(size-read,data);
+		todo-=todo % frame;
+		if (!todo) break;
+		SendPCM(todo/frame,data);
+		//Only moves the transfer on
+		sb.dma.chan->Read(todo,0);
+		read+=todo;
+	}
+	return read;
+}
+
 static void GenerateDMASound(Bitu size) {
 	Bitu read=0;Bitu done=0;Bitu i=0;
 	last_dma_callback = PIC_FullIndex();
@@ -439,12 +536,7 @@ static void GenerateDMASound(Bitu size) {
 			sb.adpcm.stepsize=MIN_ADAPTIVE_STEP_SIZE;
 			i++;
 		}
-		for (;i<read;i++) {
-			MixTemp[done++]=decode_ADPCM_2_sample((sb.dma.buf.b8[i] >> 6) & 0x3,sb.adpcm.reference,sb.adpcm.stepsize);
-			MixTemp[done++]=decode_ADPCM_2_sample((sb.dma.buf.b8[i] >> 4) & 0x3,sb.adpcm.reference,sb.adpcm.stepsize);
-			MixTemp[done++]=decode_ADPCM_2_sample((sb.dma.buf.b8[i] >> 2) & 0x3,sb.adpcm.reference,sb.adpcm.stepsize);
-			MixTemp[done++]=decode_ADPCM_2_sample((sb.dma.buf.b8[i] >> 0) & 0x3,sb.adpcm.reference,sb.adpcm.stepsize);
-		}
+		done=decode_ADPCM_2_block(&sb.dma.buf.b8[i],read-i,MixTemp);
 		sb.chan->AddSamples_m8(done,MixTemp);
 		break;
 	case DSP_DMA_3:
@@ -455,11 +547,7 @@ static void GenerateDMASound(Bitu size) {
 			sb.adpcm.stepsize=MIN_ADAPTIVE_STEP_SIZE;
 			i++;
 		}
-		for (;i<read;i++) {
-			MixTemp[done++]=decode_ADPCM_3_sample((sb.dma.buf.b8[i] >> 5) & 0x7,sb.adpcm.reference,sb.adpcm.stepsize);
-			MixTemp[done++]=decode_ADPCM_3_sample((sb.dma.buf.b8[i] >> 2) & 0x7,sb.adpcm.reference,sb.adpcm.stepsize);
-			MixTemp[done++]=decode_ADPCM_3_sample((sb.dma.buf.b8[i] & 0x3) << 1,sb.adpcm.reference,sb.adpcm.stepsize);
-		}
+		done=decode_ADPCM_3_block(&sb.dma.buf.b8[i],read-i,MixTemp);
 		sb.chan->AddSamples_m8(done,MixTemp);
 		break;
 	case DSP_DMA_4:
@@ -470,61 +558,50 @@ static void GenerateDMASound(Bitu size) {
 			sb.adpcm.stepsize=MIN_ADAPTIVE_STEP_SIZE;
 			i++;
 		}
-		for (;i<read;i++) {
-			MixTemp[done++]=decode_ADPCM_4_sample(sb.dma.buf.b8[i] >> 4,sb.adpcm.reference,sb.adpcm.stepsize);
-			MixTemp[done++]=decode_ADPCM_4_sample(sb.dma.buf.b8[i]& 0xf,sb.adpcm.reference,sb.adpcm.stepsize);
-		}
+		done=decode_ADPCM_4_block(&sb.dma.buf.b8[i],read-i,MixTemp);
 		sb.chan->AddSamples_m8(done,MixTemp);
 		break;
 	case DSP_DMA_8:
-		if (sb.dma.stereo) {
-			read=sb.dma.chan->Read(size,&sb.dma.buf.b8[sb.dma.remain_size]);
-			Bitu total=read+sb.dma.remain_size;
-            if (!sb.dma.sign)  sb.chan->AddSamples_s8(total>>1,sb.dma.buf.b8);
-            else sb.chan->AddSamples_s8s(total>>1,(Bit8s*)sb.dma.buf.b8); 
-			if (total&1) {
-				sb.dma.remain_size=1;
-				sb.dma.buf.b8[0]=sb.dma.buf.b8[total-1];
-			} else sb.dma.remain_size=0;
-		} else {
-			read=sb.dma.chan->Read(size,sb.dma.buf.b8);
-			if (!sb.dma.sign) sb.chan->AddSamples_m8(read,sb.dma.buf.b8);
-			else sb.chan->AddSamples_m8s(read,(Bit8s *)sb.dma.buf.b8);
+	case DSP_DMA_16:
+		//The single cycle transfer of the controller ends at the terminal count
+		if (!sb.dma.chan->autoinit && size > (Bitu)sb.dma.chan->currcnt+1)
+			size = sb.dma.chan->currcnt+1;
+		//Whole sample frames go to the mixer straight from memory
+		if (!sb.dma.remain_size) read = SendDirectPCM(size);
+		if (read < size) {
+			Bitu more;
+			if (sb.dma.mode == DSP_DMA_8) more=sb.dma.chan->Read(size-read,&sb.dma.buf.b8[sb.dma.remain_size]);
+			else more=sb.dma.chan->Read(size-read,(Bit8u *)&sb.dma.buf.b16[sb.dma.remain_size]);
+			read+=more;
+			Bitu total=more+sb.dma.remain_size;
+			if (sb.dma.stereo) {
+				SendPCM(total>>1,sb.dma.buf.b8);
+				if (total&1) {
+					sb.dma.remain_size=1;
+					if (sb.dma.mode == DSP_DMA_8) sb.dma.buf.b8[0]=sb.dma.buf.b8[total-1];
+					else sb.dma.buf.b16[0]=sb.dma.buf.b16[total-1];
+				} else sb.dma.remain_size=0;
+			} else SendPCM(total,sb.dma.buf.b8);
 		}
 		break;
-	case DSP_DMA_16:
 	case DSP_DMA_16_ALIASED:
+		/* Temporarily divide by 2 to get number of 16-bit samples, because 8-bit
+		   DMA Read returns byte size, while in DSP_DMA_16 mode 16-bit DMA Read
+		   returns word size */
 		if (sb.dma.stereo) {
-			/* In DSP_DMA_16_ALIASED mode temporarily divide by 2 to get number of 16-bit
-			   samples, because 8-bit DMA Read returns byte size, while in DSP_DMA_16 mode
-			   16-bit DMA Read returns word size */
-			read=sb.dma.chan->Read(size,(Bit8u *)&sb.dma.buf.b16[sb.dma.remain_size]) 
-				>> (sb.dma.mode==DSP_DMA_16_ALIASED ? 1:0);
+			read=sb.dma.chan->Read(size,(Bit8u *)&sb.dma.buf.b16[sb.dma.remain_size]) >> 1;
 			Bitu total=read+sb.dma.remain_size;
-#if defined(WORDS_BIGENDIAN)
-			if (sb.dma.sign) sb.chan->AddSamples_s16_nonnative(total>>1,sb.dma.buf.b16);
-			else sb.chan->AddSamples_s16u_nonnative(total>>1,(Bit16u *)sb.dma.buf.b16);
-#else
-			if (sb.dma.sign) sb.chan->AddSamples_s16(total>>1,sb.dma.buf.b16);
-			else sb.chan->AddSamples_s16u(total>>1,(Bit16u *)sb.dma.buf.b16);
-#endif
+			SendPCM(total>>1,(Bit8u *)sb.dma.buf.b16);
 			if (total&1) {
 				sb.dma.remain_size=1;
 				sb.dma.buf.b16[0]=sb.dma.buf.b16[total-1];
 			} else sb.dma.remain_size=0;
 		} else {
-			read=sb.dma.chan->Read(size,(Bit8u *)sb.dma.buf.b16) 
-				>> (sb.dma.mode==DSP_DMA_16_ALIASED ? 1:0);
-#if defined(WORDS_BIGENDIAN)
-			if (sb.dma.sign) sb.chan->AddSamples_m16_nonnative(read,sb.dma.buf.b16);
-			else sb.chan->AddSamples_m16u_nonnative(read,(Bit16u *)sb.dma.buf.b16);
-#else
-			if (sb.dma.sign) sb.chan->AddSamples_m16(read,sb.dma.buf.b16);
-			else sb.chan->AddSamples_m16u(read,(Bit16u *)sb.dma.buf.b16);
-#endif
+			read=sb.dma.chan->Read(size,(Bit8u *)sb.dma.buf.b16) >> 1;
+			SendPCM(read,(Bit8u *)sb.dma.buf.b16);
 		}
 		//restore buffer length value to byte size in aliased mode
-		if (sb.dma.mode==DSP_DMA_16_ALIASED) read=read<<1;
+		read=read<<1;
 		break;
 	default:
 		LOG_MSG("Unhandled dma mode %d",sb.dma.mode);
@@ -75,6 +75,7 @@ static void SN76496Write(Bitu /*port*/,Bitu data,Bitu /*iolen*/) {
 		tandy.chan->Enable(true);
 		tandy.enabled=true;
 	}
+	tandy.chan->WakeUp();
 	device.write(data);
 
 //	LOG_MSG("3voice write %X at time %7.3f",data,PIC_FullIndex());
@@ -304,6 +305,7 @@ public:
 
 		Bit32u sample_rate = section->Get_int("tandyrate");
 		tandy.chan=MixerChan.Install(&SN76496Update,sample_rate,"TANDY");
+		tandy.chan->SetAutoSleep(true);
 
 		WriteHandler[0].Install(0xc0,SN76496Write,IO_MB,2);
 
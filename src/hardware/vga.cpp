@@ -18,7 +18,8 @@
 
 
 #include "dosbox.h"
-//#include "setup.h"
+#include "setup.h"
+#include "control.h"
 #include "video.h"
 #include "pic.h"
 #include "vga.h"
@@ -33,6 +34,7 @@ Bit32u CGA_4_Table[256];
 Bit32u CGA_4_HiRes_Table[256];
 Bit32u CGA_16_Table[256];
 Bit32u TXT_Font_Table[16];
+Bit64u TXT_Font_Table16[16];
 Bit32u TXT_FG_Table[16];
 Bit32u TXT_BG_Table[16];
 Bit32u ExpandTable[256];
@@ -176,8 +178,17 @@ void VGA_Init(Section* sec) {
 //	Section_prop * section=static_cast<Section_prop *>(sec);
 	vga.draw.resizing=false;
 	vga.mode=M_ERROR;			//For first init
+	Section_prop * render_sec=static_cast<Section_prop *>(control->GetSection("render"));
+	vga.draw.batch.enabled=render_sec->Get_bool("linebatch");
+	vga.draw.batch.active=false;
+	vga.draw.batch.quiet=0;
+	vga.draw.batch.changes=0;
+	vga.draw.batch.first=0;
 	SVGA_Setup_Driver();
 	VGA_SetupMemory(sec);
+#ifdef VGA_KEEP_CHANGES
+	vga.changes.enabled=render_sec->Get_bool("linechanges");
+#endif
 	VGA_SetupMisc();
 	VGA_SetupDAC();
 	VGA_SetupGFX();
@@ -221,6 +232,12 @@ void VGA_Init(Section* sec) {
 			((i & 8) ? 0x000000ff : 0) ;
 #endif
 	}
+	for (i=0;i<16;i++) {
+		/* Four 16bpp pixels, in memory order on either endianness */
+		Bit16u pixels[4];
+		for (j=0;j<4;j++) pixels[j]=(i & (8 >> j)) ? 0xffff : 0;
+		memcpy(&TXT_Font_Table16[i],pixels,sizeof(pixels));
+	}
 	for (j=0;j<4;j++) {
 		for (i=0;i<16;i++) {
 #ifdef WORDS_BIGENDIAN
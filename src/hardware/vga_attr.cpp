@@ -101,6 +101,7 @@ void write_p3c0(Bitu /*port*/,Bitu val,Bitu iolen) {
 	if (!vga.internal.attrindex) {
 		attr(index)=val & 0x1F;
 		vga.internal.attrindex=true;
+		if (((val & 0x20)!=0) == ((attr(disabled) & 1)!=0)) VGA_RasterChange();
 		if (val & 0x20) attr(disabled) &= ~1;
 		else attr(disabled) |= 1;
 		/* 
@@ -126,6 +127,7 @@ void write_p3c0(Bitu /*port*/,Bitu val,Bitu iolen) {
 		case 0x10: { /* Mode Control Register */
 			if (!IS_VGA_ARCH) val&=0x1f;	// not really correct, but should do it
 			Bitu difference = attr(mode_control)^val;
+			if (difference) VGA_RasterChange();
 			attr(mode_control)=(Bit8u)val;
 
 			if (difference & 0x80) {
@@ -55,6 +55,12 @@ static void VGA_DAC_SendColor( Bitu index, Bitu src ) {
 	const Bit8u red = vga.dac.rgb[src].red;
 	const Bit8u green = vga.dac.rgb[src].green;
 	const Bit8u blue = vga.dac.rgb[src].blue;
+	// the 8bpp output palette only changes between frames, the 16bpp lookup at once
+	if (vga.draw.bpp!=8) {
+		VGA_RasterChange();
+		// text glyphs are drawn with the lookup
+		vga.draw.font_gen++;
+	}
 	//Set entry in (little endian) 16bit output lookup table
 	var_write(&vga.dac.xlat16[index], ((blue>>1)&0x1f) | (((green)&0x3f)<<5) | (((red>>1)&0x1f) << 11));
 	
@@ -137,32 +137,30 @@ static Bit8u * VGA_Draw_4BPP_Line_Double(Bitu vidstart, Bitu line) {
 }
 
 #ifdef VGA_KEEP_CHANGES
-static Bit8u * VGA_Draw_Changes_Line(Bitu vidstart, Bitu line) {
-	Bitu checkMask = vga.changes.checkMask;
-	Bit8u *map = vga.changes.map;
-	Bitu start = (vidstart >> VGA_CHANGE_SHIFT);
-	Bitu end = ((vidstart + vga.draw.line_length ) >> VGA_CHANGE_SHIFT);
-	for (; start <= end;start++) {
-		if ( map[start] & checkMask ) {
-			Bitu offset = vidstart & vga.draw.linear_mask;
-			if (vga.draw.linear_mask-offset < vga.draw.line_length)
-				memcpy(vga.draw.linear_base+vga.draw.linear_mask+1, vga.draw.linear_base, vga.draw.line_length);
-			Bit8u *ret = &vga.draw.linear_base[ offset ];
-#if !defined(C_UNALIGNED_MEMORY)
-			if (GCC_UNLIKELY( ((Bitu)ret) & (sizeof(Bitu)-1)) ) {
-				memcpy( TempLine, ret, vga.draw.line_length );
-				return TempLine;
-			}
+#ifndef RENDER_NULL_INPUT
+#error "VGA_KEEP_CHANGES needs RENDER_NULL_INPUT to pass unchanged lines"
 #endif
-			return ret;
-		}
+/* Any write to the video memory the line is read from, since the last frame */
+static INLINE bool VGA_LineChanged(Bitu vidstart) {
+	Bitu start = vidstart & vga.draw.linear_mask;
+	Bitu end = start + vga.changes.span;
+	// the wrapped part could be a copy the writes don't mark
+	if (GCC_UNLIKELY(end > vga.draw.linear_mask)) return true;
+	const Bit8u *map = vga.changes.map;
+	for (start >>= VGA_CHANGE_SHIFT, end >>= VGA_CHANGE_SHIFT; start <= end; start++) {
+		if (map[start]) return true;
 	}
-//	memset( TempLine, 0x30, vga.changes.lineWidth );
-//	return TempLine;
-	return 0;
+	return false;
 }
+#endif
 
+/* NULL for a line the renderer already has */
+static INLINE Bit8u * VGA_DrawChangedLine(Bitu vidstart, Bitu line) {
+#ifdef VGA_KEEP_CHANGES
+	if (vga.changes.active && !VGA_LineChanged(vidstart)) return 0;
 #endif
+	return VGA_DrawLine(vidstart, line);
+}
 
 static Bit8u * VGA_Draw_Linear_Line(Bitu vidstart, Bitu /*line*/) {
 	Bitu offset = vidstart & vga.draw.linear_mask;
@@ -380,89 +378,244 @@ static const Bit8u* VGA_Text_Memwrap(Bitu vidstart) {
 }
 
 static Bit32u FontMask[2]={0xffffffff,0x0};
-static Bit8u * VGA_TEXT_Draw_Line(Bitu vidstart, Bitu line) {
-	Bits font_addr;
-	Bit32u * draw=(Bit32u *)TempLine;
+
+/* Text lines are put together from cached glyph rows. A glyph is keyed by
+   the character, its attribute and whether the blink phase or the cursor
+   show on it, and keeps each of its rows once drawn. Everything else a row
+   depends on is covered by vga.draw.font_gen, which is bumped when the font
+   or the 16bpp DAC lookup change and by TXT_CheckRegs. Every output line also
+   keeps the keys of its cells with its pixels, so only the cells whose key
+   changed are copied and a line without any is passed on as unchanged. */
+#define TXT_MAXCELLS	161		// 160 columns and the one panning shows a part of
+#define TXT_CELLBYTES	20		// 9 pixels at 16bpp, rounded up
+#define TXT_LINEPAD		32		// room in front of the cells for panning
+#define TXT_LINEBYTES	((TXT_LINEPAD + TXT_MAXCELLS * TXT_CELLBYTES + 15) & ~15)
+#define TXT_GLYPHS		1024
+#define TXT_KEY_BLINK	0x10000	// the blink phase hides the foreground
+#define TXT_KEY_CURSOR	0x20000	// the cursor shows on the cell
+
+typedef void (* TXT_Glyph_Handler)(Bit8u * row, Bit32u key, Bitu line);
+
+typedef struct {
+	Bit32u key;
+	Bit32u gen;
+	Bit32u drawn;			// a bit for every row in row
+	Bit32u row[32][TXT_CELLBYTES / 4];
+} TXT_Glyph;
+
+typedef struct {
+	Bit32u gen;
+	Bitu frame;				// the frame the line was last drawn in
+	Bitu line;
+	Bitu start;
+	Bitu blocks;
+	Bit32u blink;
+	Bitu cursor;
+} TXT_Line;
+
+static struct {
+	TXT_Glyph glyphs[TXT_GLYPHS];
+	Bitu lines;				// output lines the arrays below are allocated for
+	TXT_Line * line;
+	Bit8u * cells;			// the video memory of TXT_MAXCELLS for every line
+	Bit32u * keys;			// TXT_MAXCELLS for every line
+	Bit8u * pixels;			// TXT_LINEBYTES for every line
+	Bitu frame;				// counts the frames passed to the renderer
+	Bitu regs[9];
+} txt;
+
+/* The registers the glyph handlers read, a change redraws all glyphs */
+static INLINE void TXT_CheckRegs(TXT_Glyph_Handler handler) {
+	Bitu regs[9];
+	regs[0] = (Bitu)handler;
+	regs[1] = (Bitu)vga.draw.font_tables[0];
+	regs[2] = (Bitu)vga.draw.font_tables[1];
+	regs[3] = vga.draw.blinking;
+	regs[4] = vga.crtc.underline_location & 0x1f;
+	regs[5] = vga.attr.mode_control & 0x04;
+	regs[6] = vga.draw.char9dot;
+	regs[7] = vga.draw.cursor.sline;
+	regs[8] = vga.draw.cursor.eline;
+	if (GCC_UNLIKELY(memcmp(regs, txt.regs, sizeof(regs)))) {
+		memcpy(txt.regs, regs, sizeof(regs));
+		vga.draw.font_gen++;
+	}
+}
+
+static INLINE const Bit8u * TXT_GlyphRow(TXT_Glyph_Handler handler, Bit32u key, Bitu line) {
+	TXT_Glyph * glyph = &txt.glyphs[((Bit32u)(key * 2654435761U) >> 22) & (TXT_GLYPHS - 1)];
+	if (GCC_UNLIKELY(glyph->key != key || glyph->gen != vga.draw.font_gen)) {
+		glyph->key = key;
+		glyph->gen = vga.draw.font_gen;
+		glyph->drawn = 0;
+	}
+	Bit32u bit = 1U << line;
+	if (GCC_UNLIKELY(!(glyph->drawn & bit))) {
+		handler((Bit8u *)glyph->row[line], key, line);
+		glyph->drawn |= bit;
+	}
+	return (const Bit8u *)glyph->row[line];
+}
+
+/* The character and attribute of a cell, with blink when attribute bit 7 is set */
+static INLINE Bit32u TXT_Key(const Bit8u * cell, Bit32u blink) {
+	Bit32u key = cell[0] | (cell[1] << 8);
+	return key | (((key & 0x8000) << 1) & blink);
+}
+
+static bool TXT_HaveLine(Bitu y) {
+	if (GCC_LIKELY(y < txt.lines)) return true;
+	if (y >= SCALER_MAXHEIGHT) return false;
+	Bitu lines = vga.draw.lines_total > y ? vga.draw.lines_total : y + 1;
+	if (lines > SCALER_MAXHEIGHT) lines = SCALER_MAXHEIGHT;
+	delete[] txt.line;
+	delete[] txt.cells;
+	delete[] txt.keys;
+	delete[] txt.pixels;
+	txt.line = new TXT_Line[lines];
+	txt.cells = new Bit8u[lines * TXT_MAXCELLS * 2];
+	txt.keys = new Bit32u[lines * TXT_MAXCELLS];
+	txt.pixels = new Bit8u[lines * TXT_LINEBYTES];
+	// no blocks, so every line is drawn in full first
+	memset(txt.line, 0, lines * sizeof(TXT_Line));
+	txt.lines = lines;
+	return true;
+}
+
+/* Draws the cells of a text line from the glyph rows of handler, each
+   cellbytes wide and the first one at start. blink is added to the key of
+   the cells with attribute bit 7. NULL when the renderer has the same line
+   from the last frame. */
+static Bit8u * TXT_DrawCells(Bitu vidstart, Bitu line, Bitu blocks, Bitu start, Bitu cellbytes, Bit32u blink, TXT_Glyph_Handler handler) {
+	TXT_CheckRegs(handler);
 	const Bit8u* vidmem = VGA_Text_Memwrap(vidstart);
-	for (Bitu cx=0;cx<vga.draw.blocks;cx++) {
-		Bitu chr=vidmem[cx*2];
-		Bitu col=vidmem[cx*2+1];
+	Bitu cursor = ~(Bitu)0;
+	if (vga.draw.cursor.enabled && (vga.draw.cursor.count&0x10)) {
+		Bits cell = (vga.draw.cursor.address-vidstart) >> 1;
+		if (cell>=0 && cell<(Bits)vga.draw.blocks) cursor = (Bitu)cell;
+	}
+	Bitu y = vga.draw.lines_done;
+	// glyphs hold 32 rows, double scanning can address 64
+	if (GCC_UNLIKELY(blocks > TXT_MAXCELLS || line >= 32 || !TXT_HaveLine(y))) {
+		Bit32u row[TXT_CELLBYTES / 4];
+		Bit8u * draw = &TempLine[start];
+		for (Bitu cx=0;cx<blocks;cx++,draw+=cellbytes) {
+			Bit32u key = TXT_Key(&vidmem[cx*2], blink);
+			if (GCC_UNLIKELY(cx == cursor)) key |= TXT_KEY_CURSOR;
+			handler((Bit8u *)row, key, line);
+			memcpy(draw, row, cellbytes);
+		}
+		return &TempLine[TXT_LINEPAD];
+	}
+	TXT_Line * state = &txt.line[y];
+	Bit8u * cells = &txt.cells[y * TXT_MAXCELLS * 2];
+	Bit32u * keys = &txt.keys[y * TXT_MAXCELLS];
+	Bit8u * pixels = &txt.pixels[y * TXT_LINEBYTES];
+	bool changed = state->gen != vga.draw.font_gen || state->line != line ||
+		state->start != start || state->blocks != blocks;
+	if (changed) {
+		state->gen = vga.draw.font_gen;
+		state->line = line;
+		state->start = start;
+		state->blocks = blocks;
+		// no key matches, all cells are copied
+		memset(keys, 0xff, blocks * sizeof(Bit32u));
+	}
+	// the same memory with the same blink phase and cursor has the same keys
+	if (changed || state->blink != blink || state->cursor != cursor ||
+		memcmp(cells, vidmem, blocks * 2)) {
+		state->blink = blink;
+		state->cursor = cursor;
+		memcpy(cells, vidmem, blocks * 2);
+		Bit8u * draw = &pixels[start];
+		for (Bitu cx=0;cx<blocks;cx++,draw+=cellbytes) {
+			Bit32u key = TXT_Key(&vidmem[cx*2], blink);
+			if (GCC_UNLIKELY(cx == cursor)) key |= TXT_KEY_CURSOR;
+			if (GCC_LIKELY(key == keys[cx])) continue;
+			keys[cx] = key;
+			changed = true;
+			memcpy(draw, TXT_GlyphRow(handler, key, line), cellbytes);
+		}
+	}
+	Bitu last = state->frame;
+	state->frame = txt.frame;
+#ifdef VGA_KEEP_CHANGES
+	if (!changed && vga.changes.kept && last + 1 == txt.frame) return 0;
+#endif
+	return &pixels[TXT_LINEPAD];
+}
+
+static void TXT_Glyph_8(Bit8u * row, Bit32u key, Bitu line) {
+	Bitu chr = key & 0xff;
+	Bitu col = (key >> 8) & 0xff;
+	Bit32u pixels[2];
+	if ((key & TXT_KEY_CURSOR) && line>=vga.draw.cursor.sline && line<=vga.draw.cursor.eline) {
+		pixels[0] = pixels[1] = TXT_FG_Table[col&0xf];
+	} else {
 		Bitu font=vga.draw.font_tables[(col >> 3)&1][chr*32+line];
-		Bit32u mask1=TXT_Font_Table[font>>4] & FontMask[col >> 7];
-		Bit32u mask2=TXT_Font_Table[font&0xf] & FontMask[col >> 7];
+		Bit32u blink = (key & TXT_KEY_BLINK) ? 0 : 0xffffffff;
+		Bit32u mask1=TXT_Font_Table[font>>4] & blink;
+		Bit32u mask2=TXT_Font_Table[font&0xf] & blink;
 		Bit32u fg=TXT_FG_Table[col&0xf];
 		Bit32u bg=TXT_BG_Table[col>>4];
-		*draw++=(fg&mask1) | (bg&~mask1);
-		*draw++=(fg&mask2) | (bg&~mask2);
-	}
-	if (!vga.draw.cursor.enabled || !(vga.draw.cursor.count&0x10)) goto skip_cursor;
-	font_addr = (vga.draw.cursor.address-vidstart) >> 1;
-	if (font_addr>=0 && font_addr<(Bits)vga.draw.blocks) {
-		if (line<vga.draw.cursor.sline) goto skip_cursor;
-		if (line>vga.draw.cursor.eline) goto skip_cursor;
-		draw=(Bit32u *)&TempLine[font_addr*8];
-		Bit32u att=TXT_FG_Table[vga.tandy.draw_base[vga.draw.cursor.address+1]&0xf];
-		*draw++=att;*draw++=att;
+		pixels[0]=(fg&mask1) | (bg&~mask1);
+		pixels[1]=(fg&mask2) | (bg&~mask2);
 	}
-skip_cursor:
-	return TempLine;
+	memcpy(row, pixels, sizeof(pixels));
 }
 
-static Bit8u * VGA_TEXT_Herc_Draw_Line(Bitu vidstart, Bitu line) {
-	Bits font_addr;
-	Bit32u * draw=(Bit32u *)TempLine;
-	const Bit8u* vidmem = VGA_Text_Memwrap(vidstart);
+static Bit8u * VGA_TEXT_Draw_Line(Bitu vidstart, Bitu line) {
+	Bit32u blink = FontMask[1] ? 0 : TXT_KEY_BLINK;
+	return TXT_DrawCells(vidstart, line, vga.draw.blocks, TXT_LINEPAD, 8, blink, TXT_Glyph_8);
+}
 
-	for (Bitu cx=0;cx<vga.draw.blocks;cx++) {
-		Bitu chr=vidmem[cx*2];
-		Bitu attrib=vidmem[cx*2+1];
-		if (!(attrib&0x77)) {
-			// 00h, 80h, 08h, 88h produce black space
-			*draw++=0;
-			*draw++=0;
-		} else {
-			Bit32u bg, fg;
-			bool underline=false;
-			if ((attrib&0x77)==0x70) {
-				bg = TXT_BG_Table[0x7];
-				if (attrib&0x8) fg = TXT_FG_Table[0xf];
-				else fg = TXT_FG_Table[0x0];
-			} else {
-				if (((Bitu)(vga.crtc.underline_location&0x1f)==line) && ((attrib&0x77)==0x1)) underline=true;
-				bg = TXT_BG_Table[0x0];
-				if (attrib&0x8) fg = TXT_FG_Table[0xf];
-				else fg = TXT_FG_Table[0x7];
-			}
-			Bit32u mask1, mask2;
-			if (GCC_UNLIKELY(underline)) mask1 = mask2 = FontMask[attrib >> 7];
-			else {
-				Bitu font=vga.draw.font_tables[0][chr*32+line];
-				mask1=TXT_Font_Table[font>>4] & FontMask[attrib >> 7]; // blinking
-				mask2=TXT_Font_Table[font&0xf] & FontMask[attrib >> 7];
-			}
-			*draw++=(fg&mask1) | (bg&~mask1);
-			*draw++=(fg&mask2) | (bg&~mask2);
-		}
-	}
-	if (!vga.draw.cursor.enabled || !(vga.draw.cursor.count&0x10)) goto skip_cursor;
-	font_addr = (vga.draw.cursor.address-vidstart) >> 1;
-	if (font_addr>=0 && font_addr<(Bits)vga.draw.blocks) {
-		if (line<vga.draw.cursor.sline) goto skip_cursor;
-		if (line>vga.draw.cursor.eline) goto skip_cursor;
-		draw=(Bit32u *)&TempLine[font_addr*8];
-		Bit8u attr = vga.tandy.draw_base[vga.draw.cursor.address+1];
+static void TXT_Glyph_Herc(Bit8u * row, Bit32u key, Bitu line) {
+	Bitu chr = key & 0xff;
+	Bitu attrib = (key >> 8) & 0xff;
+	Bit32u pixels[2];
+	if ((key & TXT_KEY_CURSOR) && line>=vga.draw.cursor.sline && line<=vga.draw.cursor.eline) {
 		Bit32u cg;
-		if (attr&0x8) {
+		if (attrib&0x8) {
 			cg = TXT_FG_Table[0xf];
-		} else if ((attr&0x77)==0x70) {
+		} else if ((attrib&0x77)==0x70) {
 			cg = TXT_FG_Table[0x0];
 		} else {
 			cg = TXT_FG_Table[0x7];
 		}
-		*draw++=cg;*draw++=cg;
+		pixels[0] = pixels[1] = cg;
+	} else if (!(attrib&0x77)) {
+		// 00h, 80h, 08h, 88h produce black space
+		pixels[0] = pixels[1] = 0;
+	} else {
+		Bit32u bg, fg;
+		bool underline=false;
+		if ((attrib&0x77)==0x70) {
+			bg = TXT_BG_Table[0x7];
+			if (attrib&0x8) fg = TXT_FG_Table[0xf];
+			else fg = TXT_FG_Table[0x0];
+		} else {
+			if (((Bitu)(vga.crtc.underline_location&0x1f)==line) && ((attrib&0x77)==0x1)) underline=true;
+			bg = TXT_BG_Table[0x0];
+			if (attrib&0x8) fg = TXT_FG_Table[0xf];
+			else fg = TXT_FG_Table[0x7];
+		}
+		Bit32u blink = (key & TXT_KEY_BLINK) ? 0 : 0xffffffff;
+		Bit32u mask1, mask2;
+		if (GCC_UNLIKELY(underline)) mask1 = mask2 = blink;
+		else {
+			Bitu font=vga.draw.font_tables[0][chr*32+line];
+			mask1=TXT_Font_Table[font>>4] & blink;
+			mask2=TXT_Font_Table[font&0xf] & blink;
+		}
+		pixels[0]=(fg&mask1) | (bg&~mask1);
+		pixels[1]=(fg&mask2) | (bg&~mask2);
 	}
-skip_cursor:
-	return TempLine;
+	memcpy(row, pixels, sizeof(pixels));
+}
+
+static Bit8u * VGA_TEXT_Herc_Draw_Line(Bitu vidstart, Bitu line) {
+	Bit32u blink = FontMask[1] ? 0 : TXT_KEY_BLINK;
+	return TXT_DrawCells(vidstart, line, vga.draw.blocks, TXT_LINEPAD, 8, blink, TXT_Glyph_Herc);
 }
 /*
 // combined 8/9-dot wide text mode 8bpp line drawing function
@@ -523,80 +676,59 @@ static Bit8u* VGA_TEXT_Draw_Line(Bitu vidstart, Bitu line) {
 	return TempLine+16;
 }
 */
-// combined 8/9-dot wide text mode 16bpp line drawing function
-static Bit8u* VGA_TEXT_Xlat16_Draw_Line(Bitu vidstart, Bitu line) {
-	// keep it aligned:
-	Bit16u* draw = ((Bit16u*)TempLine) + 16 - vga.draw.panning;
-	const Bit8u* vidmem = VGA_Text_Memwrap(vidstart); // pointer to chars+attribs
-	Bitu blocks = vga.draw.blocks;
-	if (vga.draw.panning) blocks++; // if the text is panned part of an 
-									// additional character becomes visible
-	while (blocks--) { // for each character in the line
-		Bitu chr = *vidmem++;
-		Bitu attr = *vidmem++;
-		// the font pattern
-		Bitu font = vga.draw.font_tables[(attr >> 3)&1][(chr<<5)+line];
-		
-		Bitu background = attr >> 4;
-		// if blinking is enabled bit7 is not mapped to attributes
-		if (vga.draw.blinking) background &= ~0x8;
-		// choose foreground color if blinking not set for this cell or blink on
-		Bitu foreground = (vga.draw.blink || (!(attr&0x80)))?
-			(attr&0xf):background;
-		// underline: all foreground [freevga: 0x77, previous 0x7]
-		if (GCC_UNLIKELY(((attr&0x77) == 0x01) &&
-			(vga.crtc.underline_location&0x1f)==line))
-				background = foreground;
-		if (vga.draw.char9dot) {
-			font <<=1; // 9 pixels
-			// extend to the 9th pixel if needed
-			if ((font&0x2) && (vga.attr.mode_control&0x04) &&
-				(chr>=0xc0) && (chr<=0xdf)) font |= 1;
-			for (Bitu n = 0; n < 9; n++) {
-				*draw++ = vga.dac.xlat16[(font&0x100)? foreground:background];
-				font <<= 1;
-			}
-		} else {
-			for (Bitu n = 0; n < 8; n++) {
-				*draw++ = vga.dac.xlat16[(font&0x80)? foreground:background];
-				font <<= 1;
-			}
-		}
+/* A cell row at 16bpp is two masked stores of its colors */
+static INLINE Bit64u TXT_Color16(Bitu index) {
+	return (Bit64u)vga.dac.xlat16[index] * (Bit64u)0x0001000100010001ULL;
+}
+static INLINE void TXT_Row16(Bit16u * draw,Bitu font,Bit64u fg,Bit64u bg) {
+	Bit64u mask1 = TXT_Font_Table16[font >> 4];
+	Bit64u mask2 = TXT_Font_Table16[font & 0xf];
+	Bit64u pixels[2] = { (fg & mask1) | (bg & ~mask1), (fg & mask2) | (bg & ~mask2) };
+	memcpy(draw,pixels,sizeof(pixels));
+}
+
+// combined 8/9-dot wide text mode 16bpp glyph row
+static void TXT_Glyph_Xlat16(Bit8u * row, Bit32u key, Bitu line) {
+	Bit16u* draw = (Bit16u*)row;
+	Bitu chr = key & 0xff;
+	Bitu attr = (key >> 8) & 0xff;
+	// the font pattern
+	Bitu font = vga.draw.font_tables[(attr >> 3)&1][(chr<<5)+line];
+
+	Bitu background = attr >> 4;
+	// if blinking is enabled bit7 is not mapped to attributes
+	if (vga.draw.blinking) background &= ~0x8;
+	// choose foreground color if blinking not set for this cell or blink on
+	Bitu foreground = (key & TXT_KEY_BLINK) ? background : (attr&0xf);
+	// underline: all foreground [freevga: 0x77, previous 0x7]
+	if (GCC_UNLIKELY(((attr&0x77) == 0x01) &&
+		(vga.crtc.underline_location&0x1f)==line))
+			background = foreground;
+	TXT_Row16(draw,font,TXT_Color16(foreground),TXT_Color16(background));
+	if (vga.draw.char9dot) {
+		// extend to the 9th pixel if needed
+		if ((font&0x1) && (vga.attr.mode_control&0x04) &&
+			(chr>=0xc0) && (chr<=0xdf)) draw[8] = vga.dac.xlat16[foreground];
+		else draw[8] = vga.dac.xlat16[background];
 	}
-	// draw the text mode cursor if needed
-	if ((vga.draw.cursor.count&0x10) && (line >= vga.draw.cursor.sline) &&
-		(line <= vga.draw.cursor.eline) && vga.draw.cursor.enabled) {
-		// the adress of the attribute that makes up the cell the cursor is in
-		Bits attr_addr = (vga.draw.cursor.address-vidstart) >> 1;
-		if (attr_addr >= 0 && attr_addr < (Bits)vga.draw.blocks) {
-			Bitu index = attr_addr * (vga.draw.char9dot? 18:16);
-			draw = (Bit16u*)(&TempLine[index]) + 16 - vga.draw.panning;
-			
-			Bitu foreground = vga.tandy.draw_base[vga.draw.cursor.address+1] & 0xf;
-			for (Bitu i = 0; i < 8; i++) {
-				*draw++ = vga.dac.xlat16[foreground];
-			}
+	// the text mode cursor covers the first 8 pixels
+	if ((key & TXT_KEY_CURSOR) && (line >= vga.draw.cursor.sline) &&
+		(line <= vga.draw.cursor.eline)) {
+		for (Bitu i = 0; i < 8; i++) {
+			draw[i] = vga.dac.xlat16[attr & 0xf];
 		}
 	}
-	return TempLine+32;
 }
 
-#ifdef VGA_KEEP_CHANGES
-static INLINE void VGA_ChangesEnd(void ) {
-	if ( vga.changes.active ) {
-//		vga.changes.active = false;
-		Bitu end = vga.draw.address >> VGA_CHANGE_SHIFT;
-		Bitu total = 4 + end - vga.changes.start;
-		Bit32u clearMask = vga.changes.clearMask;
-		total >>= 2;
-		Bit32u *clear = (Bit32u *)&vga.changes.map[  vga.changes.start & ~3 ];
-		while ( total-- ) {
-			clear[0] &= clearMask;
-			clear++;
-		}
-	}
+static Bit8u* VGA_TEXT_Xlat16_Draw_Line(Bitu vidstart, Bitu line) {
+	Bitu blocks = vga.draw.blocks;
+	if (vga.draw.panning) blocks++; // if the text is panned part of an 
+									// additional character becomes visible
+	// the foreground of blinking cells shows while blink is set
+	Bit32u blink = vga.draw.blink ? 0 : TXT_KEY_BLINK;
+	return TXT_DrawCells(vidstart, line, blocks, TXT_LINEPAD - vga.draw.panning * 2,
+		vga.draw.char9dot ? 18 : 16, blink, TXT_Glyph_Xlat16);
 }
-#endif
 
 
 static void VGA_ProcessSplit() {
@@ -616,7 +748,7 @@ static void VGA_ProcessSplit() {
 }
 
 static Bit8u bg_color_index = 0; // screen-off black index
-static void VGA_DrawSingleLine(Bitu /*blah*/) {
+static void VGA_SingleLine(void) {
 	if (GCC_UNLIKELY(vga.attr.disabled)) {
 		switch(machine) {
 		case MCH_PCJR:
@@ -671,7 +803,7 @@ static void VGA_DrawSingleLine(Bitu /*blah*/) {
 		}
 		RENDER_DrawLine(TempLine);
 	} else {
-		Bit8u * data=VGA_DrawLine( vga.draw.address, vga.draw.address_line );	
+		Bit8u * data=VGA_DrawChangedLine( vga.draw.address, vga.draw.address_line );	
 		RENDER_DrawLine(data);
 	}
 
@@ -682,19 +814,23 @@ static void VGA_DrawSingleLine(Bitu /*blah*/) {
 	}
 	vga.draw.lines_done++;
 	if (vga.draw.split_line==vga.draw.lines_done) VGA_ProcessSplit();
+}
+
+static void VGA_DrawSingleLine(Bitu /*blah*/) {
+	VGA_SingleLine();
 	if (vga.draw.lines_done < vga.draw.lines_total) {
 		PIC_AddEvent(VGA_DrawSingleLine,(float)vga.draw.delay.htotal);
 	} else RENDER_EndUpdate(false);
 }
 
-static void VGA_DrawEGASingleLine(Bitu /*blah*/) {
+static void VGA_EGASingleLine(void) {
 	if (GCC_UNLIKELY(vga.attr.disabled)) {
 		memset(TempLine, 0, sizeof(TempLine));
 		RENDER_DrawLine(TempLine);
 	} else {
 		Bitu address = vga.draw.address;
 		if (vga.mode!=M_TEXT) address += vga.draw.panning;
-		Bit8u * data=VGA_DrawLine(address, vga.draw.address_line );	
+		Bit8u * data=VGA_DrawChangedLine(address, vga.draw.address_line );	
 		RENDER_DrawLine(data);
 	}
 
@@ -705,14 +841,64 @@ static void VGA_DrawEGASingleLine(Bitu /*blah*/) {
 	}
 	vga.draw.lines_done++;
 	if (vga.draw.split_line==vga.draw.lines_done) VGA_ProcessSplit();
+}
+
+static void VGA_DrawEGASingleLine(Bitu /*blah*/) {
+	VGA_EGASingleLine();
 	if (vga.draw.lines_done < vga.draw.lines_total) {
 		PIC_AddEvent(VGA_DrawEGASingleLine,(float)vga.draw.delay.htotal);
 	} else RENDER_EndUpdate(false);
 }
 
+/* Line batching: frames without raster effects are drawn in one go when the
+   last line is displayed, instead of with an event for every line. Register
+   writes that change the picture call VGA_RasterChange. When one happens
+   while a batched frame is displayed, the lines the beam has passed are drawn
+   with the old state and the rest of that frame goes line by line. Frames
+   are only batched again after VGA_BATCH_QUIET frames without such writes. */
+#define VGA_BATCH_QUIET 30
+
+static void VGA_DrawLines(Bitu lines) {
+	if (vga.draw.mode==EGALINE) {
+		while (vga.draw.lines_done < lines) VGA_EGASingleLine();
+	} else {
+		while (vga.draw.lines_done < lines) VGA_SingleLine();
+	}
+}
+
+static void VGA_DrawBatch(Bitu /*val*/) {
+	vga.draw.batch.active = false;
+	VGA_DrawLines(vga.draw.lines_total);
+	RENDER_EndUpdate(false);
+}
+
+void VGA_RasterChange(void) {
+#ifdef VGA_KEEP_CHANGES
+	// the rest of this frame and the next one can't skip lines
+	vga.changes.active = false;
+	vga.changes.full = true;
+#endif
+	if (!vga.draw.batch.enabled) return;
+	double elapsed = PIC_FullIndex() - vga.draw.delay.framestart;
+	if (elapsed < vga.draw.batch.first ||
+		elapsed >= vga.draw.batch.first + vga.draw.delay.htotal * vga.draw.lines_total) return;
+	vga.draw.batch.changes++;
+	if (!vga.draw.batch.active) return;
+	vga.draw.batch.active = false;
+	PIC_RemoveEvents(VGA_DrawBatch);
+	Bitu lines = (Bitu)((elapsed - vga.draw.batch.first) / vga.draw.delay.htotal) + 1;
+	if (lines > vga.draw.lines_total) lines = vga.draw.lines_total;
+	VGA_DrawLines(lines);
+	if (vga.draw.lines_done < vga.draw.lines_total) {
+		float next = (float)(vga.draw.batch.first + vga.draw.delay.htotal * vga.draw.lines_done - elapsed);
+		if (vga.draw.mode==EGALINE) PIC_AddEvent(VGA_DrawEGASingleLine,next);
+		else PIC_AddEvent(VGA_DrawSingleLine,next);
+	} else RENDER_EndUpdate(false);
+}
+
 static void VGA_DrawPart(Bitu lines) {
 	while (lines--) {
-		Bit8u * data=VGA_DrawLine( vga.draw.address, vga.draw.address_line );
+		Bit8u * data=VGA_DrawChangedLine( vga.draw.address, vga.draw.address_line );
 		RENDER_DrawLine(data);
 		vga.draw.address_line++;
 		if (vga.draw.address_line>=vga.draw.address_line_total) {
@@ -720,23 +906,12 @@ static void VGA_DrawPart(Bitu lines) {
 			vga.draw.address+=vga.draw.address_add;
 		}
 		vga.draw.lines_done++;
-		if (vga.draw.split_line==vga.draw.lines_done) {
-#ifdef VGA_KEEP_CHANGES
-			VGA_ChangesEnd( );
-#endif
-			VGA_ProcessSplit();
-#ifdef VGA_KEEP_CHANGES
-			vga.changes.start = vga.draw.address >> VGA_CHANGE_SHIFT;
-#endif
-		}
+		if (vga.draw.split_line==vga.draw.lines_done) VGA_ProcessSplit();
 	}
 	if (--vga.draw.parts_left) {
 		PIC_AddEvent(VGA_DrawPart,(float)vga.draw.delay.parts,
 			 (vga.draw.parts_left!=1) ? vga.draw.parts_lines  : (vga.draw.lines_total - vga.draw.lines_done));
 	} else {
-#ifdef VGA_KEEP_CHANGES
-		VGA_ChangesEnd();
-#endif
 		RENDER_EndUpdate(false);
 	}
 }
@@ -757,25 +932,71 @@ void VGA_SetBlinking(Bitu enabled) {
 }
 
 #ifdef VGA_KEEP_CHANGES
-static void INLINE VGA_ChangesStart( void ) {
-	vga.changes.start = vga.draw.address >> VGA_CHANGE_SHIFT;
-	vga.changes.last = vga.changes.start;
-	if ( vga.changes.lastAddress != vga.draw.address ) {
-//		LOG_MSG("Address");
-		VGA_DrawLine = VGA_Draw_Linear_Line;
-		vga.changes.lastAddress = vga.draw.address;
-	} else if ( render.fullFrame ) {
-//		LOG_MSG("Full Frame");
-		VGA_DrawLine = VGA_Draw_Linear_Line;
-	} else {
-//		LOG_MSG("Changes");
-		VGA_DrawLine = VGA_Draw_Changes_Line;
+/* Whether the memory handler of the mode marks its writes, see VGA_SetupHandlers */
+static bool VGA_ChangesTracked(void) {
+	if (!IS_EGAVGA_ARCH) return false;
+	// writes through the linear framebuffer are not marked
+	if ((svgaCard==SVGA_S3Trio) && (vga.s3.reg_58 & 0x10)) return false;
+	if ((VGA_DrawLine==VGA_Draw_VGA_Line_HWMouse) || (VGA_DrawLine==VGA_Draw_LIN16_Line_HWMouse) ||
+		(VGA_DrawLine==VGA_Draw_LIN32_Line_HWMouse)) return false;
+	switch (vga.mode) {
+	case M_EGA:
+	case M_LIN4:
+		return true;
+	case M_VGA:
+	case M_LIN8:
+		if (vga.config.chained && !vga.config.compatible_chain4) break;
+		return true;
+	case M_LIN15:
+	case M_LIN16:
+	case M_LIN32:
+		break;
+	case M_TEXT:
+		// text lines compare their cells instead, see TXT_DrawCells
+	default:
+		return false;
+	}
+#ifdef VGA_LFB_MAPPED
+	return false;
+#else
+	return true;
+#endif
+}
+
+/* Writes are marked with two alternating bits, each covering the time from
+   the start of one frame to the start of the next. A line is redrawn when
+   either is set: the writes since the last frame and those made while this
+   one is drawn. Once a frame completed the bit from before it is cleared. */
+static void VGA_ChangesStart( void ) {
+	bool complete = !vga.changes.drawing || (vga.draw.lines_done >= vga.draw.lines_total);
+	if (complete) {
+		Bit32u keep = vga.changes.writeMask * 0x01010101;
+		Bit32u *map = (Bit32u *)vga.changes.map;
+		for (Bitu i = vga.changes.mapSize / 4;i > 0;i--) *map++ &= keep;
 	}
-	vga.changes.active = true;
-	vga.changes.checkMask = vga.changes.writeMask;
-	vga.changes.clearMask = ~( 0x01010101 << (vga.changes.frame & 7));
-	vga.changes.frame++;
-	vga.changes.writeMask = 1 << (vga.changes.frame & 7);
+	vga.changes.writeMask ^= 3;
+	vga.changes.drawing = true;
+
+	Bitu layout[16];
+	memset(layout, 0, sizeof(layout));
+	layout[0] = vga.mode;
+	layout[1] = vga.draw.address;
+	layout[2] = vga.draw.address_add;
+	layout[3] = vga.draw.address_line;
+	layout[4] = vga.draw.address_line_total;
+	layout[5] = vga.draw.split_line;
+	layout[6] = vga.draw.panning;
+	layout[7] = vga.draw.linear_mask;
+	layout[8] = (Bitu)vga.draw.linear_base;
+	layout[9] = vga.draw.line_length;
+	layout[10] = (Bitu)VGA_DrawLine;
+	vga.changes.span = vga.draw.line_length;
+	bool same = !memcmp(layout, vga.changes.layout, sizeof(layout));
+	if (!same) memcpy(vga.changes.layout, layout, sizeof(layout));
+
+	vga.changes.kept = vga.changes.enabled && complete && !vga.changes.full && !render.fullFrame;
+	vga.changes.active = vga.changes.kept && same && VGA_ChangesTracked();
+	vga.changes.full = false;
 }
 #endif
 
@@ -803,6 +1024,11 @@ static void VGA_PanningLatch(Bitu /*val*/) {
 static void VGA_VerticalTimer(Bitu /*val*/) {
 	vga.draw.delay.framestart = PIC_FullIndex();
 	PIC_AddEvent( VGA_VerticalTimer, (float)vga.draw.delay.vtotal );
+
+	if (vga.draw.batch.changes) vga.draw.batch.quiet = 0;
+	else if (vga.draw.batch.quiet < VGA_BATCH_QUIET) vga.draw.batch.quiet++;
+	vga.draw.batch.changes = 0;
+	vga.draw.batch.first = vga.draw.delay.htotal/4.0 + vga.draw.delay.htotal * vga.draw.vblank_skip;
 	
 	switch(machine) {
 	case MCH_PCJR:
@@ -857,9 +1083,6 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 		vga.draw.split_line++; // EGA adds one buggy scanline
 	}
 //	if (machine==MCH_EGA) vga.draw.split_line = ((((vga.config.line_compare&0x5ff)+1)*2-1)/vga.draw.lines_scaled);
-#ifdef VGA_KEEP_CHANGES
-	bool startaddr_changed=false;
-#endif
 	switch (vga.mode) {
 	case M_EGA:
 		if (!(vga.crtc.mode_control&0x1)) vga.draw.linear_mask &= ~0x10000;
@@ -869,9 +1092,6 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 		vga.draw.address += vga.draw.bytes_skip;
 		vga.draw.address *= vga.draw.byte_panning_shift;
 		if (machine!=MCH_EGA) vga.draw.address += vga.draw.panning;
-#ifdef VGA_KEEP_CHANGES
-		startaddr_changed=true;
-#endif
 		break;
 	case M_VGA:
 		if (vga.config.compatible_chain4 && (vga.crtc.underline_location & 0x40)) {
@@ -889,9 +1109,6 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 		vga.draw.address += vga.draw.bytes_skip;
 		vga.draw.address *= vga.draw.byte_panning_shift;
 		vga.draw.address += vga.draw.panning;
-#ifdef VGA_KEEP_CHANGES
-		startaddr_changed=true;
-#endif
 		break;
 	case M_TEXT:
 		vga.draw.byte_panning_shift = 2;
@@ -925,8 +1142,9 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 		break;
 	}
 	if (GCC_UNLIKELY(vga.draw.split_line==0)) VGA_ProcessSplit();
+	txt.frame++;
 #ifdef VGA_KEEP_CHANGES
-	if (startaddr_changed) VGA_ChangesStart();
+	VGA_ChangesStart();
 #endif
 
 	// check if some lines at the top off the screen are blanked
@@ -955,10 +1173,14 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 				vga.draw.lines_total-vga.draw.lines_done);
 			if (vga.draw.mode==EGALINE) PIC_RemoveEvents(VGA_DrawEGASingleLine);
 			else PIC_RemoveEvents(VGA_DrawSingleLine);
+			PIC_RemoveEvents(VGA_DrawBatch);
 			RENDER_EndUpdate(true);
 		}
 		vga.draw.lines_done = 0;
-		if (vga.draw.mode==EGALINE)
+		vga.draw.batch.active = vga.draw.batch.enabled && (vga.draw.batch.quiet >= VGA_BATCH_QUIET);
+		if (vga.draw.batch.active)
+			PIC_AddEvent(VGA_DrawBatch,(float)(vga.draw.batch.first + vga.draw.delay.htotal * (vga.draw.lines_total - 1)));
+		else if (vga.draw.mode==EGALINE)
 			PIC_AddEvent(VGA_DrawEGASingleLine,(float)(vga.draw.delay.htotal/4.0 + draw_skip));
 		else PIC_AddEvent(VGA_DrawSingleLine,(float)(vga.draw.delay.htotal/4.0 + draw_skip));
 		break;
@@ -966,6 +1188,7 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 }
 
 void VGA_CheckScanLength(void) {
+	VGA_RasterChange();
 	switch (vga.mode) {
 	case M_EGA:
 	case M_LIN4:
@@ -1545,8 +1768,7 @@ void VGA_SetupDrawing(Bitu /*val*/) {
 	vga.draw.line_length = width * ((bpp + 1) / 8);
 #ifdef VGA_KEEP_CHANGES
 	vga.changes.active = false;
-	vga.changes.frame = 0;
-	vga.changes.writeMask = 1;
+	vga.changes.full = true;
 #endif
 	/*
 	   Cheap hack to just make all > 640x480 modes have square pixels
@@ -1613,6 +1835,8 @@ void VGA_KillDrawing(void) {
 	PIC_RemoveEvents(VGA_DrawPart);
 	PIC_RemoveEvents(VGA_DrawSingleLine);
 	PIC_RemoveEvents(VGA_DrawEGASingleLine);
+	PIC_RemoveEvents(VGA_DrawBatch);
+	vga.draw.batch.active = false;
 	vga.draw.parts_left = 0;
 	vga.draw.lines_done = ~0;
 	if (!vga.draw.vga_override) RENDER_EndUpdate(true);
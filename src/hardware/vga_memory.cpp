@@ -215,14 +215,15 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr << 3);
+		MEM_CHANGED( (addr >> 2) << 3);
 		writeHandler(addr+0,(Bit8u)(val >> 0));
 	}
 	void writew(PhysPt addr,Bitu val) {
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr << 3);
+		MEM_CHANGED( (addr >> 2) << 3);
+		MEM_CHANGED( ((addr+1) >> 2) << 3);
 		writeHandler(addr+0,(Bit8u)(val >> 0));
 		writeHandler(addr+1,(Bit8u)(val >> 8));
 	}
@@ -230,7 +231,8 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr << 3);
+		MEM_CHANGED( (addr >> 2) << 3);
+		MEM_CHANGED( ((addr+3) >> 2) << 3);
 		writeHandler(addr+0,(Bit8u)(val >> 0));
 		writeHandler(addr+1,(Bit8u)(val >> 8));
 		writeHandler(addr+2,(Bit8u)(val >> 16));
@@ -307,6 +309,7 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
 		MEM_CHANGED( addr << 3);
+		MEM_CHANGED( (addr+1) << 3 );
 		writeHandler<true>(addr+0,(Bit8u)(val >> 0));
 		writeHandler<true>(addr+1,(Bit8u)(val >> 8));
 	}
@@ -315,6 +318,7 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
 		MEM_CHANGED( addr << 3);
+		MEM_CHANGED( (addr+3) << 3 );
 		writeHandler<true>(addr+0,(Bit8u)(val >> 0));
 		writeHandler<true>(addr+1,(Bit8u)(val >> 8));
 		writeHandler<true>(addr+2,(Bit8u)(val >> 16));
@@ -345,6 +349,11 @@ public:
 		// No need to check for compatible chains here, this one is only enabled if that bit is set
 		hostWrite<Size>( &vga.mem.linear[((addr&~3)<<2)+(addr&3)], val );
 	}
+	static INLINE void changed(PhysPt addr) {
+		// Either the pixel buffer or the planes are displayed
+		MEM_CHANGED( addr );
+		MEM_CHANGED( ((addr&~3)<<2)+(addr&3) );
+	}
 	Bitu readb(PhysPt addr ) {
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_read_full;
@@ -379,7 +388,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr );
+		changed( addr );
 		writeHandler<Bit8u>( addr, val );
 		writeCache<Bit8u>( addr, val );
 	}
@@ -387,8 +396,8 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr );
-//		MEM_CHANGED( addr + 1);
+		changed( addr );
+		changed( addr + 1 );
 		if (GCC_UNLIKELY(addr & 1)) {
 			writeHandler<Bit8u>( addr+0, val >> 0 );
 			writeHandler<Bit8u>( addr+1, val >> 8 );
@@ -401,8 +410,8 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr );
-//		MEM_CHANGED( addr + 3);
+		changed( addr );
+		changed( addr + 3 );
 		if (GCC_UNLIKELY(addr & 3)) {
 			writeHandler<Bit8u>( addr+0, val >> 0 );
 			writeHandler<Bit8u>( addr+1, val >> 8 );
@@ -443,6 +452,7 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
 		MEM_CHANGED( addr << 2);
+		MEM_CHANGED( (addr+1) << 2 );
 		writeHandler(addr+0,(Bit8u)(val >> 0));
 		writeHandler(addr+1,(Bit8u)(val >> 8));
 	}
@@ -451,6 +461,7 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
 		MEM_CHANGED( addr << 2);
+		MEM_CHANGED( (addr+3) << 2 );
 		writeHandler(addr+0,(Bit8u)(val >> 0));
 		writeHandler(addr+1,(Bit8u)(val >> 8));
 		writeHandler(addr+2,(Bit8u)(val >> 16));
@@ -480,14 +491,23 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		
 		if (GCC_LIKELY(vga.seq.map_mask == 0x4)) {
+			VGA_RasterChange();
 			vga.draw.font[addr]=(Bit8u)val;
+			vga.draw.font_gen++;
 		} else {
-			if (vga.seq.map_mask & 0x4) // font map
+			if (vga.seq.map_mask & 0x4) { // font map
+				VGA_RasterChange();
 				vga.draw.font[addr]=(Bit8u)val;
-			if (vga.seq.map_mask & 0x2) // character attribute
+				vga.draw.font_gen++;
+			}
+			if (vga.seq.map_mask & 0x2) { // character attribute
 				vga.mem.linear[CHECKED3(vga.svga.bank_read_full+addr+1)]=(Bit8u)val;
-			if (vga.seq.map_mask & 0x1) // character index
+				MEM_CHANGED( CHECKED3(vga.svga.bank_read_full+addr+1) );
+			}
+			if (vga.seq.map_mask & 0x1) { // character index
 				vga.mem.linear[CHECKED3(vga.svga.bank_read_full+addr)]=(Bit8u)val;
+				MEM_CHANGED( CHECKED3(vga.svga.bank_read_full+addr) );
+			}
 		}
 	}
 };
@@ -542,6 +562,7 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
 		MEM_CHANGED( addr );
+		MEM_CHANGED( addr + 1 );
 		hostWrite<Bit16u>( &vga.mem.linear[addr], val );
 	}
 	void writed(PhysPt addr,Bitu val) {
@@ -549,6 +570,7 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
 		MEM_CHANGED( addr );	
+		MEM_CHANGED( addr + 3 );
 		hostWrite<Bit32u>( &vga.mem.linear[addr], val );
 	}
 };
@@ -568,6 +590,7 @@ public:
 		addr = vga.svga.bank_write_full + (PAGING_GetPhysicalAddress(addr) & 0xffff);
 		addr = CHECKED4(addr);
 		MEM_CHANGED( addr << 3 );
+		MEM_CHANGED( (addr+1) << 3 );
 		writeHandler<false>(addr+0,(Bit8u)(val >> 0));
 		writeHandler<false>(addr+1,(Bit8u)(val >> 8));
 	}
@@ -575,6 +598,7 @@ public:
 		addr = vga.svga.bank_write_full + (PAGING_GetPhysicalAddress(addr) & 0xffff);
 		addr = CHECKED4(addr);
 		MEM_CHANGED( addr << 3 );
+		MEM_CHANGED( (addr+3) << 3 );
 		writeHandler<false>(addr+0,(Bit8u)(val >> 0));
 		writeHandler<false>(addr+1,(Bit8u)(val >> 8));
 		writeHandler<false>(addr+2,(Bit8u)(val >> 16));
@@ -635,12 +659,14 @@ public:
 		addr = CHECKED(addr);
 		hostWrite<Bit16u>( &vga.mem.linear[addr], val );
 		MEM_CHANGED( addr );
+		MEM_CHANGED( addr + 1 );
 	}
 	void writed(PhysPt addr,Bitu val) {
 		addr = PAGING_GetPhysicalAddress(addr) - vga.lfb.addr;
 		addr = CHECKED(addr);
 		hostWrite<Bit32u>( &vga.mem.linear[addr], val );
 		MEM_CHANGED( addr );
+		MEM_CHANGED( addr + 3 );
 	}
 };
 
@@ -970,9 +996,11 @@ void VGA_SetupMemory(Section* sec) {
 
 #ifdef VGA_KEEP_CHANGES
 	memset( &vga.changes, 0, sizeof( vga.changes ));
-	int changesMapSize = (vga.vmemsize >> VGA_CHANGE_SHIFT) + 32;
-	vga.changes.map = new Bit8u[changesMapSize];
-	memset(vga.changes.map, 0, changesMapSize);
+	// The planar modes are tracked in the pixel buffer, which is twice as big
+	vga.changes.mapSize = ((vga.vmemsize << 1) >> VGA_CHANGE_SHIFT) + 32;
+	vga.changes.map = new Bit8u[vga.changes.mapSize];
+	memset(vga.changes.map, 0, vga.changes.mapSize);
+	vga.changes.writeMask = 1;
 #endif
 	vga.svga.bank_read = vga.svga.bank_write = 0;
 	vga.svga.bank_read_full = vga.svga.bank_write_full = 0;
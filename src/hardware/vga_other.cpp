@@ -355,6 +355,7 @@ static void DecreaseHue(bool pressed) {
 }
 
 static void write_cga_color_select(Bitu val) {
+	VGA_RasterChange();
 	vga.tandy.color_select=val;
 	switch(vga.mode) {
 	case  M_TANDY4: {
@@ -389,6 +390,7 @@ static void write_cga_color_select(Bitu val) {
 static void write_cga(Bitu port,Bitu val,Bitu /*iolen*/) {
 	switch (port) {
 	case 0x3d8:
+		VGA_RasterChange();
 		vga.tandy.mode_control=(Bit8u)val;
 		vga.attr.disabled = (val&0x8)? 0: 1; 
 		if (vga.tandy.mode_control & 0x2) {		// graphics mode
@@ -545,6 +547,8 @@ static void TandyCheckLineMask(void ) {
 }
 
 static void write_tandy_reg(Bit8u val) {
+	/* Mode, palette and border all show up on the next line */
+	VGA_RasterChange();
 	switch (vga.tandy.reg_index) {
 	case 0x0:
 		if (machine==MCH_PCJR) {
@@ -591,6 +595,7 @@ static void write_tandy(Bitu port,Bitu val,Bitu /*iolen*/) {
 	case 0x3d8:
 		val &= 0x3f; // only bits 0-6 are used
 		if (vga.tandy.mode_control ^ val) {
+			VGA_RasterChange();
 			vga.tandy.mode_control=(Bit8u)val;
 			if (val&0x8) vga.attr.disabled &= ~1;
 			else vga.attr.disabled |= 1;
@@ -601,6 +606,7 @@ static void write_tandy(Bitu port,Bitu val,Bitu /*iolen*/) {
 		}
 		break;
 	case 0x3d9:
+		VGA_RasterChange();
 		vga.tandy.color_select=val;
 		tandy_update_palette();
 		break;
@@ -624,6 +630,7 @@ static void write_tandy(Bitu port,Bitu val,Bitu /*iolen*/) {
 		// backwards compatibility?), resulting in odd pages being mapped
 		// as 2x16kB. Implemeted in vga_memory.cpp Tandy handler.
 
+		VGA_RasterChange();
 		vga.tandy.line_mask = (Bit8u)(val >> 6);
 		vga.tandy.draw_bank = val & ((vga.tandy.line_mask&2) ? 0x6 : 0x7);
 		vga.tandy.mem_bank = (val >> 3) & 7;
@@ -638,6 +645,9 @@ static void write_pcjr(Bitu port,Bitu val,Bitu /*iolen*/) {
 	case 0x3da:
 		if (vga.tandy.pcjr_flipflop) write_tandy_reg((Bit8u)val);
 		else {
+			// Bit 4 blanks the screen from the next line on
+			if (((val & 0x10) != 0) != ((vga.attr.disabled & 2) != 0))
+				VGA_RasterChange();
 			vga.tandy.reg_index=(Bit8u)val;
 			if (vga.tandy.reg_index & 0x10)
 				vga.attr.disabled |= 2;
@@ -675,6 +685,7 @@ static void write_pcjr(Bitu port,Bitu val,Bitu /*iolen*/) {
 		//    CRTC RA1. This results in the 4-bank mode.
 		//    PG1-2 in effect. 32k range.
 
+		VGA_RasterChange();
 		vga.tandy.line_mask = (Bit8u)(val >> 6);
 		vga.tandy.draw_bank = val & ((vga.tandy.line_mask&2) ? 0x6 : 0x7);
 		vga.tandy.mem_bank = (val >> 3) & 7;
@@ -713,6 +724,8 @@ void Herc_Palette(void) {
 static void write_hercules(Bitu port,Bitu val,Bitu /*iolen*/) {
 	switch (port) {
 	case 0x3b8: {
+		// mode, page and blink show up on the next line
+		if (vga.herc.mode_control ^ val) VGA_RasterChange();
 		// the protected bits can always be cleared but only be set if the 
 		// protection bits are set
 		if (vga.herc.mode_control&0x2) {
@@ -805,6 +818,7 @@ void VGA_SetupOther(void) {
 		extern Bit8u int10_font_08[256 * 8];
 		for (i=0;i<256;i++)	memcpy(&vga.draw.font[i*32],&int10_font_08[i*8],8);
 		vga.draw.font_tables[0]=vga.draw.font_tables[1]=vga.draw.font;
+		vga.draw.font_gen++;
 	}
 	if (machine==MCH_CGA || IS_TANDY_ARCH || machine==MCH_HERC) {
 		IO_RegisterWriteHandler(0x3db,write_lightpen,IO_MB);
@@ -814,6 +828,7 @@ void VGA_SetupOther(void) {
 		extern Bit8u int10_font_14[256 * 14];
 		for (i=0;i<256;i++)	memcpy(&vga.draw.font[i*32],&int10_font_14[i*14],14);
 		vga.draw.font_tables[0]=vga.draw.font_tables[1]=vga.draw.font;
+		vga.draw.font_gen++;
 		MAPPER_AddHandler(CycleHercPal,MK_f11,0,"hercpal","Herc Pal");
 	}
 	if (machine==MCH_CGA) {
@@ -39,6 +39,7 @@ void write_p3c5(Bitu /*port*/,Bitu val,Bitu iolen) {
 		break;
 	case 1:		/* Clocking Mode */
 		if (val!=seq(clocking_mode)) {
+			if ((val^seq(clocking_mode)) & 0x20) VGA_RasterChange();
 			// don't resize if only the screen off bit was changed
 			if ((val&(~0x20))!=(seq(clocking_mode)&(~0x20))) {
 				seq(clocking_mode)=val;
@@ -75,6 +76,7 @@ void write_p3c5(Bitu /*port*/,Bitu val,Bitu iolen) {
 		break;
 	case 3:		/* Character Map Select */
 		{
+			if (val!=seq(character_map_select)) VGA_RasterChange();
 			seq(character_map_select)=val;
 			Bit8u font1=(val & 0x3) << 1;
 			if (IS_VGA_ARCH) font1|=(val & 0x10) >> 4;
@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include "callback.h"
 #include "cpu.h"		// for 0x3da delay
+#include "vga_xga_copy.h"
 
 #define XGA_SCREEN_WIDTH	vga.s3.xga_screen_width
 #define XGA_COLOR_MODE		vga.s3.xga_color_mode
@@ -158,9 +159,14 @@ void XGA_DrawPoint(Bitu x, Bitu y, Bitu c) {
 			((Bit32u*)(vga.mem.linear))[memaddr] = c;
 			break;
 		default:
-			break;
+			return;
 	}
-
+#if defined(VGA_KEEP_CHANGES) && !defined(VGA_LFB_MAPPED)
+	/* The linear modes are only tracked when the memory isn't mapped */
+	memaddr *= (XGA_COLOR_MODE==M_LIN8) ? 1 : (XGA_COLOR_MODE==M_LIN32) ? 4 : 2;
+	if (GCC_LIKELY(memaddr < vga.vmemsize))
+		vga.changes.map[memaddr >> VGA_CHANGE_SHIFT] |= vga.changes.writeMask;
+#endif
 }
 
 Bitu XGA_GetPoint(Bitu x, Bitu y) {
@@ -242,6 +248,149 @@ Bitu XGA_GetMixResult(Bitu mixmode, Bitu srcval, Bitu dstdata) {
 	return destval;
 }
 
+/* Row wise versions of the common blitter operations: the foreground mix
+   with a solid color, and copying or XORing video memory. They draw exactly
+   what the pixel by pixel code draws, everything else, including areas that
+   run past the end of video memory, is left to it. */
+
+static Bitu XGA_FastPixelSize(void) {
+	if ((xga.curcommand & 0x11) != 0x11) return 0;
+	switch(XGA_COLOR_MODE) {
+	case M_LIN8: return 1;
+	case M_LIN16: return 2;
+	case M_LIN32: return 4;
+	default: return 0;	// M_LIN15 has to clear the unused bit
+	}
+}
+
+/* The area drawn from x,y in the dx,dy directions, clipped to the scissors.
+   False when none of it is left. */
+static bool XGA_ClipArea(Bits x, Bits y, Bits dx, Bits dy, Bits& x1, Bits& y1, Bits& x2, Bits& y2) {
+	x1 = (dx > 0) ? x : x - xga.MAPcount;
+	x2 = x1 + xga.MAPcount;
+	y1 = (dy > 0) ? y : y - xga.MIPcount;
+	y2 = y1 + xga.MIPcount;
+	if (x1 < xga.scissors.x1) x1 = xga.scissors.x1;
+	if (x2 > xga.scissors.x2) x2 = xga.scissors.x2;
+	if (y1 < xga.scissors.y1) y1 = xga.scissors.y1;
+	if (y2 > xga.scissors.y2) y2 = xga.scissors.y2;
+	return (x1 <= x2) && (y1 <= y2);
+}
+
+static bool XGA_InMemory(Bits x, Bits y, Bitu size) {
+	if (x < 0 || y < 0) return false;
+	return ((Bitu)(y * XGA_SCREEN_WIDTH + x) + 1) * size <= vga.vmemsize;
+}
+
+static INLINE void XGA_LineChanged(const void * line, Bitu bytes) {
+#if defined(VGA_KEEP_CHANGES) && !defined(VGA_LFB_MAPPED)
+	Bitu start = (Bitu)((const Bit8u *)line - vga.mem.linear);
+	Bitu end = start + bytes - 1;
+	for (start >>= VGA_CHANGE_SHIFT, end >>= VGA_CHANGE_SHIFT; start <= end; start++)
+		vga.changes.map[start] |= vga.changes.writeMask;
+#endif
+}
+
+template <typename T> static void XGA_FillArea(Bits x1, Bits y1, Bits x2, Bits y2, T andMask, T xorMask) {
+	T * line = (T *)vga.mem.linear + y1 * XGA_SCREEN_WIDTH + x1;
+	Bitu count = x2 - x1 + 1;
+	for (Bits y = y1; y <= y2; y++) {
+		if (!andMask) {
+			if (sizeof(T) == 1) memset(line, xorMask, count);
+			else for (Bitu i = 0; i < count; i++) line[i] = xorMask;
+		} else {
+			for (Bitu i = 0; i < count; i++) line[i] = (line[i] & andMask) ^ xorMask;
+		}
+		XGA_LineChanged(line, count * sizeof(T));
+		line += XGA_SCREEN_WIDTH;
+	}
+}
+
+/* offset is from the destination to the source pixel */
+template <typename T> static void XGA_CopyArea(Bits x1, Bits y1, Bits x2, Bits y2, Bits dx, Bits dy, Bits offset, bool xorMix) {
+	Bits count = x2 - x1 + 1;
+	for (Bits i = 0; i <= y2 - y1; i++) {
+		Bits y = (dy > 0) ? y1 + i : y2 - i;
+		T * dst = (T *)vga.mem.linear + y * XGA_SCREEN_WIDTH + x1;
+		XGA_CopyLine<T>(dst, offset, count, dx, xorMix);
+		XGA_LineChanged(dst, count * sizeof(T));
+	}
+}
+
+/* The 8x8 pattern is at curx,cury and lines up with the screen */
+template <typename T> static void XGA_PatternArea(Bits x1, Bits y1, Bits x2, Bits y2, bool xorMix) {
+	const T * pattern = (T *)vga.mem.linear + xga.cury * XGA_SCREEN_WIDTH + xga.curx;
+	Bitu count = x2 - x1 + 1;
+	for (Bits y = y1; y <= y2; y++) {
+		const T * patLine = pattern + (y & 0x7) * XGA_SCREEN_WIDTH;
+		T * dst = (T *)vga.mem.linear + y * XGA_SCREEN_WIDTH + x1;
+		if (xorMix) for (Bitu i = 0; i < count; i++) dst[i] ^= patLine[(x1 + i) & 0x7];
+		else for (Bitu i = 0; i < count; i++) dst[i] = patLine[(x1 + i) & 0x7];
+		XGA_LineChanged(dst, count * sizeof(T));
+	}
+}
+
+static bool XGA_FastFill(Bits x, Bits y, Bits dx, Bits dy, Bitu mixmode, Bitu srcval) {
+	Bitu size = XGA_FastPixelSize();
+	if (!size) return false;
+	Bits x1, y1, x2, y2;
+	if (!XGA_ClipArea(x, y, dx, dy, x1, y1, x2, y2)) return true;
+	if (!XGA_InMemory(x2, y2, size)) return false;
+	/* With a fixed source every mix keeps, clears, sets or flips each bit */
+	Bitu xorMask = XGA_GetMixResult(mixmode, srcval, 0);
+	Bitu andMask = xorMask ^ XGA_GetMixResult(mixmode, srcval, ~(Bitu)0);
+	switch (size) {
+	case 1: XGA_FillArea<Bit8u>(x1, y1, x2, y2, (Bit8u)andMask, (Bit8u)xorMask); break;
+	case 2: XGA_FillArea<Bit16u>(x1, y1, x2, y2, (Bit16u)andMask, (Bit16u)xorMask); break;
+	case 4: XGA_FillArea<Bit32u>(x1, y1, x2, y2, (Bit32u)andMask, (Bit32u)xorMask); break;
+	}
+	return true;
+}
+
+/* BitBLT and pattern fill with only the foreground mix */
+static bool XGA_FastMix(Bits dx, Bits dy, Bitu mixmode, bool pattern) {
+	switch((mixmode >> 5) & 0x03) {
+		case 0x00: /* Src is background color */
+			return XGA_FastFill(xga.destx, xga.desty, dx, dy, mixmode, xga.backcolor);
+		case 0x01: /* Src is foreground color */
+			return XGA_FastFill(xga.destx, xga.desty, dx, dy, mixmode, xga.forecolor);
+		case 0x03: /* Src is bitmap data */
+			break;
+		default:
+			return false;
+	}
+	if ((mixmode & 0xf) != 0x07 && (mixmode & 0xf) != 0x05) return false;
+	bool xorMix = (mixmode & 0xf) == 0x05;
+	Bitu size = XGA_FastPixelSize();
+	if (!size) return false;
+	Bits x1, y1, x2, y2;
+	if (!XGA_ClipArea(xga.destx, xga.desty, dx, dy, x1, y1, x2, y2)) return true;
+	if (!XGA_InMemory(x2, y2, size)) return false;
+	Bits width = (Bits)XGA_SCREEN_WIDTH;
+	if (pattern) {
+		/* The pattern mustn't change while it's drawn */
+		if (!XGA_InMemory(xga.curx + 7, xga.cury + 7, size)) return false;
+		if (xga.curx + 7 >= width || x2 >= width) return false;
+		if (xga.curx + 7 >= x1 && xga.curx <= x2 && xga.cury + 7 >= y1 && xga.cury <= y2) return false;
+		switch (size) {
+		case 1: XGA_PatternArea<Bit8u>(x1, y1, x2, y2, xorMix); break;
+		case 2: XGA_PatternArea<Bit16u>(x1, y1, x2, y2, xorMix); break;
+		case 4: XGA_PatternArea<Bit32u>(x1, y1, x2, y2, xorMix); break;
+		}
+		return true;
+	}
+	Bits offx = (Bits)xga.curx - (Bits)xga.destx;
+	Bits offy = (Bits)xga.cury - (Bits)xga.desty;
+	if (x1 + offx < 0 || y1 + offy < 0 || !XGA_InMemory(x2 + offx, y2 + offy, size)) return false;
+	Bits offset = offy * width + offx;
+	switch (size) {
+	case 1: XGA_CopyArea<Bit8u>(x1, y1, x2, y2, dx, dy, offset, xorMix); break;
+	case 2: XGA_CopyArea<Bit16u>(x1, y1, x2, y2, dx, dy, offset, xorMix); break;
+	case 4: XGA_CopyArea<Bit32u>(x1, y1, x2, y2, dx, dy, offset, xorMix); break;
+	}
+	return true;
+}
+
 void XGA_DrawLineVector(Bitu val) {
 	Bits xat, yat;
 	Bitu srcval;
@@ -468,6 +617,14 @@ void XGA_DrawRectangle(Bitu val) {
 
 	srcy = xga.cury;
 
+	if (((xga.pix_cntl >> 6) & 0x3) == 0x00 && ((xga.foremix >> 5) & 0x03) <= 0x01 &&
+		XGA_FastFill(xga.curx, xga.cury, dx, dy, xga.foremix,
+			((xga.foremix >> 5) & 0x03) ? xga.forecolor : xga.backcolor)) {
+		xga.curx = (Bit16u)(xga.curx + dx * (xga.MAPcount + 1));
+		xga.cury = (Bit16u)(xga.cury + dy * (xga.MIPcount + 1));
+		return;
+	}
+
 	for(yat=0;yat<=xga.MIPcount;yat++) {
 		srcx = xga.curx;
 		for(xat=0;xat<=xga.MAPcount;xat++) {
@@ -753,7 +910,7 @@ void XGA_BlitRect(Bitu val) {
 			LOG_MSG("XGA: BlitRect: Unknown mix select register");
 			break;
 	}
-
+	if (mixselect == 0x00 && XGA_FastMix(dx, dy, mixmode, false)) return;
 
 	/* Copy source to video ram */
 	for(yat=0;yat<=xga.MIPcount ;yat++) {
@@ -845,6 +1002,7 @@ void XGA_DrawPattern(Bitu val) {
 			LOG_MSG("XGA: DrawPattern: Unknown mix select register");
 			break;
 	}
+	if (mixselect == 0x00 && XGA_FastMix(dx, dy, mixmode, true)) return;
 
 	for(yat=0;yat<=xga.MIPcount;yat++) {
 		tarx = xga.destx;
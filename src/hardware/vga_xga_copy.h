@@ -0,0 +1,46 @@
+/*
+ *  Copyright (C) 2002-2020  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* One line of an S3 BitBLT, shared with xga_bench which checks it against
+   the pixel by pixel copy. */
+
+#ifndef DOSBOX_VGA_XGA_COPY_H
+#define DOSBOX_VGA_XGA_COPY_H
+
+#include <string.h>
+
+/* count pixels from dst + offset to dst, in the dx direction. The pixels are
+   done in the same order as the pixel by pixel code, so overlapping areas
+   come out the same. */
+template <typename T> static INLINE void XGA_CopyLine(T * dst, Bits offset, Bits count, Bits dx, bool xorMix) {
+	const T * src = dst + offset;
+	/* A source behind the destination in the drawing direction is
+	   overwritten before it is read, which repeats pixels */
+	bool behind = (dx > 0) ? (offset < 0 && offset > -count) : (offset > 0 && offset < count);
+	if (!xorMix && !behind) {
+		memmove(dst, src, count * sizeof(T));
+	} else if (dx > 0) {
+		if (xorMix) for (Bits x = 0; x < count; x++) dst[x] ^= src[x];
+		else for (Bits x = 0; x < count; x++) dst[x] = src[x];
+	} else {
+		if (xorMix) for (Bits x = count - 1; x >= 0; x--) dst[x] ^= src[x];
+		else for (Bits x = count - 1; x >= 0; x--) dst[x] = src[x];
+	}
+}
+
+#endif
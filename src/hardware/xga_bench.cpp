@@ -0,0 +1,108 @@
+/*
+ *  Copyright (C) 2002-2020  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* S3 BitBLT line benchmark, built with "make xga_bench" in src/hardware.
+   Usage: xga_bench [width] [rounds]
+   First checks the line copy of vga_xga_copy.h against the pixel by pixel
+   copy for every overlap of source and destination in both directions, with
+   and without the xor mix, and stops at the first difference. Then reports
+   the best time of each for copying a screen of width x 768 pixels. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "dosbox.h"
+#include "vga_xga_copy.h"
+
+static Bit64u Now(void) {
+	return (Bit64u)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* What the pixel by pixel code does: read the source and write the
+   destination one pixel after the other in the drawing direction */
+template <typename T> static void PixelLine(T * dst, Bits offset, Bits count, Bits dx, bool xorMix) {
+	for (Bits i = 0; i < count; i++) {
+		Bits x = (dx > 0) ? i : count - 1 - i;
+		T pixel = dst[x + offset];
+		dst[x] = xorMix ? (dst[x] ^ pixel) : pixel;
+	}
+}
+
+template <typename T> static bool Check(const char * name) {
+	const Bits margin = 24;
+	for (Bits count = 1; count <= 16; count++) {
+		for (Bits offset = -margin; offset <= margin; offset++) {
+			for (Bits dx = -1; dx <= 1; dx += 2) {
+				for (int xorMix = 0; xorMix < 2; xorMix++) {
+					T line[2][16 + 2 * 24];
+					for (Bitu i = 0; i < sizeof(line[0]) / sizeof(T); i++)
+						line[0][i] = line[1][i] = (T)(i * 0x9e3779b1u + 1);
+					XGA_CopyLine<T>(line[0] + margin, offset, count, dx, xorMix != 0);
+					PixelLine<T>(line[1] + margin, offset, count, dx, xorMix != 0);
+					if (memcmp(line[0], line[1], sizeof(line[0]))) {
+						printf("%s: the line copy differs for %d pixels, offset %d, dx %d%s\n", name,
+							(int)count, (int)offset, (int)dx, xorMix ? ", xor" : "");
+						return false;
+					}
+				}
+			}
+		}
+	}
+	printf("%s: the line copy matches the pixel copy\n", name);
+	return true;
+}
+
+template <typename T> static void Time(const char * name, Bits width, Bitu rounds) {
+	const Bits height = 768;
+	std::vector<T> screen(width * (height + 1));
+	for (Bitu i = 0; i < screen.size(); i++) screen[i] = (T)i;
+	/* Scroll up by a line, the usual blit */
+	Bit64u best[2] = { ~(Bit64u)0, ~(Bit64u)0 };
+	for (Bitu r = 0; r < rounds; r++) {
+		for (Bitu kind = 0; kind < 2; kind++) {
+			Bit64u start = Now();
+			for (Bits y = 0; y < height; y++) {
+				if (kind) XGA_CopyLine<T>(&screen[y * width], width, width, 1, false);
+				else PixelLine<T>(&screen[y * width], width, width, 1, false);
+			}
+			Bit64u time = Now() - start;
+			if (time < best[kind]) best[kind] = time;
+		}
+	}
+	printf("%-6s %12.0f %12.0f %7.2f\n", name, (double)best[0], (double)best[1], (double)best[0] / best[1]);
+}
+
+int main(int argc, char * argv[]) {
+	Bits width = argc > 1 ? atoi(argv[1]) : 1024;
+	Bitu rounds = argc > 2 ? (Bitu)atoi(argv[2]) : 20;
+	if (width <= 0 || !rounds) {
+		printf("Usage: xga_bench [width] [rounds]\n");
+		return 1;
+	}
+	bool same = Check<Bit8u>("8bpp") && Check<Bit16u>("16bpp") && Check<Bit32u>("32bpp");
+	if (!same) return 1;
+	printf("\n%-6s %12s %12s %7s\n", "depth", "pixel ns", "line ns", "speedup");
+	Time<Bit8u>("8bpp", width, rounds);
+	Time<Bit16u>("16bpp", width, rounds);
+	Time<Bit32u>("32bpp", width, rounds);
+	return 0;
+}
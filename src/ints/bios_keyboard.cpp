@@ -25,6 +25,7 @@
 #include "regs.h"
 #include "inout.h"
 #include "dos_inc.h"
+#include "cpu.h"
 #include "SDL.h"
 
 /* SDL by default treats numlock and scrolllock different from all other keys.
@@ -506,6 +507,7 @@ static Bitu INT16_Handler(void) {
 		} else {
 			/* enter small idle loop to allow for irqs to happen */
 			reg_ip+=1;
+			if (CPU_IdleDetect) CPU_IdleSkip();
 		}
 		break;
 	case 0x10: /* GET KEYSTROKE (enhanced keyboards only) */
@@ -518,6 +520,7 @@ static Bitu INT16_Handler(void) {
 		} else {
 			/* enter small idle loop to allow for irqs to happen */
 			reg_ip+=1;
+			if (CPU_IdleDetect) CPU_IdleSkip();
 		}
 		break;
 	case 0x01: /* CHECK FOR KEYSTROKE */
@@ -537,6 +540,7 @@ static Bitu INT16_Handler(void) {
 			} else {
 				/* no key available */
 				CALLBACK_SZF(true);
+				CPU_IdlePoll();
 				break;
 			}
 //			CALLBACK_Idle();
@@ -547,6 +551,7 @@ static Bitu INT16_Handler(void) {
 		CALLBACK_SIF(true);
 		if (!check_key(temp)) {
 			CALLBACK_SZF(true);
+			CPU_IdlePoll();
 		} else {
 			CALLBACK_SZF(false);
 			if (((temp&0xff)==0xf0) && (temp>>8)) {
@@ -476,6 +476,10 @@ static void FinishSetMode(bool clearmem) {
 			/* Hack we just access the memory directly */
 			memset(vga.mem.linear,0,vga.vmemsize);
 			memset(vga.fastmem, 0, vga.vmemsize<<1);
+#ifdef VGA_KEEP_CHANGES
+			/* Bypassed the handlers, so mark all of it for both frames */
+			memset(vga.changes.map, 3, vga.changes.mapSize);
+#endif
 		}
 	}
 	/* Setup the BIOS */
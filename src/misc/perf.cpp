@@ -0,0 +1,160 @@
+/*
+ *  Copyright (C) 2002-2020  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include "dosbox.h"
+#include "perf.h"
+#include "setup.h"
+#include "mapper.h"
+#include "timer.h"
+
+std::atomic<bool> perf_enabled(false);
+Bit64u perf_counters[PERF_MAX];
+
+static struct {
+	Bitu interval;
+	Bit32u lastReport;
+	Bit64u lastHost;
+	Bit64u last[PERF_MAX];
+	bool hud;
+	Bitu hudSerial;
+	char hudText[160];
+	char report[384];
+	FILE * log;
+} perf;
+
+Bit64u PERF_Now(void) {
+	return (Bit64u)std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void PERF_Enable(void) {
+	if (perf_enabled) return;
+	/* Start a fresh interval, the host time counters were not collected */
+	perf_enabled = true;
+	perf.lastReport = GetTicks();
+	perf.lastHost = PERF_Now();
+	memcpy(perf.last,perf_counters,sizeof(perf.last));
+}
+
+static void PERF_Report(void) {
+	Bit64u now = PERF_Now();
+	double host = (double)(now - perf.lastHost);
+	if (host <= 0) return;
+	Bit64u delta[PERF_MAX];
+	for (Bitu i = 0;i < PERF_MAX;i++) {
+		delta[i] = perf_counters[i] - perf.last[i];
+		perf.last[i] = perf_counters[i];
+	}
+	perf.lastHost = now;
+
+	double seconds = host / 1000000.0;
+	double mips = delta[PERF_CPU_CYCLES] / host;
+	double speed = delta[PERF_CPU_TICKS] * 1000.0 / host * 100.0;
+	double fps = delta[PERF_FRAMES] / seconds;
+	double skipped = delta[PERF_FRAMES_SKIPPED] / seconds;
+	double events = delta[PERF_CPU_TICKS] ? (double)delta[PERF_PIC_EVENTS] / delta[PERF_CPU_TICKS] : 0.0;
+	double cpu = delta[PERF_HOST_CPU] * 100.0 / host;
+	double pic = delta[PERF_HOST_PIC] * 100.0 / host;
+	double render = delta[PERF_HOST_RENDER] * 100.0 / host;
+	double mixer = delta[PERF_HOST_MIXER] * 100.0 / host;
+	double latency = delta[PERF_MIXER_CALLBACKS] ? delta[PERF_MIXER_LATENCY] / 1000.0 / delta[PERF_MIXER_CALLBACKS] : 0.0;
+
+	snprintf(perf.report,sizeof(perf.report),
+		"time=%u speed=%.1f mips=%.2f fps=%.1f skipped=%.1f pic_events_ms=%.2f "
+		"audio_callbacks=%u underruns=%u overruns=%u stretches=%u audio_latency_ms=%.1f "
+		"host_cpu=%.1f host_pic=%.1f host_render=%.1f host_mixer=%.1f",
+		GetTicks(),speed,mips,fps,skipped,events,
+		(unsigned int)delta[PERF_MIXER_CALLBACKS],(unsigned int)delta[PERF_MIXER_UNDERRUNS],
+		(unsigned int)delta[PERF_MIXER_OVERRUNS],(unsigned int)delta[PERF_MIXER_STRETCHES],latency,
+		cpu,pic,render,mixer);
+	if (perf.log) {
+		fprintf(perf.log,"%s\n",perf.report);
+		fflush(perf.log);
+	}
+	if (perf.hud) {
+		snprintf(perf.hudText,sizeof(perf.hudText),
+			"%.2f MIPS %3.0f%% %.1f EV/MS\n"
+			"%4.1f FPS %4.1f SKIP %u XRUN %.0f MS\n"
+			"CPU %2.0f%% PIC %2.0f%% GFX %2.0f%% MIX %2.0f%%",
+			mips,speed,events,fps,skipped,(unsigned int)delta[PERF_MIXER_UNDERRUNS],latency,
+			cpu,pic,render,mixer);
+		perf.hudSerial++;
+	}
+}
+
+static void PERF_TickHandler(void) {
+	if (!perf_enabled) return;
+	/* Reports are spaced in host time, the emulation may run slower or faster */
+	Bit32u ticks = GetTicks();
+	if (ticks - perf.lastReport < perf.interval) return;
+	perf.lastReport = ticks;
+	PERF_Report();
+}
+
+const char * PERF_GetHUD(Bitu & serial) {
+	serial = perf.hudSerial;
+	return perf.hud ? perf.hudText : NULL;
+}
+
+const char * PERF_GetReport(void) {
+	/* Used for polling (GameLink), so start collecting when it wasn't yet */
+	PERF_Enable();
+	return perf.report;
+}
+
+static void PERF_ToggleHUD(bool pressed) {
+	if (!pressed) return;
+	perf.hud = !perf.hud;
+	if (perf.hud) {
+		strcpy(perf.hudText,"PERF");
+		PERF_Enable();
+	}
+	perf.hudSerial++;
+}
+
+static void PERF_ShutDown(Section * /*sec*/) {
+	TIMER_DelTickHandler(PERF_TickHandler);
+	if (perf.log) {
+		fclose(perf.log);
+		perf.log = 0;
+	}
+}
+
+void PERF_Init(Section * sec) {
+	Section_prop * section=static_cast<Section_prop *>(sec);
+	perf.interval = section->Get_int("perfinterval");
+	perf.hud = false;
+	perf.hudSerial = 0;
+	perf.report[0] = 0;
+	perf.log = 0;
+	Prop_path * proppath = section->Get_path("perflog");
+	if (!proppath->realpath.empty()) {
+		perf.log = fopen(proppath->realpath.c_str(),"a");
+		if (!perf.log) LOG_MSG("PERF:Can't open %s for writing",proppath->realpath.c_str());
+		else PERF_Enable();
+	}
+	if (section->Get_bool("perfhud")) PERF_ToggleHUD(true);
+	TIMER_AddTickHandler(PERF_TickHandler);
+	MAPPER_AddHandler(PERF_ToggleHUD,MK_f2,MMOD1,"perfhud","Perf HUD");
+	sec->AddDestroyFunction(&PERF_ShutDown);
+}